@@ -19,7 +19,7 @@
 
 /* These are standard for all packages using Automake */
 #define PACKAGE "id3lib"
-#define VERSION "3.8.3"
+#define VERSION "3.8.4"
 
 /* And now the rest of the boys */
 /* #undef CXX_HAS_BUGGY_FOR_LOOPS */
@@ -45,11 +45,11 @@
 #define HAVE_ZLIB 1
 #define HAVE_GETOPT_LONG 1
 #define _ID3LIB_NAME "id3lib"
-#define _ID3LIB_VERSION "3.8.3"
-#define _ID3LIB_FULLNAME "id3lib-3.8.3"
+#define _ID3LIB_VERSION "3.8.4"
+#define _ID3LIB_FULLNAME "id3lib-3.8.4"
 #define _ID3LIB_MAJOR_VERSION 3
 #define _ID3LIB_MINOR_VERSION 8
-#define _ID3LIB_PATCH_VERSION 3
+#define _ID3LIB_PATCH_VERSION 4
 #define _ID3LIB_INTERFACE_AGE 0
 #define _ID3LIB_BINARY_AGE 0
 #define _ID3_COMPILED_WITH_DEBUGGING "minimum"
@@ -62,6 +62,9 @@
 /* Define if you have the <climits> header file. */
 #define HAVE_CLIMITS 1
 
+/* Define if you have the `copy_file_range' function. */
+#define HAVE_COPY_FILE_RANGE 1
+
 /* Define if you have the <cstdio> header file. */
 #define HAVE_CSTDIO 1
 
@@ -71,9 +74,15 @@
 /* Define if you have the <cstring> header file. */
 #define HAVE_CSTRING 1
 
+/* Define if you have the <dirent.h> header file. */
+#define HAVE_DIRENT_H 1
+
 /* Define if you have the <dlfcn.h> header file. */
 #define HAVE_DLFCN_H 1
 
+/* Define if you have the <fcntl.h> header file. */
+#define HAVE_FCNTL_H 1
+
 /* Define if you have the <fstream> header file. */
 #define HAVE_FSTREAM 1
 
@@ -107,12 +116,24 @@
 /* Define if you have the <bitset> header file. */
 #define HAVE_BITSET 1
 
+/* Define if you have the pthread library (-lpthread). */
+#define HAVE_LIBPTHREAD 1
+
 /* Define if you have the <memory.h> header file. */
 #define HAVE_MEMORY_H 1
 
 /* Define if you have the `mkstemp' function. */
 #define HAVE_MKSTEMP 1
 
+/* Define if you have the <linux/io_uring.h> header file. */
+/* #undef HAVE_LINUX_IO_URING_H */
+
+/* Define if you have the <pthread.h> header file. */
+#define HAVE_PTHREAD_H 1
+
+/* Define if you have the `pwritev' function. */
+#define HAVE_PWRITEV 1
+
 /* Define if you have the <stdint.h> header file. */
 #define HAVE_STDINT_H 1
 
@@ -137,6 +158,9 @@
 /* Define if you have the <sys/types.h> header file. */
 #define HAVE_SYS_TYPES_H 1
 
+/* Define if you have the <sys/uio.h> header file. */
+#define HAVE_SYS_UIO_H 1
+
 /* Define if you have the `truncate' function. */
 #define HAVE_TRUNCATE 1
 
@@ -156,7 +180,7 @@
 #define STDC_HEADERS 1
 
 /* Version number of package */
-#define VERSION "3.8.3"
+#define VERSION "3.8.4"
 
 /* Define if you need to in order for stat and other things to work. */
 /* #undef _POSIX_SOURCE */
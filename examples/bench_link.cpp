@@ -0,0 +1,73 @@
+// $Id$
+
+// Links the files given on the command line with each of the link options
+// and prints the average time taken per file, to show what the analysis of
+// the mpeg audio costs on top of parsing the tags.
+//
+//   benchlink [-n iterations] file...
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char* argv[])
+{
+  int iterations = 10;
+  int first = 1;
+  if (argc > 2 && strcmp(argv[1], "-n") == 0)
+  {
+    iterations = atoi(argv[2]);
+    first = 3;
+  }
+  if (first >= argc || iterations <= 0)
+  {
+    cerr << "usage: " << argv[0] << " [-n iterations] file..." << endl;
+    return 1;
+  }
+
+  const struct
+  {
+    const char* name;
+    flags_t options;
+  } profiles[] =
+  {
+    { "tags only",    ID3LO_TAGSONLY },
+    { "mp3 header",   ID3LO_MP3HEADER },
+    { "mp3 duration", ID3LO_MP3DURATION }
+  };
+
+  const int files = argc - first;
+  for (size_t p = 0; p < sizeof(profiles) / sizeof(profiles[0]); ++p)
+  {
+    const double start = now();
+    for (int i = 0; i < iterations; ++i)
+    {
+      for (int f = first; f < argc; ++f)
+      {
+        ID3_Tag tag;
+        tag.Link(argv[f], ID3TT_ALL, profiles[p].options);
+      }
+    }
+    const double usecs = (now() - start) * 1e6 / (iterations * files);
+    cout << profiles[p].name << ": " << usecs << " us per file" << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,161 @@
+// $Id$
+
+// Scans the files and directories given on the command line, first linking
+// each file through an ID3_IFStreamReader and then with the batched reads,
+// and prints how many files a second each way managed.
+//
+//   benchscan [-n iterations] [-j threads] [-b batch] [-c] file|dir...
+//
+// -c asks the kernel to drop the files from the page cache before each
+// pass, for something like a cold scan without having to be root.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+
+#include "id3/id3lib_streams.h"
+#include "id3/scanner.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+class Counter : public ID3_Scanner::Handler
+{
+public:
+  Counter() : frames(0), paths() { ; }
+
+  void Scanned(const ID3_ScanResult& result)
+  {
+    if (result.tag)
+    {
+      frames += result.tag->NumFrames();
+    }
+    if (paths.size() <= result.index)
+    {
+      paths.resize(result.index + 1);
+    }
+    paths[result.index] = result.path;
+  }
+
+  size_t frames;
+  std::vector<dami::String> paths;
+};
+
+static void dropCache(const std::vector<dami::String>& paths)
+{
+#if defined(POSIX_FADV_DONTNEED)
+  for (size_t i = 0; i < paths.size(); ++i)
+  {
+    int fd = open(paths[i].c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+    }
+  }
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+  int iterations = 3;
+  size_t threads = 0, batch = 32;
+  bool cold = false;
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg)
+  {
+    if (strcmp(argv[arg], "-c") == 0)
+    {
+      cold = true;
+    }
+    else if (arg + 1 < argc && strcmp(argv[arg], "-n") == 0)
+    {
+      iterations = atoi(argv[++arg]);
+    }
+    else if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0)
+    {
+      threads = atoi(argv[++arg]);
+    }
+    else if (arg + 1 < argc && strcmp(argv[arg], "-b") == 0)
+    {
+      batch = atoi(argv[++arg]);
+    }
+    else
+    {
+      break;
+    }
+  }
+  if (arg >= argc || iterations <= 0 || batch == 0)
+  {
+    cerr << "usage: " << argv[0] << " [-n iterations] [-j threads] "
+         << "[-b batch] [-c] file|dir..." << endl;
+    return 1;
+  }
+
+  ID3_Scanner scanner;
+  for (; arg < argc; ++arg)
+  {
+    struct stat st;
+    if (stat(argv[arg], &st) == 0 && S_ISDIR(st.st_mode))
+    {
+      scanner.AddDirectory(argv[arg], "");
+    }
+    else
+    {
+      scanner.AddFile(argv[arg]);
+    }
+  }
+  scanner.SetThreads(threads);
+  scanner.SetLinkOptions(ID3LO_PICTUREOFFSETS);
+
+  // one pass to learn the paths, and to warm the cache if that's wanted
+  Counter counter;
+  scanner.Scan(counter);
+
+  const struct
+  {
+    const char* name;
+    size_t batch;
+  } paths[] =
+  {
+    { "ifstream", 0 },
+    { ID3_Scanner::HasAsyncReads() ? "io_uring" : "batched pread", batch }
+  };
+  for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); ++p)
+  {
+    scanner.SetBatchSize(paths[p].batch);
+    double secs = 0;
+    size_t frames = 0;
+    for (int i = 0; i < iterations; ++i)
+    {
+      if (cold)
+      {
+        dropCache(counter.paths);
+      }
+      Counter passCounter;
+      const double start = now();
+      scanner.Scan(passCounter);
+      secs += now() - start;
+      frames = passCounter.frames;
+    }
+    cout << paths[p].name << ": " << scanner.NumFiles() * iterations / secs
+         << " files/s (" << frames << " frames)" << endl;
+  }
+  return 0;
+}
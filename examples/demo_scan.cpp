@@ -0,0 +1,159 @@
+// Copyright 1999 Scott Thomas Haug <scott@id3.org>
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+//
+// $Id$
+
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+
+#include <id3/scanner.h>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+void PrintUsage(const char *sName)
+{
+  cout << "Usage: " << sName << " [OPTION]... [FILE|DIRECTORY]..." << endl;
+  cout << "Read the tags of many files at once and report how fast it went." << endl;
+  cout << endl;
+  cout << "  -j THREADS   Scan on THREADS threads (default: one per processor)" << endl;
+  cout << "  -s SUFFIX    Take the files in directories that end in SUFFIX" << endl;
+  cout << "               (default: .mp3; \"\" for all of them)" << endl;
+  cout << "  -a           Look at the mpeg audio too, not just the tags" << endl;
+  cout << "  -l           List each file with its artist and title" << endl;
+  cout << "  -h           Display this help and exit" << endl;
+}
+
+static double now()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static const char* textOf(const ID3_Frame* frame)
+{
+  const ID3_Field* fld = frame ? frame->GetField(ID3FN_TEXT) : NULL;
+  const char* text = fld ? fld->GetRawText() : NULL;
+  return text ? text : "";
+}
+
+class Reporter : public ID3_Scanner::Handler
+{
+public:
+  Reporter(bool list) : _list(list), _errors(0) { ; }
+
+  void Scanned(const ID3_ScanResult& result)
+  {
+    if (result.error)
+    {
+      cerr << result.path << ": " << result.error << endl;
+      ++_errors;
+    }
+    else if (_list)
+    {
+      cout << result.path << ": " << textOf(result.frames[0]) << " - "
+           << textOf(result.frames[1]);
+      if (result.mp3)
+      {
+        cout << " (" << result.mp3->time << "s)";
+      }
+      cout << endl;
+    }
+  }
+
+  size_t errors() const { return _errors; }
+
+private:
+  bool _list;
+  size_t _errors;
+};
+
+int main(int argc, char* argv[])
+{
+  ID3_Scanner scanner;
+  const char* suffix = ".mp3";
+  // only the tags, and leaving the pictures in the files
+  flags_t options = ID3LO_PICTUREOFFSETS;
+  bool list = false;
+
+  int arg = 1;
+  for (; arg < argc && argv[arg][0] == '-'; ++arg)
+  {
+    if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+    {
+      scanner.SetThreads(atoi(argv[++arg]));
+    }
+    else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc)
+    {
+      suffix = argv[++arg];
+    }
+    else if (strcmp(argv[arg], "-a") == 0)
+    {
+      options = ID3LO_MP3HEADER | ID3LO_PICTUREOFFSETS;
+    }
+    else if (strcmp(argv[arg], "-l") == 0)
+    {
+      list = true;
+    }
+    else
+    {
+      PrintUsage(argv[0]);
+      return strcmp(argv[arg], "-h") == 0 ? 0 : 1;
+    }
+  }
+  if (arg >= argc)
+  {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  const double start = now();
+  for (; arg < argc; ++arg)
+  {
+    struct stat st;
+    if (stat(argv[arg], &st) == 0 && S_ISDIR(st.st_mode))
+    {
+      scanner.AddDirectory(argv[arg], suffix);
+    }
+    else
+    {
+      scanner.AddFile(argv[arg]);
+    }
+  }
+  const double listed = now();
+
+  scanner.SetLinkOptions(options);
+  scanner.SelectFrame(ID3FID_LEADARTIST);
+  scanner.SelectFrame(ID3FID_TITLE);
+  Reporter reporter(list);
+  const size_t scanned = scanner.Scan(reporter);
+  const double done = now();
+
+  const double secs = done - listed;
+  cout << scanned << " files scanned, " << reporter.errors() << " errors, in "
+       << secs << "s (" << (secs > 0 ? scanner.NumFiles() / secs : 0)
+       << " files/s); " << (listed - start) << "s to list them" << endl;
+  return 0;
+}
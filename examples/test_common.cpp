@@ -0,0 +1,113 @@
+// $Id$
+
+// Writes a tag with the usual metadata in it, in a mix of encodings, and
+// checks that ID3Tag_ExtractCommon() gets all of it in one call.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "id3.h"
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-common.tag";
+
+static void addText(ID3_Tag& tag, ID3_FrameID id, const char* text)
+{
+  ID3_Frame* frame = new ID3_Frame(id);
+  frame->GetField(ID3FN_TEXT)->Set(text);
+  tag.AttachFrame(frame);
+}
+
+static void writeTag()
+{
+  ofstream file(FILENAME, ios::out | ios::binary | ios::trunc);
+  file.close();
+
+  ID3_Tag tag(FILENAME);
+  // latin-1
+  addText(tag, ID3FID_TITLE, "Caf\xE9");
+  // utf-16, with a character outside the latin-1 range
+  ID3_Frame* frame = new ID3_Frame(ID3FID_LEADARTIST);
+  const unicode_t artist[] = { 'A', 0x0142, 'a', 0 };
+  frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->Set(artist);
+  tag.AttachFrame(frame);
+  addText(tag, ID3FID_BAND, "Various");
+  addText(tag, ID3FID_ALBUM, "Album");
+  addText(tag, ID3FID_YEAR, "2003");
+  addText(tag, ID3FID_CONTENTTYPE, "(17)");
+  addText(tag, ID3FID_COMPOSER, "Composer");
+  addText(tag, ID3FID_TRACKNUM, "3/12");
+  addText(tag, ID3FID_PARTINSET, "1/2");
+  addText(tag, ID3FID_SONGLEN, "185000");
+  frame = new ID3_Frame(ID3FID_ITUNESCOMPILATION);
+  frame->GetField(ID3FN_DATA)->Set(reinterpret_cast<const uchar*>("\0" "1"), 2);
+  tag.AttachFrame(frame);
+
+  const uchar picture[] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+  frame = new ID3_Frame(ID3FID_PICTURE);
+  frame->GetField(ID3FN_MIMETYPE)->Set("image/gif");
+  frame->GetField(ID3FN_PICTURETYPE)->Set(ID3PT_OTHER);
+  frame->GetField(ID3FN_DATA)->Set(picture, 4);
+  tag.AttachFrame(frame);
+  frame = new ID3_Frame(ID3FID_PICTURE);
+  frame->GetField(ID3FN_MIMETYPE)->Set("image/png");
+  frame->GetField(ID3FN_PICTURETYPE)->Set(ID3PT_COVERFRONT);
+  frame->GetField(ID3FN_DATA)->Set(picture, sizeof(picture));
+  tag.AttachFrame(frame);
+  tag.Update(ID3TT_ID3V2);
+}
+
+static int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    cerr << "*** wrong " << what << endl;
+  }
+  return ok ? 0 : 1;
+}
+
+int main()
+{
+  writeTag();
+
+  int failures = 0;
+  ID3Tag* tag = ID3Tag_New();
+  ID3Tag_Link(tag, FILENAME);
+  ID3_CommonTags common;
+  failures += check(ID3Tag_ExtractCommon(tag, &common), "result");
+  cout << common.title << " / " << common.artist << " / " << common.album
+       << " / " << common.year << " / " << common.track << "/"
+       << common.tracks << endl;
+
+  failures += check(strcmp(common.title, "Caf\xC3\xA9") == 0, "title");
+  failures += check(strcmp(common.artist, "A\xC5\x82" "a") == 0, "artist");
+  failures += check(strcmp(common.album_artist, "Various") == 0, "album artist");
+  failures += check(strcmp(common.album, "Album") == 0, "album");
+  failures += check(strcmp(common.year, "2003") == 0, "year");
+  failures += check(strcmp(common.genre, "(17)") == 0, "genre");
+  failures += check(strcmp(common.composer, "Composer") == 0, "composer");
+  failures += check(common.track == 3 && common.tracks == 12, "track");
+  failures += check(common.disc == 1 && common.discs == 2, "disc");
+  failures += check(common.compilation, "compilation flag");
+  failures += check(common.duration == 185000, "duration");
+  failures += check(common.picture_size == 8 &&
+                    strcmp(common.picture_mimetype, "image/png") == 0,
+                    "picture");
+  failures += check(!ID3Tag_ExtractCommon(NULL, &common), "result for no tag");
+
+  ID3Tag_Delete(tag);
+  remove(FILENAME);
+  return failures;
+}
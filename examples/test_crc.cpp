@@ -0,0 +1,90 @@
+// $Id$
+
+// Writes tags with a crc in their extended header, plain and unsynced, and
+// checks that they are read back as matching it, and that a damaged copy
+// doesn't.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-crc.tag";
+
+static void writeTag(bool unsync, bool crc = true)
+{
+  ofstream file(FILENAME, ios::out | ios::binary | ios::trunc);
+  file.close();
+
+  ID3_Tag tag(FILENAME);
+  tag.SetUnsync(unsync);
+  tag.SetCrc(crc);
+  // the 0xFF 0xE0 makes for a false sync
+  ID3_AddTitle(&tag, "A title \xFF\xE0 with a false sync", true);
+  ID3_AddArtist(&tag, "An artist", true);
+  tag.Update(ID3TT_ID3V2);
+}
+
+// Flips a bit of the first frame, well past the header and extended header
+static void damageTag()
+{
+  fstream file(FILENAME, ios::in | ios::out | ios::binary);
+  file.seekg(40);
+  char ch = file.get();
+  file.seekp(40);
+  file.put(ch ^ 1);
+}
+
+int main()
+{
+  int failures = 0;
+  for (int unsync = 0; unsync <= 1; ++unsync)
+  {
+    writeTag(unsync != 0);
+    {
+      ID3_Tag tag(FILENAME);
+      cout << (unsync ? "unsynced" : "plain") << " tag: crc "
+           << tag.GetCrcStatus() << endl;
+      if (!tag.GetCrc() || tag.GetCrcStatus() != ID3CRC_OK)
+      {
+        cerr << "*** expected the crc to match" << endl;
+        ++failures;
+      }
+    }
+
+    damageTag();
+    {
+      ID3_Tag tag(FILENAME);
+      cout << (unsync ? "unsynced" : "plain") << " damaged tag: crc "
+           << tag.GetCrcStatus() << endl;
+      if (tag.GetCrcStatus() != ID3CRC_MISMATCH)
+      {
+        cerr << "*** expected the crc not to match" << endl;
+        ++failures;
+      }
+    }
+  }
+
+  // no crc unless asked for
+  writeTag(false, false);
+  {
+    ID3_Tag tag(FILENAME);
+    if (tag.GetCrc() || tag.GetCrcStatus() != ID3CRC_NONE)
+    {
+      cerr << "*** expected no crc" << endl;
+      ++failures;
+    }
+  }
+
+  remove(FILENAME);
+  return failures;
+}
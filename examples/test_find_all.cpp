@@ -0,0 +1,116 @@
+// $Id$
+
+// Fills a tag with comments and pictures, and checks that FindAll() finds
+// every one that matches, and that RemoveFrames() and the removal helpers
+// built on it take out just the ones they should.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <vector>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const size_t NUM_COMMENTS = 100;
+
+static void makeTag(ID3_Tag& tag)
+{
+  for (size_t i = 0; i < NUM_COMMENTS; ++i)
+  {
+    // every third comment has the same description
+    char desc[32];
+    sprintf(desc, "Comment %lu", static_cast<unsigned long>(i % 3 ? i : 0));
+    ID3_Frame* frame = new ID3_Frame(ID3FID_COMMENT);
+    frame->GetField(ID3FN_DESCRIPTION)->Set(desc);
+    frame->GetField(ID3FN_TEXT)->Set("Some text");
+    tag.AttachFrame(frame);
+  }
+  const ID3_PictureType types[] =
+  {
+    ID3PT_COVERFRONT, ID3PT_OTHER, ID3PT_OTHER, ID3PT_COVERBACK
+  };
+  for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i)
+  {
+    ID3_Frame* frame = new ID3_Frame(ID3FID_PICTURE);
+    frame->GetField(ID3FN_MIMETYPE)->Set("image/png");
+    frame->GetField(ID3FN_PICTURETYPE)->Set(types[i]);
+    tag.AttachFrame(frame);
+  }
+  ID3_AddTitle(&tag, "Title", true);
+}
+
+static bool isCover(const ID3_Frame* frame, void*)
+{
+  if (frame->GetID() != ID3FID_PICTURE)
+  {
+    return false;
+  }
+  uint32 type = frame->GetField(ID3FN_PICTURETYPE)->Get();
+  return type == ID3PT_COVERFRONT || type == ID3PT_COVERBACK;
+}
+
+static int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    cerr << "*** wrong " << what << endl;
+  }
+  return ok ? 0 : 1;
+}
+
+int main()
+{
+  int failures = 0;
+  ID3_Tag tag;
+  makeTag(tag);
+  const size_t numSame = (NUM_COMMENTS + 2) / 3;
+
+  std::vector<ID3_Frame*> frames;
+  failures += check(tag.FindAll(ID3FID_COMMENT, frames) == NUM_COMMENTS &&
+                    frames.size() == NUM_COMMENTS, "number of comments");
+  frames.clear();
+  failures += check(tag.FindAll(ID3FID_COMMENT, ID3FN_DESCRIPTION,
+                                "Comment 0", frames) == numSame,
+                    "number of comments with a description");
+  bool allMatch = true;
+  for (size_t i = 0; i < frames.size(); ++i)
+  {
+    allMatch = allMatch && (i == 0 || frames[i] != frames[i - 1]) &&
+      frames[i]->GetField(ID3FN_DESCRIPTION)->GetText() == "Comment 0";
+  }
+  failures += check(allMatch, "comments found");
+  frames.clear();
+  failures += check(tag.FindAll(ID3FID_PICTURE, ID3FN_PICTURETYPE,
+                                ID3PT_OTHER, frames) == 2,
+                    "number of pictures of a type");
+
+  // the removal helpers
+  failures += check(ID3_RemoveComments(&tag, "Comment 0") == numSame,
+                    "number of comments removed by description");
+  failures += check(ID3_RemovePictureType(&tag, ID3PT_OTHER) == 1,
+                    "number of pictures removed by type");
+  failures += check(tag.RemoveFrames(isCover) == 2, "number of covers removed");
+  failures += check(tag.RemoveFrames(ID3FID_COMMENT) == NUM_COMMENTS - numSame,
+                    "number of comments removed");
+
+  // what's left: one picture and the title
+  frames.clear();
+  failures += check(tag.NumFrames() == 2 &&
+                    tag.FindAll(ID3FID_PICTURE, frames) == 1 &&
+                    frames[0]->GetField(ID3FN_PICTURETYPE)->Get() ==
+                    ID3PT_OTHER && tag.Find(ID3FID_TITLE) != NULL,
+                    "frames left");
+  failures += check(tag.RemoveFrames(ID3FID_COMMENT) == 0,
+                    "number of comments removed from none");
+  cout << (failures ? "failed" : "passed") << endl;
+
+  return failures;
+}
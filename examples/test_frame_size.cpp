@@ -0,0 +1,100 @@
+// $Id$
+
+// Builds id3v2.4 tags whose frame sizes are written big-endian, as id3lib
+// and some other taggers write them, and synchsafe, as the spec has them,
+// and checks that both are read back the same.  The long frame comes first,
+// then last before padding, then last right at the end of the tag.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <string>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static void putSize(std::string& out, size_t size, bool synchsafe)
+{
+  const int shift = synchsafe ? 7 : 8;
+  const size_t mask = synchsafe ? 0x7F : 0xFF;
+  for (int i = 3; i >= 0; --i)
+  {
+    out += static_cast<char>((size >> (i * shift)) & mask);
+  }
+}
+
+static std::string frame(const char* id, const std::string& text,
+                         bool synchsafe)
+{
+  std::string out(id);
+  putSize(out, text.size() + 1, synchsafe);
+  out += std::string(2, '\0');      // flags
+  out += '\0';                      // iso-8859-1
+  return out + text;
+}
+
+static std::string tag(const std::string& frames, size_t padding)
+{
+  std::string out("ID3\x04", 4);
+  out += std::string(2, '\0');      // revision, flags
+  putSize(out, frames.size() + padding, true);
+  return out + frames + std::string(padding, '\0');
+}
+
+static std::string text(const ID3_Frame* frame)
+{
+  if (!frame)
+  {
+    return "(none)";
+  }
+  const char* text = frame->GetField(ID3FN_TEXT)->GetRawText();
+  return text ? text : "";
+}
+
+int main()
+{
+  int failures = 0;
+  // 200 has the high bit set in its big-endian size, 300 doesn't
+  const size_t lengths[] = { 200, 300 };
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l)
+  {
+    const std::string title(lengths[l] - 1, 't');
+    const std::string artist("An artist");
+    for (int synchsafe = 0; synchsafe <= 1; ++synchsafe)
+    {
+      const std::string longFrame = frame("TIT2", title, synchsafe != 0);
+      const std::string shortFrame = frame("TPE1", artist, synchsafe != 0);
+      const std::string tags[] =
+      {
+        tag(longFrame + shortFrame, 64),
+        tag(shortFrame + longFrame, 64),
+        tag(shortFrame + longFrame, 0)
+      };
+      for (size_t t = 0; t < sizeof(tags) / sizeof(tags[0]); ++t)
+      {
+        ID3_Tag parsed;
+        parsed.Parse(reinterpret_cast<const uchar*>(tags[t].data()),
+                     tags[t].size());
+        const bool ok = parsed.NumFrames() == 2 &&
+          text(parsed.Find(ID3FID_TITLE)) == title &&
+          text(parsed.Find(ID3FID_LEADARTIST)) == artist;
+        cout << (synchsafe ? "synchsafe" : "big-endian") << " size "
+             << lengths[l] << ", layout " << t << ": "
+             << (ok ? "ok" : "misread") << endl;
+        if (!ok)
+        {
+          cerr << "*** " << parsed.NumFrames() << " frames, title of "
+               << text(parsed.Find(ID3FID_TITLE)).size() << " chars, artist "
+               << text(parsed.Find(ID3FID_LEADARTIST)) << endl;
+          ++failures;
+        }
+      }
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
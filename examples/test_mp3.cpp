@@ -0,0 +1,634 @@
+// $Id$
+
+// Writes small mpeg audio files by hand and checks what linking them finds:
+// the first frame behind a junk or RIFF prefix, past headers that don't
+// lead on to more frames, and the exact length of a vbr file without a
+// Xing header from walking its frames.  Then the Info header of a CBR file
+// with its LAME extension, a VBRI header and a Xing header behind a crc.
+// Seeking by time is checked through the Xing toc, the VBRI table and the
+// frame index of ID3LO_MP3DURATION.  Also decodes known frame headers of
+// each mpeg version and layer.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-mp3.mp3";
+
+// MPEG-1 layer III, 128kbit/s at 44.1kHz, stereo, without a crc
+static const char FRAME_HEADER[] = "\xFF\xFB\x90\x00";
+static const size_t FRAME_SIZE = 417;
+
+static void appendFrames(std::string& out, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    out.append(FRAME_HEADER, 4);
+    out.append(FRAME_SIZE - 4, '\0');
+  }
+}
+
+// MPEG-1 layer III at 44.1kHz: the third header byte, with the bitrate
+// index, of each frame in turn and the size of its frame
+static const uchar VBR_BITRATES[] = { 0x90, 0xE0, 0x50, 0xB0 };
+static const size_t VBR_SIZES[] = { 417, 1044, 208, 626 };
+
+// count frames, cycling through the bitrates above
+static size_t appendVbrFrames(std::string& out, size_t count)
+{
+  size_t size = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const size_t kind = i % 4;
+    out.append(FRAME_HEADER, 4);
+    out[out.size() - 2] = static_cast<char>(VBR_BITRATES[kind]);
+    out.append(VBR_SIZES[kind] - 4, '\0');
+    size += VBR_SIZES[kind];
+  }
+  return size;
+}
+
+// bytes that are never 0xFF
+static std::string junk(size_t size)
+{
+  std::string out(size, '\0');
+  for (size_t i = 0; i < size; ++i)
+  {
+    out[i] = static_cast<char>('a' + i * 7 % 26);
+  }
+  return out;
+}
+
+static void putLE4(std::string& out, size_t n)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    out += static_cast<char>((n >> (8 * i)) & 0xFF);
+  }
+}
+
+static void setBE(std::string& out, size_t pos, uint32 n, size_t bytes)
+{
+  for (size_t i = 0; i < bytes; ++i)
+  {
+    out[pos + i] = static_cast<char>((n >> (8 * (bytes - 1 - i))) & 0xFF);
+  }
+}
+
+static void putBE(std::string& out, uint32 n, size_t bytes)
+{
+  out.append(bytes, '\0');
+  setBE(out, out.size() - bytes, n, bytes);
+}
+
+// the mpeg audio crc-16, a bit at a time
+static uint16 crc16(const uchar* data, size_t len, uint16 crc)
+{
+  for (size_t i = 0; i < len; ++i)
+  {
+    for (int bit = 7; bit >= 0; --bit)
+    {
+      const bool top = (crc & 0x8000) != 0;
+      crc <<= 1;
+      if (top != (((data[i] >> bit) & 1) != 0))
+      {
+        crc ^= 0x8005;
+      }
+    }
+  }
+  return crc;
+}
+
+static void writeFile(const std::string& data)
+{
+  ofstream file(FILENAME, ios::out | ios::binary | ios::trunc);
+  file.write(data.data(), data.size());
+}
+
+// Links the file, walking the frames, and checks where its audio starts.
+static int checkAudioStart(const char* name, const std::string& prefix,
+                           size_t frames)
+{
+  std::string data = prefix;
+  appendFrames(data, frames);
+  writeFile(data);
+
+  ID3_Tag tag;
+  tag.Link(FILENAME, ID3TT_ALL, ID3LO_MP3DURATION);
+  const Mp3_Headerinfo* info = tag.GetMp3HeaderInfo();
+  if (info == NULL)
+  {
+    cerr << "*** " << name << ": no mpeg header found" << endl;
+    return 1;
+  }
+  cout << name << ": audio at " << info->audio_start << ", "
+       << info->frames << " frames" << endl;
+  if (info->audio_start != prefix.size() || info->frames != frames ||
+      info->bitrate != 128000 || info->layer != MPEGLAYER_III)
+  {
+    cerr << "*** " << name << ": expected " << frames << " frames at "
+         << prefix.size() << endl;
+    return 1;
+  }
+  return 0;
+}
+
+static int testSync()
+{
+  int failures = 0;
+
+  // a lone 0xFF, a header with junk where its next frame should be, and
+  // two headers with junk where the third frame should be
+  std::string prefix = junk(5000);
+  prefix[17] = '\xFF';
+  prefix.replace(100, 4, FRAME_HEADER, 4);
+  prefix.replace(2000, 4, FRAME_HEADER, 4);
+  prefix.replace(2000 + FRAME_SIZE, 4, FRAME_HEADER, 4);
+  failures += checkAudioStart("junk", prefix, 20);
+
+  // the first header straddles two blocks of the search
+  failures += checkAudioStart("block edge", junk(8 * 1024 - 2), 20);
+
+  // a wave file holding mpeg audio
+  std::string riff("RIFF");
+  putLE4(riff, 36 + 20 * FRAME_SIZE);
+  riff += "WAVEfmt ";
+  putLE4(riff, 16);
+  riff += std::string("\x55\x00\x02\x00", 4);       // mpeg layer III, stereo
+  putLE4(riff, 44100);
+  putLE4(riff, 16000);
+  riff += std::string("\x01\x00\x00\x00", 4);
+  riff += "data";
+  putLE4(riff, 20 * FRAME_SIZE);
+  failures += checkAudioStart("riff", riff, 20);
+
+  return failures;
+}
+
+static int testDuration()
+{
+  const size_t VBR_FRAMES = 300;
+  std::string data;
+  const size_t audio = appendVbrFrames(data, VBR_FRAMES);
+  // an id3v1 tag, which the walk must stop short of
+  data += "TAG";
+  data.append(125, '\0');
+  writeFile(data);
+
+  const uint32 milliseconds = 7837;     // 300 * 1152 / 44100 seconds
+  const double bitrate = audio * 8 / (VBR_FRAMES * 1152 / 44100.0);
+
+  ID3_Tag tag;
+  tag.Link(FILENAME, ID3TT_ALL, ID3LO_MP3DURATION);
+  const Mp3_Headerinfo* info = tag.GetMp3HeaderInfo();
+  if (info == NULL)
+  {
+    cerr << "*** vbr: no mpeg header found" << endl;
+    return 1;
+  }
+  cout << "vbr: " << info->frames << " frames, " << info->milliseconds
+       << " ms, " << info->avg_bitrate << " bit/s" << endl;
+  if (info->frames != VBR_FRAMES || info->milliseconds != milliseconds ||
+      info->time != 8 || info->audio_start != 0 || info->audio_end != audio ||
+      info->avg_bitrate < bitrate - 1 || info->avg_bitrate > bitrate + 1 ||
+      info->vbr_header != MP3VBRHEADER_NONE)
+  {
+    cerr << "*** vbr: expected " << VBR_FRAMES << " frames, "
+         << milliseconds << " ms, " << bitrate << " bit/s" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// The start of a frame that holds a Xing, Info or VBRI header: the frame
+// header, the crc if there is one, and the side information left zero.
+static std::string headerFrame(bool crc)
+{
+  std::string frame(FRAME_HEADER, 4);
+  if (crc)
+  {
+    frame[1] = '\xFA';
+    frame.append(2, '\0');
+  }
+  frame.append(32, '\0');
+  return frame;
+}
+
+// Pads the frame out, and fills in its crc if it has one.
+static void endHeaderFrame(std::string& frame)
+{
+  frame.resize(FRAME_SIZE, '\0');
+  if (frame[1] == '\xFA')
+  {
+    const uchar* data = reinterpret_cast<const uchar*>(frame.data());
+    uint16 crc = crc16(data + 2, 2, 0xffff);
+    crc = crc16(data + 6, 32, crc);
+    setBE(frame, 4, crc, 2);
+  }
+}
+
+static bool same(float a, float b)
+{
+  return a - b < 0.001f && b - a < 0.001f;
+}
+
+static int testInfoHeader()
+{
+  const size_t FRAMES = 100;
+  const size_t BYTES = (FRAMES + 1) * FRAME_SIZE;
+  std::string data = headerFrame(false);
+  data += "Info";
+  putBE(data, 0x0F, 4);                 // frames, bytes, toc and scale
+  putBE(data, FRAMES, 4);
+  putBE(data, BYTES, 4);
+  for (size_t i = 0; i < 100; ++i)
+  {
+    data += static_cast<char>(i * 256 / 100);
+  }
+  putBE(data, 57, 4);
+
+  std::string lame(36, '\0');
+  lame.replace(0, 9, "LAME3.100");
+  setBE(lame, 11, 0x00400000, 4);       // peak of 0.5
+  setBE(lame, 15, 0x2E41, 2);           // track gain of -6.5dB
+  setBE(lame, 17, 0x4C20, 2);           // album gain of +3.2dB
+  setBE(lame, 21, (576 << 12) | 1234, 3);
+  setBE(lame, 28, BYTES, 4);
+  data += lame;
+  endHeaderFrame(data);
+  appendFrames(data, FRAMES);
+  writeFile(data);
+
+  ID3_Tag tag(FILENAME);
+  const Mp3_Headerinfo* info = tag.GetMp3HeaderInfo();
+  if (info == NULL)
+  {
+    cerr << "*** info: no mpeg header found" << endl;
+    return 1;
+  }
+  cout << "info: " << info->frames << " frames, " << info->milliseconds
+       << " ms, delay " << info->encoder_delay << ", padding "
+       << info->encoder_padding << endl;
+  if (info->vbr_header != MP3VBRHEADER_INFO || info->vbr_frames != FRAMES ||
+      info->vbr_bytes != BYTES || info->vbr_bitrate != 0 ||
+      info->frames != FRAMES || info->milliseconds != 2612 || !info->lame ||
+      info->encoder_delay != 576 || info->encoder_padding != 1234 ||
+      info->music_length != BYTES || !same(info->replaygain_peak, 0.5f) ||
+      !info->has_replaygain_track || !same(info->replaygain_track, -6.5f) ||
+      !info->has_replaygain_album || !same(info->replaygain_album, 3.2f))
+  {
+    cerr << "*** info: the Info header or its LAME extension read wrong"
+         << endl;
+    return 1;
+  }
+  return 0;
+}
+
+static int testVbriHeader()
+{
+  const size_t FRAMES = 100;
+  const size_t FRAMES_PER_ENTRY = 10;
+  std::string audio;
+  const size_t bytes = FRAME_SIZE + appendVbrFrames(audio, FRAMES);
+
+  std::string data = headerFrame(false);
+  data += "VBRI";
+  putBE(data, 1, 2);                    // version
+  putBE(data, 576, 2);                  // delay
+  putBE(data, 75, 2);                   // quality
+  putBE(data, bytes, 4);
+  putBE(data, FRAMES, 4);
+  putBE(data, FRAMES / FRAMES_PER_ENTRY, 2);
+  putBE(data, 1, 2);                    // scale
+  putBE(data, 2, 2);                    // bytes per entry
+  putBE(data, FRAMES_PER_ENTRY, 2);
+  for (size_t i = 0; i < FRAMES; i += FRAMES_PER_ENTRY)
+  {
+    size_t run = 0;
+    for (size_t j = i; j < i + FRAMES_PER_ENTRY; ++j)
+    {
+      run += VBR_SIZES[j % 4];
+    }
+    putBE(data, run, 2);
+  }
+  endHeaderFrame(data);
+  data += audio;
+  writeFile(data);
+
+  ID3_Tag tag(FILENAME);
+  const Mp3_Headerinfo* info = tag.GetMp3HeaderInfo();
+  if (info == NULL)
+  {
+    cerr << "*** vbri: no mpeg header found" << endl;
+    return 1;
+  }
+  cout << "vbri: " << info->frames << " frames, " << info->milliseconds
+       << " ms, " << info->vbr_bitrate << " bit/s" << endl;
+  // an average frame of 577 bytes
+  if (info->vbr_header != MP3VBRHEADER_VBRI || info->vbr_frames != FRAMES ||
+      info->vbr_bytes != bytes || info->encoder_delay != 576 ||
+      info->frames != FRAMES || info->milliseconds != 2612 ||
+      info->vbr_bitrate != 176000 || info->lame)
+  {
+    cerr << "*** vbri: the VBRI header read wrong" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+static int testXingCrc()
+{
+  const size_t FRAMES = 200;
+  std::string audio;
+  const size_t bytes = FRAME_SIZE + appendVbrFrames(audio, FRAMES);
+
+  std::string data = headerFrame(true);
+  data += "Xing";
+  putBE(data, 0x03, 4);                 // frames and bytes
+  putBE(data, FRAMES, 4);
+  putBE(data, bytes, 4);
+  endHeaderFrame(data);
+  data += audio;
+  writeFile(data);
+
+  ID3_Tag tag(FILENAME);
+  const Mp3_Headerinfo* info = tag.GetMp3HeaderInfo();
+  if (info == NULL)
+  {
+    cerr << "*** xing: no mpeg header found" << endl;
+    return 1;
+  }
+  cout << "xing with a crc: " << info->frames << " frames, "
+       << info->milliseconds << " ms, " << info->vbr_bitrate << " bit/s"
+       << endl;
+  // an average frame of 575 bytes
+  if (info->vbr_header != MP3VBRHEADER_XING || info->vbr_frames != FRAMES ||
+      info->vbr_bytes != bytes || info->frames != FRAMES ||
+      info->milliseconds != 5224 || info->vbr_bitrate != 176000 ||
+      info->crc != MP3CRC_OK || info->lame)
+  {
+    cerr << "*** xing: the Xing header behind the crc read wrong" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+// the time into the song of frame k
+static double frameTime(size_t k)
+{
+  return k * 1152 * 1000 / 44100.0;
+}
+
+static bool near(double a, double b, double tolerance)
+{
+  return a - b <= tolerance && b - a <= tolerance;
+}
+
+// Maps the start of every step'th frame to a time and back, then times
+// every 97ms to an offset and back.  The tables of the headers are
+// interpolated, so the times found must be within timeTolerance of the
+// frames' and the round trips must come back to within a millisecond.
+// The frame index gives the indexed frame at or before a time, so the
+// round trips must come back exactly to such a frame.
+static int checkSeek(const char* name, const ID3_Tag& tag,
+                     const std::vector<size_t>& starts, size_t step,
+                     double timeTolerance, bool exact)
+{
+  int failures = 0;
+  const Mp3_Headerinfo* info = tag.GetMp3HeaderInfo();
+  if (info == NULL)
+  {
+    cerr << "*** " << name << ": no mpeg header found" << endl;
+    return 1;
+  }
+  for (size_t k = 0; k < starts.size(); k += step)
+  {
+    uint32 ms = 0;
+    size_t offset = 0;
+    if (!tag.GetMp3Time(starts[k], ms) || !near(ms, frameTime(k), timeTolerance) ||
+        !tag.GetMp3Offset(ms, offset) ||
+        !near(offset, starts[k], exact ? 0 : 32))
+    {
+      cerr << "*** " << name << ": frame " << k << " at " << starts[k]
+           << " maps to " << ms << " ms and back to " << offset << endl;
+      ++failures;
+    }
+  }
+  for (uint32 ms = 0; ms < info->milliseconds; ms += 97)
+  {
+    size_t offset = 0;
+    uint32 back = 0;
+    if (!tag.GetMp3Offset(ms, offset) || !tag.GetMp3Time(offset, back))
+    {
+      cerr << "*** " << name << ": can't seek to " << ms << " ms" << endl;
+      ++failures;
+    }
+    else if (exact ? (back > ms || ms - back >= frameTime(step) + 1 ||
+                      std::find(starts.begin(), starts.end(), offset) == starts.end())
+                   : !near(back, ms, 1))
+    {
+      cerr << "*** " << name << ": " << ms << " ms maps to " << offset
+           << " and back to " << back << " ms" << endl;
+      ++failures;
+    }
+  }
+  cout << name << " seeks: " << (failures ? "wrong" : "ok") << endl;
+  return failures;
+}
+
+static int testSeek()
+{
+  int failures = 0;
+
+  // the starts of the frames appendVbrFrames() writes, after a header frame
+  std::vector<size_t> starts;
+  size_t offset = FRAME_SIZE;
+  for (size_t k = 0; k < 300; ++k)
+  {
+    starts.push_back(offset);
+    offset += VBR_SIZES[k % 4];
+  }
+
+  // a Xing header with a toc: the offset at each percent of the song, in
+  // 256ths of the audio
+  {
+    const size_t FRAMES = 200;
+    std::string audio;
+    const size_t bytes = FRAME_SIZE + appendVbrFrames(audio, FRAMES);
+    std::string data = headerFrame(false);
+    data += "Xing";
+    putBE(data, 0x07, 4);               // frames, bytes and toc
+    putBE(data, FRAMES, 4);
+    putBE(data, bytes, 4);
+    for (size_t i = 0; i < 100; ++i)
+    {
+      data += static_cast<char>(starts[i * FRAMES / 100] * 256 / bytes);
+    }
+    endHeaderFrame(data);
+    writeFile(data + audio);
+
+    ID3_Tag tag(FILENAME);
+    const std::vector<size_t> frames(starts.begin(), starts.begin() + FRAMES);
+    // the toc has a 256th of the audio for its unit, some 450 bytes here
+    failures += checkSeek("xing toc", tag, frames, 2, 30, false);
+  }
+
+  // a VBRI header, whose table has the size of every run of 10 frames
+  {
+    const size_t FRAMES = 100;
+    std::string audio;
+    const size_t bytes = FRAME_SIZE + appendVbrFrames(audio, FRAMES);
+    std::string data = headerFrame(false);
+    data += "VBRI";
+    putBE(data, 1, 2);
+    putBE(data, 0, 4);
+    putBE(data, bytes, 4);
+    putBE(data, FRAMES, 4);
+    putBE(data, FRAMES / 10, 2);
+    putBE(data, 1, 2);
+    putBE(data, 2, 2);
+    putBE(data, 10, 2);
+    for (size_t i = 0; i < FRAMES; i += 10)
+    {
+      putBE(data, starts[i + 10] - starts[i], 2);
+    }
+    endHeaderFrame(data);
+    writeFile(data + audio);
+
+    ID3_Tag tag(FILENAME);
+    const std::vector<size_t> frames(starts.begin(), starts.begin() + FRAMES);
+    failures += checkSeek("vbri table", tag, frames, 10, 1, false);
+  }
+
+  // no header, but every 32nd frame indexed by walking the frames
+  {
+    const size_t FRAMES = 300;
+    std::string data;
+    appendVbrFrames(data, FRAMES);
+    writeFile(data);
+
+    ID3_Tag tag;
+    tag.Link(FILENAME, ID3TT_ALL, ID3LO_MP3DURATION);
+    std::vector<size_t> frames;
+    for (size_t k = 0; k < FRAMES; ++k)
+    {
+      frames.push_back(starts[k] - FRAME_SIZE);
+    }
+    failures += checkSeek("frame index", tag, frames, 32, 0.5, true);
+  }
+  return failures;
+}
+
+struct KnownHeader
+{
+  uint32 header;
+  Mpeg_Version version;
+  Mpeg_Layers layer;
+  Mp3_ChannelMode channelmode;
+  uint32 bitrate;
+  uint32 frequency;
+  uint32 framesize;
+  uint32 samples;
+  uint32 sideinfo;
+  bool crc;
+  bool padding;
+};
+
+static const KnownHeader KNOWN_HEADERS[] =
+{
+  { 0xFFFFC000, MPEGVERSION_1, MPEGLAYER_I, MP3CHANNELMODE_STEREO,
+    384000, 44100, 416, 384, 0, false, false },
+  { 0xFFFDA440, MPEGVERSION_1, MPEGLAYER_II, MP3CHANNELMODE_JOINT_STEREO,
+    192000, 48000, 576, 1152, 0, false, false },
+  { 0xFFFA92C0, MPEGVERSION_1, MPEGLAYER_III, MP3CHANNELMODE_SINGLE_CHANNEL,
+    128000, 44100, 418, 1152, 17, true, true },
+  { 0xFFF78000, MPEGVERSION_2, MPEGLAYER_I, MP3CHANNELMODE_STEREO,
+    128000, 22050, 276, 384, 0, false, false },
+  { 0xFFF58480, MPEGVERSION_2, MPEGLAYER_II, MP3CHANNELMODE_DUAL_CHANNEL,
+    64000, 24000, 384, 1152, 0, false, false },
+  { 0xFFF38800, MPEGVERSION_2, MPEGLAYER_III, MP3CHANNELMODE_STEREO,
+    64000, 16000, 288, 576, 17, false, false },
+  { 0xFFE74000, MPEGVERSION_2_5, MPEGLAYER_I, MP3CHANNELMODE_STEREO,
+    64000, 11025, 276, 384, 0, false, false },
+  { 0xFFE42400, MPEGVERSION_2_5, MPEGLAYER_II, MP3CHANNELMODE_STEREO,
+    16000, 12000, 192, 1152, 0, true, false },
+  { 0xFFE31AC0, MPEGVERSION_2_5, MPEGLAYER_III, MP3CHANNELMODE_SINGLE_CHANNEL,
+    8000, 8000, 73, 576, 9, false, true },
+  // free format
+  { 0xFFFB0000, MPEGVERSION_1, MPEGLAYER_III, MP3CHANNELMODE_STEREO,
+    0, 44100, 0, 1152, 32, false, false }
+};
+
+static const uint32 BAD_HEADERS[] =
+{
+  0xFF7B9000,           // no sync
+  0xFFEB9000,           // reserved version
+  0xFFF99000,           // reserved layer
+  0xFFFBF000,           // bad bitrate
+  0xFFFB9C00            // reserved sample rate
+};
+
+static int testHeaders()
+{
+  int failures = 0;
+  for (size_t i = 0; i < sizeof(KNOWN_HEADERS) / sizeof(KNOWN_HEADERS[0]); ++i)
+  {
+    const KnownHeader& known = KNOWN_HEADERS[i];
+    Mp3_FrameHeader frame;
+    const bool decoded = ID3_DecodeMp3Header(known.header, &frame);
+    if (!decoded || frame.version != known.version ||
+        frame.layer != known.layer || frame.channelmode != known.channelmode ||
+        frame.bitrate != known.bitrate || frame.frequency != known.frequency ||
+        frame.framesize != known.framesize || frame.samples != known.samples ||
+        frame.sideinfo != known.sideinfo || frame.crc != known.crc ||
+        frame.padding != known.padding)
+    {
+      cerr << "*** header " << std::hex << known.header << std::dec
+           << " decoded wrong: " << frame.bitrate << " bit/s, "
+           << frame.frequency << " Hz, " << frame.framesize << " bytes"
+           << endl;
+      ++failures;
+    }
+  }
+  for (size_t i = 0; i < sizeof(BAD_HEADERS) / sizeof(BAD_HEADERS[0]); ++i)
+  {
+    Mp3_FrameHeader frame;
+    if (ID3_DecodeMp3Header(BAD_HEADERS[i], &frame) ||
+        ID3_DecodeMp3Header(BAD_HEADERS[i], NULL))
+    {
+      cerr << "*** header " << std::hex << BAD_HEADERS[i] << std::dec
+           << " decoded" << endl;
+      ++failures;
+    }
+  }
+  cout << "headers: " << (failures ? "wrong" : "ok") << endl;
+  return failures;
+}
+
+int main()
+{
+  int failures = 0;
+  failures += testSync();
+  failures += testHeaders();
+  failures += testDuration();
+  failures += testInfoHeader();
+  failures += testVbriHeader();
+  failures += testXingCrc();
+  failures += testSeek();
+
+  remove(FILENAME);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+// $Id$
+
+// Links a tag with ID3LO_PICTUREOFFSETS and checks that the picture data is
+// found in the file where the tag says it is, that it is read in when it is
+// asked for, and that it survives the tag being rewritten or stripped.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-pic-offsets.tag";
+// small enough for the frame size to read the same in any id3v2 version
+static const size_t PICTURE_SIZE = 100;
+
+static void makePicture(uchar picture[PICTURE_SIZE])
+{
+  for (size_t i = 0; i < PICTURE_SIZE; ++i)
+  {
+    picture[i] = static_cast<uchar>(i * 7 + 1);
+  }
+}
+
+static void writeTag()
+{
+  ofstream file(FILENAME, ios::out | ios::binary | ios::trunc);
+  file.close();
+
+  uchar picture[PICTURE_SIZE];
+  makePicture(picture);
+
+  ID3_Tag tag(FILENAME);
+  ID3_AddTitle(&tag, "Title", true);
+  ID3_Frame* frame = new ID3_Frame(ID3FID_PICTURE);
+  frame->GetField(ID3FN_MIMETYPE)->Set("image/png");
+  frame->GetField(ID3FN_PICTURETYPE)->Set(ID3PT_COVERFRONT);
+  frame->GetField(ID3FN_DESCRIPTION)->Set("Cover");
+  frame->GetField(ID3FN_DATA)->Set(picture, PICTURE_SIZE);
+  tag.AttachFrame(frame);
+  tag.Update(ID3TT_ID3V2);
+}
+
+// Is the picture, loaded or not, the one writeTag() wrote?
+static bool pictureIntact(ID3_Tag& tag)
+{
+  uchar expected[PICTURE_SIZE], picture[PICTURE_SIZE];
+  makePicture(expected);
+  ID3_Frame* frame = tag.Find(ID3FID_PICTURE);
+  return frame != NULL &&
+         frame->GetField(ID3FN_DATA)->Size() == PICTURE_SIZE &&
+         frame->GetField(ID3FN_DATA)->Get(picture, PICTURE_SIZE) == PICTURE_SIZE &&
+         memcmp(picture, expected, PICTURE_SIZE) == 0;
+}
+
+int main()
+{
+  int failures = 0;
+  writeTag();
+  {
+    ID3_Tag tag;
+    tag.Link(FILENAME, ID3TT_ALL, ID3LO_PICTUREOFFSETS);
+    const uchar* data = NULL;
+    size_t start = 0;
+    size_t size = ID3_GetPictureDataOfPicTypeAndStartPosition(&tag, data, start,
+                                                              ID3PT_COVERFRONT);
+    cout << "picture at " << start << ", " << size << " bytes" << endl;
+
+    // the data is left in the file, where the tag says it is
+    uchar expected[PICTURE_SIZE], picture[PICTURE_SIZE];
+    makePicture(expected);
+    ifstream file(FILENAME, ios::in | ios::binary);
+    file.seekg(start);
+    file.read(reinterpret_cast<char*>(picture), PICTURE_SIZE);
+    if (data != NULL || size != PICTURE_SIZE || !file ||
+        memcmp(picture, expected, PICTURE_SIZE) != 0)
+    {
+      cerr << "*** expected the picture to be left in the file" << endl;
+      ++failures;
+    }
+
+    char* mimetype = ID3_GetMimeTypeOfPicType(&tag, ID3PT_COVERFRONT);
+    if (!mimetype || strcmp(mimetype, "image/png") != 0)
+    {
+      cerr << "*** expected the picture's other fields to be parsed" << endl;
+      ++failures;
+    }
+    ID3_FreeString(mimetype);
+
+    // growing the tag moves the picture; it has to be read in first
+    ID3_AddTitle(&tag, "A title long enough to need more room than there is"
+                 " padding for, so that the tag has to be rewritten", true);
+    tag.Update(ID3TT_ID3V2);
+  }
+  {
+    ID3_Tag tag(FILENAME);
+    if (!pictureIntact(tag))
+    {
+      cerr << "*** picture lost by an update" << endl;
+      ++failures;
+    }
+  }
+  {
+    // stripping the tag takes the picture with it, unless it's read in
+    ID3_Tag tag;
+    tag.Link(FILENAME, ID3TT_ALL, ID3LO_PICTUREOFFSETS);
+    tag.Strip(ID3TT_ID3V2);
+    tag.Update(ID3TT_ID3V2);
+  }
+  {
+    ID3_Tag tag(FILENAME);
+    if (!pictureIntact(tag))
+    {
+      cerr << "*** picture lost by a strip" << endl;
+      ++failures;
+    }
+  }
+
+  remove(FILENAME);
+  return failures;
+}
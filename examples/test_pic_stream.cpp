@@ -0,0 +1,123 @@
+// $Id$
+
+// Attaches a picture from a file descriptor, so that it is only read when
+// the tag is written, then streams it back out to a descriptor and to a
+// file, both from memory and straight from the tagged file.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-pic-stream.tag";
+static const char* PICNAME = "test-pic-stream.pic";
+static const char* OUTNAME = "test-pic-stream.out";
+static const size_t PICTURE_SIZE = 100000;
+
+static void makePicture(uchar picture[PICTURE_SIZE])
+{
+  for (size_t i = 0; i < PICTURE_SIZE; ++i)
+  {
+    picture[i] = static_cast<uchar>(i * 7 + i / 256);
+  }
+}
+
+// Is the file name just the picture, after skip bytes of something else?
+static bool holdsPicture(const char* name, size_t skip = 0)
+{
+  static uchar expected[PICTURE_SIZE], picture[PICTURE_SIZE + 1];
+  makePicture(expected);
+  ifstream file(name, ios::in | ios::binary);
+  file.seekg(skip);
+  file.read(reinterpret_cast<char*>(picture), PICTURE_SIZE + 1);
+  return file.gcount() == static_cast<std::streamsize>(PICTURE_SIZE) &&
+         memcmp(picture, expected, PICTURE_SIZE) == 0;
+}
+
+// Streams the picture to OUTNAME, behind a prefix, through a descriptor
+static bool streamsPicture(ID3_Tag& tag)
+{
+  int fd = open(OUTNAME, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  write(fd, "prefix", 6);
+  size_t size = ID3_GetPictureDataOfPicTypeToFd(&tag, fd, ID3PT_COVERFRONT);
+  bool positioned = lseek(fd, 0, SEEK_CUR) == static_cast<off_t>(6 + size);
+  close(fd);
+  return size == PICTURE_SIZE && positioned && holdsPicture(OUTNAME, 6);
+}
+
+int main()
+{
+  int failures = 0;
+  {
+    static uchar picture[PICTURE_SIZE];
+    makePicture(picture);
+    ofstream pic(PICNAME, ios::out | ios::binary | ios::trunc);
+    pic.write(reinterpret_cast<char*>(picture), PICTURE_SIZE);
+    ofstream file(FILENAME, ios::out | ios::binary | ios::trunc);
+  }
+
+  {
+    // the picture is only read when the tag is written
+    int fd = open(PICNAME, O_RDONLY);
+    ID3_Tag tag(FILENAME);
+    ID3_AddTitle(&tag, "Title", true);
+    ID3_Frame* frame = ID3_AttachPicture(&tag, fd, "image/png",
+                                         ID3PT_COVERFRONT, "Cover");
+    if (!frame || frame->GetField(ID3FN_DATA)->GetRawBinary() != NULL ||
+        frame->GetField(ID3FN_DATA)->Size() != PICTURE_SIZE)
+    {
+      cerr << "*** expected the picture to be attached, not read in" << endl;
+      ++failures;
+    }
+    tag.Update(ID3TT_ID3V2);
+    close(fd);
+  }
+
+  {
+    // from memory
+    ID3_Tag tag(FILENAME);
+    if (!streamsPicture(tag))
+    {
+      cerr << "*** expected the attached picture to be written" << endl;
+      ++failures;
+    }
+  }
+
+  {
+    // straight from the tagged file
+    ID3_Tag tag;
+    tag.Link(FILENAME, ID3TT_ALL, ID3LO_PICTUREOFFSETS);
+    if (!streamsPicture(tag))
+    {
+      cerr << "*** expected the picture to be copied from the file" << endl;
+      ++failures;
+    }
+    remove(OUTNAME);
+    ID3_GetPictureDataOfPicType(&tag, OUTNAME, ID3PT_COVERFRONT);
+    if (!holdsPicture(OUTNAME) ||
+        tag.Find(ID3FID_PICTURE)->GetField(ID3FN_DATA)->GetRawBinary() != NULL)
+    {
+      cerr << "*** expected the picture to be copied without reading it in"
+           << endl;
+      ++failures;
+    }
+  }
+  cout << (failures ? "failed" : "passed") << endl;
+
+  remove(FILENAME);
+  remove(PICNAME);
+  remove(OUTNAME);
+  return failures;
+}
@@ -0,0 +1,135 @@
+// $Id$
+
+// Writes a tag with text lists, in latin-1 and in utf-16, and a picture, and
+// checks that the C api hands them back as they are kept, item by item,
+// without copying them.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "id3.h"
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-raw-view.tag";
+static const uchar PICTURE[] = { 1, 2, 3, 0, 0, 6, 7, 8 };
+
+static void writeTag()
+{
+  ofstream file(FILENAME, ios::out | ios::binary | ios::trunc);
+  file.close();
+
+  ID3_Tag tag(FILENAME);
+  ID3_Frame* frame = new ID3_Frame(ID3FID_COMPOSER);
+  ID3_Field* fld = frame->GetField(ID3FN_TEXT);
+  fld->Set("one");
+  fld->Add("");
+  fld->Add("three");
+  tag.AttachFrame(frame);
+
+  const unicode_t first[] = { 'A', 0x0142, 0 };
+  const unicode_t second[] = { 'b', 'c', 0 };
+  frame = new ID3_Frame(ID3FID_LYRICIST);
+  frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  fld = frame->GetField(ID3FN_TEXT);
+  fld->SetEncoding(ID3TE_UTF16);
+  fld->Set(first);
+  fld->Add(second);
+  tag.AttachFrame(frame);
+
+  frame = new ID3_Frame(ID3FID_PICTURE);
+  frame->GetField(ID3FN_MIMETYPE)->Set("image/png");
+  frame->GetField(ID3FN_PICTURETYPE)->Set(ID3PT_COVERFRONT);
+  frame->GetField(ID3FN_DATA)->Set(PICTURE, sizeof(PICTURE));
+  tag.AttachFrame(frame);
+  tag.Update(ID3TT_ID3V2);
+}
+
+static int check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    cerr << "*** wrong " << what << endl;
+  }
+  return ok ? 0 : 1;
+}
+
+static const ID3Field* findField(ID3Tag* tag, ID3_FrameID id, ID3_FieldID fld)
+{
+  return ID3Frame_GetField(ID3Tag_FindFrameWithID(tag, id), fld);
+}
+
+// Does the next item hold size bytes of data?
+static bool nextItem(ID3_TextItemIterator* iter, const void* data, size_t size)
+{
+  size_t itemSize = 0;
+  const uchar* item = ID3TextItemIterator_GetNext(iter, &itemSize);
+  return item != NULL && itemSize == size && memcmp(item, data, size) == 0;
+}
+
+int main()
+{
+  writeTag();
+
+  int failures = 0;
+  ID3Tag* tag = ID3Tag_New();
+  ID3Tag_LinkWithFlags(tag, FILENAME, ID3TT_ALL | ID3LO_PICTUREOFFSETS);
+
+  const ID3Field* fld = findField(tag, ID3FID_COMPOSER, ID3FN_TEXT);
+  size_t size = 0;
+  ID3_TextEnc enc = ID3TE_NONE;
+  const uchar* data = ID3Field_GetRawView(fld, &size, &enc);
+  failures += check(data != NULL && enc == ID3TE_ISO8859_1 &&
+                    size == 10 && memcmp(data, "one\0\0three", 10) == 0,
+                    "latin-1 view");
+
+  ID3_TextItemIterator iter;
+  failures += check(ID3Field_GetTextItems(fld, &iter), "latin-1 items");
+  failures += check(nextItem(&iter, "one", 3), "first latin-1 item");
+  failures += check(nextItem(&iter, "", 0), "second latin-1 item");
+  failures += check(nextItem(&iter, "three", 5), "third latin-1 item");
+  failures += check(ID3TextItemIterator_GetNext(&iter, &size) == NULL,
+                    "end of latin-1 items");
+
+  fld = findField(tag, ID3FID_LYRICIST, ID3FN_TEXT);
+  data = ID3Field_GetRawView(fld, &size, &enc);
+  failures += check(data != NULL && enc == ID3TE_UTF16 && size == 10,
+                    "utf-16 view");
+  const unicode_t first[] = { 'A', 0x0142 };
+  const unicode_t second[] = { 'b', 'c' };
+  failures += check(ID3Field_GetTextItems(fld, &iter), "utf-16 items");
+  failures += check(nextItem(&iter, first, sizeof(first)), "first utf-16 item");
+  failures += check(nextItem(&iter, second, sizeof(second)),
+                    "second utf-16 item");
+  failures += check(ID3TextItemIterator_GetNext(&iter, &size) == NULL,
+                    "end of utf-16 items");
+
+  // the picture is read in from the file, once
+  fld = findField(tag, ID3FID_PICTURE, ID3FN_DATA);
+  data = ID3Field_GetRawView(fld, &size, &enc);
+  failures += check(data != NULL && enc == ID3TE_NONE &&
+                    size == sizeof(PICTURE) &&
+                    memcmp(data, PICTURE, sizeof(PICTURE)) == 0, "picture view");
+  failures += check(ID3Field_GetRawView(fld, &size, &enc) == data,
+                    "second picture view");
+  failures += check(!ID3Field_GetTextItems(fld, &iter) &&
+                    ID3TextItemIterator_GetNext(&iter, &size) == NULL,
+                    "items of a picture");
+
+  fld = findField(tag, ID3FID_PICTURE, ID3FN_PICTURETYPE);
+  failures += check(ID3Field_GetRawView(fld, &size, &enc) == NULL && size == 0,
+                    "integer view");
+  cout << (failures ? "failed" : "passed") << endl;
+
+  ID3Tag_Delete(tag);
+  remove(FILENAME);
+  return failures;
+}
@@ -0,0 +1,194 @@
+// $Id$
+
+// Writes a small tree of tagged files, scans it on several threads, both a
+// file at a time and in batches, and checks that every file is handed over
+// once, with the right frames, and that a file that isn't there is reported
+// as an error.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/scanner.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* ROOT = "test-scanner.dir";
+static const size_t NUM_DIRS = 4;
+static const size_t FILES_PER_DIR = 25;
+// every so often a file gets a picture, to make its tag bigger than the
+// first read of a batch
+static const size_t PICTURE_EVERY = 5;
+static const size_t PICTURE_SIZE = 40000;
+
+static dami::String fileName(size_t dir, size_t file)
+{
+  char name[64];
+  sprintf(name, "%s/%lu/song%lu.MP3", ROOT, static_cast<unsigned long>(dir),
+          static_cast<unsigned long>(file));
+  return name;
+}
+
+static dami::String titleOf(const char* path)
+{
+  return dami::String("Title of ") + path;
+}
+
+static void writeFile(const dami::String& path, bool picture)
+{
+  {
+    ofstream file(path.c_str(), ios::out | ios::binary | ios::trunc);
+    file << "not really audio";
+  }
+  ID3_Tag tag(path.c_str());
+  ID3_AddTitle(&tag, titleOf(path.c_str()).c_str(), true);
+  if (picture)
+  {
+    std::vector<uchar> data(PICTURE_SIZE, 0x55);
+    ID3_Frame* frame = new ID3_Frame(ID3FID_PICTURE);
+    frame->GetField(ID3FN_MIMETYPE)->Set("image/png");
+    frame->GetField(ID3FN_DATA)->Set(&data[0], data.size());
+    tag.AttachFrame(frame);
+  }
+  tag.Update(ID3TT_ID3V2 | ID3TT_ID3V1);
+}
+
+static void makeTree()
+{
+  mkdir(ROOT, 0755);
+  for (size_t d = 0; d < NUM_DIRS; ++d)
+  {
+    char dir[64];
+    sprintf(dir, "%s/%lu", ROOT, static_cast<unsigned long>(d));
+    mkdir(dir, 0755);
+    for (size_t f = 0; f < FILES_PER_DIR; ++f)
+    {
+      writeFile(fileName(d, f), f % PICTURE_EVERY == 0);
+    }
+  }
+  // not one of ours
+  ofstream other((dami::String(ROOT) + "/0/notes.txt").c_str());
+  other << "not a song" << endl;
+}
+
+static void removeTree()
+{
+  for (size_t d = 0; d < NUM_DIRS; ++d)
+  {
+    for (size_t f = 0; f < FILES_PER_DIR; ++f)
+    {
+      remove(fileName(d, f).c_str());
+    }
+    char dir[64];
+    sprintf(dir, "%s/%lu", ROOT, static_cast<unsigned long>(d));
+    if (d == 0)
+    {
+      remove((dami::String(dir) + "/notes.txt").c_str());
+    }
+    rmdir(dir);
+  }
+  rmdir(ROOT);
+}
+
+class Checker : public ID3_Scanner::Handler
+{
+public:
+  Checker(size_t files) : seen(files, 0), wrong(0), errors(0) { ; }
+
+  void Scanned(const ID3_ScanResult& result)
+  {
+    if (result.index >= seen.size())
+    {
+      ++wrong;
+      return;
+    }
+    ++seen[result.index];
+    if (result.error)
+    {
+      ++errors;
+      return;
+    }
+    const ID3_Frame* title = result.numFrames == 2 ? result.frames[0] : NULL;
+    if (!result.tag || !title || result.frames[1] != NULL ||
+        title->GetField(ID3FN_TEXT)->GetText() != titleOf(result.path) ||
+        !result.tag->HasV1Tag())
+    {
+      ++wrong;
+      return;
+    }
+    const ID3_Frame* picture = result.tag->FindFirst(ID3FID_PICTURE);
+    if (picture && picture->GetField(ID3FN_DATA)->Size() != PICTURE_SIZE)
+    {
+      ++wrong;
+    }
+  }
+
+  std::vector<size_t> seen;
+  size_t wrong;
+  size_t errors;
+};
+
+static int scan(ID3_Scanner& scanner, size_t added, size_t batch)
+{
+  scanner.SetBatchSize(batch);
+  Checker checker(scanner.NumFiles());
+  const size_t scanned = scanner.Scan(checker);
+
+  int failures = 0;
+  if (added != NUM_DIRS * FILES_PER_DIR || scanned != added)
+  {
+    cerr << "*** added " << added << " files and scanned " << scanned << endl;
+    ++failures;
+  }
+  for (size_t i = 0; i < checker.seen.size(); ++i)
+  {
+    if (checker.seen[i] != 1)
+    {
+      cerr << "*** file " << i << " handed over " << checker.seen[i]
+           << " times" << endl;
+      ++failures;
+    }
+  }
+  if (checker.wrong != 0 || checker.errors != 1)
+  {
+    cerr << "*** " << checker.wrong << " wrong results and " << checker.errors
+         << " errors, batches of " << batch << endl;
+    ++failures;
+  }
+  return failures;
+}
+
+int main()
+{
+  makeTree();
+
+  ID3_Scanner scanner;
+  const size_t added = scanner.AddDirectory(ROOT);
+  scanner.AddFile("test-scanner.missing");
+  scanner.SelectFrame(ID3FID_TITLE);
+  scanner.SelectFrame(ID3FID_ALBUM);
+  scanner.SetThreads(4);
+
+  int failures = 0;
+  scanner.SetLinkOptions(ID3LO_TAGSONLY);
+  failures += scan(scanner, added, 0);
+  failures += scan(scanner, added, 7);
+  // the pictures are left in the files, and read from there
+  scanner.SetLinkOptions(ID3LO_PICTUREOFFSETS);
+  failures += scan(scanner, added, 0);
+  failures += scan(scanner, added, 7);
+  cout << (failures ? "failed" : "passed") << endl;
+
+  removeTree();
+  return failures;
+}
@@ -0,0 +1,142 @@
+// $Id$
+
+// Fills an involved people list with a few thousand names, in latin-1 and in
+// utf-16, and checks that every item comes back whole and in order, both
+// straight away and after the tag has been written and read back.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-text-items.tag";
+static const size_t NUM_ITEMS = 4000;
+
+// The i-th name, in the field's encoding
+static dami::String itemText(size_t i, ID3_TextEnc enc)
+{
+  char name[32];
+  sprintf(name, "Person %lu", static_cast<unsigned long>(i));
+  dami::String text;
+  for (const char* p = name; *p; ++p)
+  {
+    if (enc == ID3TE_UTF16)
+    {
+      unicode_t ch = *p;
+      text.append(reinterpret_cast<const char*>(&ch), sizeof(ch));
+    }
+    else
+    {
+      text += *p;
+    }
+  }
+  return text;
+}
+
+static void fillField(ID3_Field* fld, ID3_TextEnc enc)
+{
+  fld->SetEncoding(enc);
+  for (size_t i = 0; i < NUM_ITEMS; ++i)
+  {
+    fld->SetText(itemText(i, enc), i, enc);
+  }
+}
+
+// Does the field hold the names, first with GetRawTextItem() and then with
+// an ItemIterator?  first is what item 0 should be.
+static bool holdsItems(const ID3_Field* fld, ID3_TextEnc enc,
+                       const dami::String& first)
+{
+  if (fld->GetNumTextItems() != NUM_ITEMS)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < NUM_ITEMS; ++i)
+  {
+    dami::String expected = i ? itemText(i, enc) : first;
+    size_t size = 0;
+    const char* item = fld->GetRawTextItem(i, size);
+    if (!item || dami::String(item, size) != expected)
+    {
+      return false;
+    }
+  }
+  ID3_Field::ItemIterator iter(*fld);
+  size_t i = 0, size = 0;
+  for (const char* item; (item = iter.GetNext(size)) != NULL; ++i)
+  {
+    if (dami::String(item, size) != (i ? itemText(i, enc) : first))
+    {
+      return false;
+    }
+  }
+  return i == NUM_ITEMS;
+}
+
+int main()
+{
+  int failures = 0;
+  const ID3_TextEnc encodings[] = { ID3TE_ISO8859_1, ID3TE_UTF16 };
+  for (size_t e = 0; e < sizeof(encodings) / sizeof(encodings[0]); ++e)
+  {
+    const ID3_TextEnc enc = encodings[e];
+    {
+      ofstream file(FILENAME, ios::out | ios::binary | ios::trunc);
+    }
+    {
+      ID3_Tag tag(FILENAME);
+      ID3_Frame* frame = new ID3_Frame(ID3FID_INVOLVEDPEOPLE);
+      frame->GetField(ID3FN_TEXTENC)->Set(enc);
+      ID3_Field* fld = frame->GetField(ID3FN_TEXT);
+      fillField(fld, enc);
+      if (!holdsItems(fld, enc, itemText(0, enc)))
+      {
+        cerr << "*** wrong items as added, encoding " << enc << endl;
+        ++failures;
+      }
+
+      // replacing an item leaves the others be
+      fld->SetText(itemText(NUM_ITEMS, enc), 0, enc);
+      if (!holdsItems(fld, enc, itemText(NUM_ITEMS, enc)))
+      {
+        cerr << "*** wrong items after a replace, encoding " << enc << endl;
+        ++failures;
+      }
+      tag.AttachFrame(frame);
+      tag.Update(ID3TT_ID3V2);
+    }
+    {
+      ID3_Tag tag(FILENAME);
+      ID3_Frame* frame = tag.Find(ID3FID_INVOLVEDPEOPLE);
+      ID3_Field* fld = frame ? frame->GetField(ID3FN_TEXT) : NULL;
+      if (!fld || !holdsItems(fld, enc, itemText(NUM_ITEMS, enc)))
+      {
+        cerr << "*** wrong items read back, encoding " << enc << endl;
+        ++failures;
+        continue;
+      }
+
+      // setting the text starts the list over
+      fld->Set("Nobody");
+      size_t size = 0;
+      if (fld->GetNumTextItems() != 1 || fld->GetRawTextItem(1, size) != NULL)
+      {
+        cerr << "*** expected a single item after a set" << endl;
+        ++failures;
+      }
+    }
+  }
+  cout << (failures ? "failed" : "passed") << endl;
+
+  remove(FILENAME);
+  return failures;
+}
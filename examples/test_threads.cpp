@@ -0,0 +1,163 @@
+// $Id$
+
+// Has many threads look things up in one shared tag at once, through the
+// lookups that keep no state in the tag, and checks that they all see the
+// same thing.  Build it with -fsanitize=thread to have the reads checked
+// for races too.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#if defined(HAVE_PTHREAD_H)
+# include <pthread.h>
+#endif
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const size_t NUM_THREADS = 8;
+static const size_t NUM_ROUNDS = 2000;
+static const size_t NUM_COMMENTS = 50;
+
+static void makeTag(ID3_Tag& tag)
+{
+  ID3_AddTitle(&tag, "Title", true);
+  ID3_AddArtist(&tag, "Artist", true);
+  for (size_t i = 0; i < NUM_COMMENTS; ++i)
+  {
+    char desc[32];
+    sprintf(desc, "Comment %lu", static_cast<unsigned long>(i));
+    ID3_AddComment(&tag, "Some text", desc, false);
+  }
+  ID3_Frame* frame = new ID3_Frame(ID3FID_INVOLVEDPEOPLE);
+  ID3_Field* fld = frame->GetField(ID3FN_TEXT);
+  fld->Set("Producer");
+  fld->Add("Someone");
+  tag.AttachFrame(frame);
+}
+
+// One reader's worth of lookups; returns the number that came out wrong
+static size_t readTag(const ID3_Tag& tag)
+{
+  size_t failures = 0;
+  std::vector<ID3_Frame*> frames;
+  for (size_t round = 0; round < NUM_ROUNDS; ++round)
+  {
+    const ID3_Frame* frame = tag.FindFirst(ID3FID_TITLE);
+    if (!frame || frame->GetField(ID3FN_TEXT)->GetText() != "Title")
+    {
+      ++failures;
+    }
+
+    char desc[32];
+    sprintf(desc, "Comment %lu",
+            static_cast<unsigned long>(round % NUM_COMMENTS));
+    frame = tag.FindFirst(ID3FID_COMMENT, ID3FN_DESCRIPTION, desc);
+    if (!frame || frame->GetField(ID3FN_DESCRIPTION)->GetText() != desc)
+    {
+      ++failures;
+    }
+
+    frames.clear();
+    if (tag.FindAll(ID3FID_COMMENT, frames) != NUM_COMMENTS)
+    {
+      ++failures;
+    }
+
+    size_t numFrames = 0;
+    ID3_Tag::ConstIterator* iter = tag.CreateIterator();
+    while (iter->GetNext() != NULL)
+    {
+      ++numFrames;
+    }
+    delete iter;
+    if (numFrames != tag.NumFrames())
+    {
+      ++failures;
+    }
+
+    size_t size = 0;
+    frame = tag.FindFirst(ID3FID_INVOLVEDPEOPLE);
+    const char* item = frame ?
+      frame->GetField(ID3FN_TEXT)->GetRawTextItem(1, size) : NULL;
+    if (!item || size != 7 || strncmp(item, "Someone", size) != 0)
+    {
+      ++failures;
+    }
+
+    char* artist = ID3_GetArtist(&tag);
+    if (!artist || strcmp(artist, "Artist") != 0)
+    {
+      ++failures;
+    }
+    ID3_FreeString(artist);
+  }
+  return failures;
+}
+
+struct Reader
+{
+  const ID3_Tag* tag;
+  size_t failures;
+};
+
+static void* runReader(void* arg)
+{
+  Reader* reader = static_cast<Reader*>(arg);
+  reader->failures = readTag(*reader->tag);
+  return NULL;
+}
+
+int main()
+{
+  ID3_Tag tag;
+  makeTag(tag);
+
+  Reader readers[NUM_THREADS];
+  size_t numReaders = 0;
+#if defined(HAVE_PTHREAD_H)
+  pthread_t threads[NUM_THREADS];
+  for (; numReaders < NUM_THREADS; ++numReaders)
+  {
+    readers[numReaders].tag = &tag;
+    readers[numReaders].failures = 0;
+    if (pthread_create(&threads[numReaders], NULL, runReader,
+                       &readers[numReaders]) != 0)
+    {
+      break;
+    }
+  }
+  for (size_t i = 0; i < numReaders; ++i)
+  {
+    pthread_join(threads[i], NULL);
+  }
+#endif
+  if (numReaders == 0)
+  {
+    // no threads to be had: one reader, for the results at least
+    readers[0].tag = &tag;
+    runReader(&readers[0]);
+    numReaders = 1;
+  }
+
+  size_t failures = 0;
+  for (size_t i = 0; i < numReaders; ++i)
+  {
+    failures += readers[i].failures;
+  }
+  cout << numReaders << " reader(s), " << failures << " wrong lookups" << endl;
+  if (failures > 0)
+  {
+    cerr << "*** expected every reader to see the same tag" << endl;
+  }
+  return failures > 0 ? 1 : 0;
+}
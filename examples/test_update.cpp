@@ -0,0 +1,334 @@
+// $Id$
+
+// Checks that in-place updates, through ID3_Tag::Update(), the v1-only path
+// and edit sessions, write to the file that is already there and touch only
+// the bytes of the tags they update.  A stream opened on the file beforehand
+// has to see the changes, so a rewrite of the file shows up as a failure.
+// Also checks that an ID3_FDWriter gathers a rendering into one write made
+// at flush(), and that updates of an appended tag leave the audio where it
+// is.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+#include "id3/writers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-update.tag";
+static const char* APPENDED_FILENAME = "test-update-appended.tag";
+static const char* RENDER_FILENAME = "test-update-render.tag";
+
+// Reads the whole of a stream that was opened before the file was updated.
+static std::string contents(ifstream& file)
+{
+  file.clear();
+  file.seekg(0, ios::beg);
+  std::string data;
+  char buf[4096];
+  while (file.read(buf, sizeof(buf)) || file.gcount() > 0)
+  {
+    data.append(buf, file.gcount());
+  }
+  return data;
+}
+
+// Are before and after the same size and the same outside of [beg, end)?
+static bool sameOutside(const std::string& before, const std::string& after,
+                        size_t beg, size_t end)
+{
+  return before.size() == after.size() &&
+         before.compare(0, beg, after, 0, beg) == 0 &&
+         before.compare(end, std::string::npos, after, end, 
+                        std::string::npos) == 0;
+}
+
+// Passes everything through to another writer, counting the calls made.
+class CallCountingWriter : public ID3_Writer
+{
+  ID3_Writer& _writer;
+  size_t _calls;
+ public:
+  CallCountingWriter(ID3_Writer& writer) : _writer(writer), _calls(0) { ; }
+
+  size_t getCalls() const { return _calls; }
+
+  void close() { _writer.close(); }
+  void flush() { _writer.flush(); }
+  pos_type getCur() { return _writer.getCur(); }
+
+  size_type writeChars(const char_type buf[], size_type len)
+  {
+    ++_calls;
+    return _writer.writeChars(buf, len);
+  }
+  size_type writeChars(const char buf[], size_type len)
+  {
+    return this->writeChars(reinterpret_cast<const char_type *>(buf), len);
+  }
+  size_type writeZeros(size_type len)
+  {
+    ++_calls;
+    return _writer.writeZeros(len);
+  }
+};
+
+// five seconds of silent MPEG-1 layer III, 128kbit/s at 44.1kHz
+static const size_t FRAME_SIZE = 417;
+static const size_t NUM_FRAMES = 200;
+
+static void makeFrame(char frame[FRAME_SIZE])
+{
+  memset(frame, 0, FRAME_SIZE);
+  frame[0] = '\xFF';
+  frame[1] = '\xFB';
+  frame[2] = '\x90';
+  frame[3] = '\x64';
+}
+
+static void writeAudio(const char* name)
+{
+  ofstream file(name, ios::out | ios::binary | ios::trunc);
+  char frame[FRAME_SIZE];
+  makeFrame(frame);
+  for (size_t i = 0; i < NUM_FRAMES; ++i)
+  {
+    file.write(frame, FRAME_SIZE);
+  }
+}
+
+// Is the audio written by writeAudio() still at the start of the file?
+static bool audioAtStart(const char* name)
+{
+  ifstream file(name, ios::in | ios::binary);
+  char expected[FRAME_SIZE], frame[FRAME_SIZE];
+  makeFrame(expected);
+  for (size_t i = 0; i < NUM_FRAMES; ++i)
+  {
+    if (!file.read(frame, FRAME_SIZE) || 
+        memcmp(frame, expected, FRAME_SIZE) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static size_t fileSize(const char* name)
+{
+  ifstream file(name, ios::in | ios::binary);
+  file.seekg(0, ios::end);
+  return file.tellg();
+}
+
+int main()
+{
+  writeAudio(FILENAME);
+  {
+    // the first update has to make room for the tag, so the file is rewritten
+    ID3_Tag tag(FILENAME);
+    ID3_AddTitle(&tag, "Test title", true);
+    ID3_AddArtist(&tag, "Test artist", true);
+    tag.Update(ID3TT_ALL);
+  }
+
+  int failures = 0;
+  ifstream file(FILENAME, ios::in | ios::binary);
+  {
+    ID3_Tag tag(FILENAME);
+    ID3_AddTitle(&tag, "Title test", true);
+    const size_t v2Size = tag.GetPrependedBytes();
+
+    const std::string before = contents(file);
+    flags_t updated = tag.Update(ID3TT_ALL);
+    const std::string after = contents(file);
+
+    // the tags change, the audio between them doesn't
+    const size_t audioSize = before.size() - v2Size - ID3_V1_LEN;
+    const bool inPlace = after.size() == before.size() &&
+      before.compare(v2Size, audioSize, after, v2Size, audioSize) == 0 &&
+      after.find("Title test") < v2Size && 
+      after.find("Title test", v2Size) >= v2Size + audioSize;
+    cout << "in-place update: " << (inPlace ? "ok" : "failed") << endl;
+    if (updated != ID3TT_ID3 || !inPlace)
+    {
+      cerr << "*** expected both tags to be written over the old ones" << endl;
+      ++failures;
+    }
+  }
+
+  {
+    // a v1-only update is a single write of the 128 byte block
+    ID3_Tag tag(FILENAME);
+    ID3_AddArtist(&tag, "Artist test", true);
+    ID3_Tag* tags[] = { &tag };
+
+    const std::string before = contents(file);
+    size_t updated = ID3_UpdateV1Tags(tags, 1);
+    const std::string after = contents(file);
+
+    const size_t v1Beg = before.size() - ID3_V1_LEN;
+    const bool inPlace = sameOutside(before, after, v1Beg, before.size()) &&
+      after.find("Artist test", v1Beg) != std::string::npos;
+    cout << "v1 update: " << (inPlace ? "ok" : "failed") << endl;
+    if (updated != 1 || !inPlace)
+    {
+      cerr << "*** expected the v1 tag alone to be written over" << endl;
+      ++failures;
+    }
+  }
+
+  {
+    // an edit session defers the Update()s to the commit
+    ID3_Tag tag(FILENAME);
+
+    const std::string before = contents(file);
+    tag.BeginEdit();
+    ID3_AddTitle(&tag, "Edit title", true);
+    tag.Update();
+    ID3_AddArtist(&tag, "Edit artist", true);
+    tag.Update(ID3TT_ID3V1);
+    const bool deferred = contents(file) == before;
+    flags_t updated = tag.CommitEdit(ID3TT_ID3V2);
+    const std::string after = contents(file);
+
+    const bool committed = after.size() == before.size() && 
+      after.find("Edit title") != std::string::npos &&
+      after.find("Edit artist") != std::string::npos;
+    cout << "edit session: " << (deferred && committed ? "ok" : "failed") 
+         << endl;
+    if (updated != ID3TT_ID3 || !deferred || !committed)
+    {
+      cerr << "*** expected the session to write the tags at the commit" 
+           << endl;
+      ++failures;
+    }
+
+    // aborting a session throws the changes away
+    tag.BeginEdit();
+    ID3_AddTitle(&tag, "Title test", true);
+    tag.Update();
+    tag.AbortEdit();
+    char* title = ID3_GetTitle(&tag);
+    if (!title || strcmp(title, "Edit title") != 0 || contents(file) != after)
+    {
+      cerr << "*** aborted edit was not discarded" << endl;
+      ++failures;
+    }
+    ID3_FreeString(title);
+
+    // put the title back for the checks below
+    ID3_AddTitle(&tag, "Title test", true);
+    tag.Update();
+  }
+
+  {
+    // render through a counting writer: many calls, one write at the flush
+    ID3_Tag tag(FILENAME);
+    int fd = open(RENDER_FILENAME, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ifstream rendered(RENDER_FILENAME, ios::in | ios::binary);
+    ID3_FDWriter fdw(fd);
+    CallCountingWriter cw(fdw);
+
+    const size_t size = tag.Render(cw);
+    const bool gathered = contents(rendered).empty();
+    fdw.flush();
+    const std::string after = contents(rendered);
+    close(fd);
+
+    const bool written = fdw.good() && size > 0 && after.size() == size &&
+      after.find("Title test") != std::string::npos;
+    cout << "render: " << cw.getCalls() << " writer calls, " 
+         << (gathered && written ? "ok" : "failed") << endl;
+    if (cw.getCalls() < 2 || !gathered || !written)
+    {
+      cerr << "*** expected the rendering to be gathered into one write" << endl;
+      ++failures;
+    }
+  }
+  file.close();
+
+  {
+    ID3_Tag tag(FILENAME);
+    char* title = ID3_GetTitle(&tag);
+    if (!title || strcmp(title, "Title test") != 0)
+    {
+      cerr << "*** title not updated" << endl;
+      ++failures;
+    }
+    ID3_FreeString(title);
+    if (!tag.HasV1Tag())
+    {
+      cerr << "*** id3v1 tag missing" << endl;
+      ++failures;
+    }
+  }
+
+  writeAudio(APPENDED_FILENAME);
+  {
+    // an appended tag goes after the audio, ahead of the v1 tag
+    ID3_Tag tag(APPENDED_FILENAME);
+    tag.SetAppended(true);
+    ID3_AddTitle(&tag, "Appended title", true);
+    tag.Update(ID3TT_ALL);
+  }
+  {
+    ID3_Tag tag(APPENDED_FILENAME);
+    char* title = ID3_GetTitle(&tag);
+    if (!title || strcmp(title, "Appended title") != 0 || !tag.GetAppended() ||
+        !tag.HasV1Tag() || tag.GetPrependedBytes() != 0)
+    {
+      cerr << "*** appended tag not found" << endl;
+      ++failures;
+    }
+    ID3_FreeString(title);
+
+    // growing the tag moves the v1 tag, but not the audio
+    ID3_AddArtist(&tag, "An artist with a name long enough to grow the tag", 
+                  true);
+    ID3_AddAlbum(&tag, "Appended album", true);
+    tag.Update(ID3TT_ALL);
+    if (!audioAtStart(APPENDED_FILENAME) || 
+        fileSize(APPENDED_FILENAME) != tag.GetFileSize())
+    {
+      cerr << "*** appended update moved the audio" << endl;
+      ++failures;
+    }
+  }
+  {
+    ID3_Tag tag(APPENDED_FILENAME);
+    char* album = ID3_GetAlbum(&tag);
+    if (!album || strcmp(album, "Appended album") != 0 || !tag.HasV1Tag())
+    {
+      cerr << "*** appended tag not updated" << endl;
+      ++failures;
+    }
+    ID3_FreeString(album);
+
+    // stripping it leaves the audio and the v1 tag
+    tag.Strip(ID3TT_ID3V2);
+    if (!audioAtStart(APPENDED_FILENAME) ||
+        fileSize(APPENDED_FILENAME) != NUM_FRAMES * FRAME_SIZE + ID3_V1_LEN)
+    {
+      cerr << "*** appended tag not stripped" << endl;
+      ++failures;
+    }
+  }
+
+  remove(FILENAME);
+  remove(APPENDED_FILENAME);
+  remove(RENDER_FILENAME);
+  return failures;
+}
@@ -0,0 +1,107 @@
+// $Id$
+
+// Writes a comment with a utf-16 description and text to a file, links the
+// file again and checks that both come back as they went in, and that the
+// byte order mark in the file matches the byte order of the text after it.
+// The description is read with io::readUnicodeString() and the text with
+// io::readUnicodeText(), so this checks both against the mark written.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <string.h>
+#include <string>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static bool sameText(const char* what, const ID3_Field* field,
+                     const unicode_t* want)
+{
+  unicode_t got[32];
+  const size_t len = field->Get(got, 32);
+  got[len < 32 ? len : 31] = 0;
+  size_t i = 0;
+  for (; want[i] && got[i] == want[i]; ++i)
+  {
+    ;
+  }
+  if (got[i] != want[i])
+  {
+    cerr << what << ": got";
+    for (size_t j = 0; got[j]; ++j)
+    {
+      cerr << " 0x" << std::hex << got[j] << std::dec;
+    }
+    cerr << endl;
+    return false;
+  }
+  return true;
+}
+
+int main()
+{
+  const unicode_t description[] = { 'a', 'b', 0 };
+  const unicode_t text[] = { 'T', 0x0142, 'x', 't', 0 };
+
+  const char* filename = "test-utf16.tag";
+  {
+    std::ofstream file(filename, std::ios::out | std::ios::binary |
+                       std::ios::trunc);
+  }
+  {
+    ID3_Tag tag(filename);
+    ID3_Frame* frame = new ID3_Frame(ID3FID_COMMENT);
+    frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+    frame->GetField(ID3FN_LANGUAGE)->Set("eng");
+    frame->GetField(ID3FN_DESCRIPTION)->SetEncoding(ID3TE_UTF16);
+    frame->GetField(ID3FN_DESCRIPTION)->Set(description);
+    frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+    frame->GetField(ID3FN_TEXT)->Set(text);
+    tag.AttachFrame(frame);
+    tag.SetPadding(false);
+    tag.SetUnsync(false);
+    if (tag.Update(ID3TT_ID3V2) == ID3TT_NONE)
+    {
+      cerr << "nothing written" << endl;
+      return 1;
+    }
+  }
+
+  // the mark in front of the description, right after the language
+  std::ifstream file(filename, std::ios::in | std::ios::binary);
+  std::string raw;
+  char ch;
+  while (file.get(ch))
+  {
+    raw += ch;
+  }
+  const std::string::size_type lang = raw.find("eng");
+  const unicode_t bom = 0xFEFF;
+  if (lang == std::string::npos ||
+      raw.compare(lang + 3, 2, reinterpret_cast<const char*>(&bom), 2) != 0)
+  {
+    cerr << "byte order mark doesn't match the text" << endl;
+    return 1;
+  }
+
+  ID3_Tag parsed(filename);
+  const ID3_Frame* comment = parsed.Find(ID3FID_COMMENT);
+  if (!comment)
+  {
+    cerr << "no comment parsed" << endl;
+    return 1;
+  }
+
+  bool ok = true;
+  ok = sameText("description", comment->GetField(ID3FN_DESCRIPTION),
+                description) && ok;
+  ok = sameText("text", comment->GetField(ID3FN_TEXT), text) && ok;
+  cout << (ok ? "utf-16 round trip ok" : "utf-16 round trip failed") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// $Id$
+
+// Writes an mpeg file of crc protected layer III frames, corrupts one of
+// them and breaks the stream with some junk, then checks that
+// ID3_Tag::VerifyMp3() finds both, on one thread and on several.  A clean
+// file whose audio ends just past the verifier's first 1MB chunk must come
+// out clean.
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+static const char* FILENAME = "test-verify.mp3";
+
+// MPEG-1 layer III, 128kbit/s at 44.1kHz, stereo, with a crc
+static const size_t FRAME_SIZE = 417;
+static const size_t SIDEINFO_SIZE = 32;
+// enough frames to make several chunks for the verifier
+static const size_t NUM_FRAMES = 6000;
+static const size_t CORRUPT_FRAME = 1234;
+static const size_t JUNK_AFTER = 4500;
+static const char JUNK[] = "junkjunkjunk";
+// the last frame starts before 1MB and ends just past it
+static const size_t CLEAN_FRAMES = 2515;
+
+// the mpeg audio crc-16, a bit at a time
+static uint16 crc16(const uchar* data, size_t len, uint16 crc)
+{
+  for (size_t i = 0; i < len; ++i)
+  {
+    for (int bit = 7; bit >= 0; --bit)
+    {
+      const bool top = (crc & 0x8000) != 0;
+      crc <<= 1;
+      if (top != (((data[i] >> bit) & 1) != 0))
+      {
+        crc ^= 0x8005;
+      }
+    }
+  }
+  return crc;
+}
+
+static void writeAudio(const char* name, size_t frames, bool damage)
+{
+  ofstream file(name, ios::out | ios::binary | ios::trunc);
+  uchar frame[FRAME_SIZE];
+  unsigned int seed = 1;
+  for (size_t i = 0; i < frames; ++i)
+  {
+    memset(frame, 0, FRAME_SIZE);
+    frame[0] = 0xFF;
+    frame[1] = 0xFA;
+    frame[2] = 0x90;
+    frame[3] = 0x04;
+    for (size_t j = 0; j < SIDEINFO_SIZE; ++j)
+    {
+      seed = seed * 1103515245 + 12345;
+      frame[6 + j] = static_cast<uchar>(seed >> 16);
+    }
+    uint16 crc = crc16(frame + 2, 2, 0xffff);
+    crc = crc16(frame + 6, SIDEINFO_SIZE, crc);
+    frame[4] = static_cast<uchar>(crc >> 8);
+    frame[5] = static_cast<uchar>(crc);
+    if (damage && i == CORRUPT_FRAME)
+    {
+      frame[10] ^= 1;
+    }
+    file.write(reinterpret_cast<const char*>(frame), FRAME_SIZE);
+    if (damage && i == JUNK_AFTER)
+    {
+      file.write(JUNK, strlen(JUNK));
+    }
+  }
+}
+
+int main()
+{
+  writeAudio(FILENAME, NUM_FRAMES, true);
+
+  int failures = 0;
+  ID3_Tag tag(FILENAME);
+  const size_t threads[] = { 1, 4 };
+  for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t)
+  {
+    Mp3_Integrity integrity;
+    uint32 corrupt[4];
+    bool verified = tag.VerifyMp3(integrity, corrupt, 4, threads[t]);
+    cout << threads[t] << " thread(s): " << integrity.frames << " frames, "
+         << integrity.checked << " checked, " << integrity.corrupt
+         << " corrupt" << endl;
+    if (!verified || integrity.frames != NUM_FRAMES ||
+        integrity.checked != NUM_FRAMES || integrity.corrupt != 2 ||
+        corrupt[0] != CORRUPT_FRAME * FRAME_SIZE ||
+        corrupt[1] != (JUNK_AFTER + 1) * FRAME_SIZE)
+    {
+      cerr << "*** expected the corrupt frame and the junk to be found" << endl;
+      ++failures;
+    }
+  }
+
+  writeAudio(FILENAME, CLEAN_FRAMES, false);
+  ID3_Tag clean(FILENAME);
+  for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t)
+  {
+    Mp3_Integrity integrity;
+    uint32 corrupt[4];
+    bool verified = clean.VerifyMp3(integrity, corrupt, 4, threads[t]);
+    cout << threads[t] << " thread(s), clean: " << integrity.frames
+         << " frames, " << integrity.checked << " checked, "
+         << integrity.corrupt << " corrupt" << endl;
+    if (!verified || integrity.frames != CLEAN_FRAMES ||
+        integrity.checked != CLEAN_FRAMES || integrity.corrupt != 0)
+    {
+      cerr << "*** expected a clean file to verify clean" << endl;
+      ++failures;
+    }
+  }
+
+  remove(FILENAME);
+  return failures;
+}
@@ -1,7 +1,7 @@
 # $Id: id3lib.spec.in,v 1.27 2002/11/02 18:03:27 t1mpy Exp $
 
 %define name    id3lib
-%define	version	3.8.3
+%define	version	3.8.4
 %define	release	1
 %define	prefix	/usr
 
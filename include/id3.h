@@ -67,6 +67,7 @@ extern "C"
   ID3_C_EXPORT ID3_Err              CCONV ID3Tag_UpdateByTagType      (ID3Tag *tag, flags_t type);
   ID3_C_EXPORT ID3_Err              CCONV ID3Tag_Strip                (ID3Tag *tag, flags_t ulTagFlags);
   ID3_C_EXPORT ID3Frame*            CCONV ID3Tag_FindFrameWithID      (const ID3Tag *tag, ID3_FrameID id);
+  ID3_C_EXPORT ID3Frame*            CCONV ID3Tag_FindFirstFrameWithID (const ID3Tag *tag, ID3_FrameID id);
   ID3_C_EXPORT ID3Frame*            CCONV ID3Tag_FindFrameWithINT     (const ID3Tag *tag, ID3_FrameID id, ID3_FieldID fld, uint32 data);
   ID3_C_EXPORT ID3Frame*            CCONV ID3Tag_FindFrameWithASCII   (const ID3Tag *tag, ID3_FrameID id, ID3_FieldID fld, const char *data);
   ID3_C_EXPORT ID3Frame*            CCONV ID3Tag_FindFrameWithUNICODE (const ID3Tag *tag, ID3_FrameID id, ID3_FieldID fld, const unicode_t *data);
@@ -109,6 +110,9 @@ extern "C"
   ID3_C_EXPORT void                 CCONV ID3Field_GetBINARY          (const ID3Field *field, uchar *buffer, size_t buffLength);
   ID3_C_EXPORT void                 CCONV ID3Field_FromFile           (ID3Field *field, const char *fileName);
   ID3_C_EXPORT void                 CCONV ID3Field_ToFile             (const ID3Field *field, const char *fileName);
+  ID3_C_EXPORT const uchar*         CCONV ID3Field_GetRawView         (const ID3Field *field, size_t *size, ID3_TextEnc *enc);
+  ID3_C_EXPORT bool                 CCONV ID3Field_GetTextItems       (const ID3Field *field, ID3_TextItemIterator *iter);
+  ID3_C_EXPORT const uchar*         CCONV ID3TextItemIterator_GetNext (ID3_TextItemIterator *iter, size_t *size);
 
   /* field-info wrappers */
   ID3_C_EXPORT char*                CCONV ID3FrameInfo_ShortName     (ID3_FrameID frameid);
@@ -121,6 +125,7 @@ extern "C"
   ID3_C_EXPORT flags_t              CCONV ID3FrameInfo_FieldFlags     (ID3_FrameID frameid, int fieldnum);
 
   ID3_C_EXPORT const Mp3_Headerinfo* CCONV ID3Tag_GetMp3HeaderInfo ( ID3Tag *tag ) ;
+  ID3_C_EXPORT bool                 CCONV ID3Tag_ExtractCommon       (const ID3Tag *tag, ID3_CommonTags *common);
 
   /* Deprecated */
   ID3_C_EXPORT void                 CCONV ID3Tag_SetCompression       (ID3Tag *tag, bool comp);
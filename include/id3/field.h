@@ -59,6 +59,7 @@ public:
   virtual size_t        Get(char*, size_t, size_t) const = 0;  // deprecated
   virtual const char*   GetRawText() const = 0;  // deprecated
   virtual const char*   GetRawTextItem(size_t) const = 0;  // deprecated
+  virtual const char*   GetRawTextItem(size_t, size_t& size) const = 0;
   virtual size_t        Add(const char*) = 0;
 
   // Unicode string field functions
@@ -76,7 +77,11 @@ public:
   virtual const uchar*  GetRawBinary() const = 0;
   virtual void          FromFile(const char*) = 0;
   virtual void          ToFile(const char *sInfo) const = 0;
+  virtual size_t        ToWriter(ID3_Writer&) const = 0;
+  virtual bool          Attach(int fd, size_t offset, size_t size) = 0;
+  virtual bool          Attach(ID3_Reader&, size_t size) = 0;
   virtual size_t        GetBinaryStartPosition() = 0;
+  virtual const uchar*  GetRawView(size_t& size) const = 0;
   
   // miscelaneous functions
   virtual ID3_Field&    operator=( const ID3_Field & ) = 0;
@@ -92,6 +97,27 @@ public:
   virtual bool          Parse(ID3_Reader&) = 0;
   virtual bool          HasChanged() const = 0;
 
+  /** Steps through the items of a text field in order, handing out each one
+   ** as it is kept in the field, with its size in bytes.
+   **/
+  class ItemIterator
+  {
+  public:
+    ItemIterator(const ID3_Field& field) : _field(field), _index(0) { }
+    const char* GetNext(size_t& size)
+    {
+      if (_index >= _field.GetNumTextItems())
+      {
+        size = 0;
+        return NULL;
+      }
+      return _field.GetRawTextItem(_index++, size);
+    }
+  private:
+    const ID3_Field& _field;
+    size_t _index;
+  };
+
 protected:
   virtual ~ID3_Field() { };
 
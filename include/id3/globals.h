@@ -191,6 +191,29 @@ ID3_ENUM(ID3_TagType)
   ID3TT_APPENDED   = ID3TT_ALL & ~ID3TT_ID3V2
 };
 
+/** What Link() looks at besides the tags.  Finding and decoding the audio
+ ** costs more than parsing the tags of most files, so callers that only want
+ ** the tags can leave it out.
+ **/
+ID3_ENUM(ID3_LinkOption)
+{
+  ID3LO_TAGSONLY    =      0,   /**< Parse the tags; don't look at the audio */
+  ID3LO_MP3HEADER   = 1 << 0,   /**< Decode the first mpeg frame, estimating the duration from it */
+  ID3LO_MP3DURATION = 1 << 1,   /**< Walk every mpeg frame for the exact duration, average bitrate and extent of the audio */
+  ID3LO_PICTUREOFFSETS = 1 << 2, /**< Leave picture data in the file, noting only where it is */
+  /** What Link() does unless told otherwise */
+  ID3LO_DEFAULT     = ID3LO_MP3HEADER
+};
+
+/** Whether the crc in an id3v2 tag's extended header matched its frames
+ **/
+ID3_ENUM(ID3_TagCrc)
+{
+  ID3CRC_MISMATCH = -1,         /**< The tag's data doesn't match its crc */
+  ID3CRC_NONE     =  0,         /**< The tag has no crc */
+  ID3CRC_OK       =  1          /**< The tag's data matches its crc */
+};
+
 /**
  ** Enumeration of the different types of fields in a frame.
  **/
@@ -220,6 +243,7 @@ ID3_ENUM(ID3_FieldID)
   ID3FN_PEAKVOLLEFT,    /**< Peak volume on the left channel */
   ID3FN_TIMESTAMPFORMAT,/**< SYLT Timestamp Format */
   ID3FN_CONTENTTYPE,    /**< SYLT content type */
+  ID3FN_OFFSET,         /**< SEEK offset to the next tag */
   ID3FN_LASTFIELDID     /**< Last field placeholder */
 };
 
@@ -519,6 +543,14 @@ ID3_ENUM(Mp3_Crc)
   MP3CRC_OK = 1
 };
 
+ID3_ENUM(Mp3_VbrHeader)
+{
+  MP3VBRHEADER_NONE = 0,
+  MP3VBRHEADER_XING,
+  MP3VBRHEADER_INFO,            // a Xing header, as LAME writes it for CBR
+  MP3VBRHEADER_VBRI             // the Fraunhofer encoder's
+};
+
 ID3_STRUCT(Mp3_Headerinfo)
 {
   Mpeg_Layers layer;
@@ -536,6 +568,89 @@ ID3_STRUCT(Mp3_Headerinfo)
   bool privatebit;
   bool copyrighted;
   bool original;
+  uint32 milliseconds;          // exact length of the song, 0 if not known
+  // only known after walking the frames (ID3LO_MP3DURATION)
+  uint32 avg_bitrate;           // of the audio frames
+  uint32 audio_start;           // offset of the first audio frame
+  uint32 audio_end;             // offset just past the last one
+  // from a Xing, Info or VBRI header in the first frame
+  Mp3_VbrHeader vbr_header;     // which one there is
+  uint32 vbr_frames;            // nr of frames it gives, 0 if none
+  uint32 vbr_bytes;             // nr of bytes of audio it gives, 0 if none
+  // from the LAME extension of a Xing or Info header
+  bool lame;                    // there is one
+  uint16 encoder_delay;         // samples added at the start (also in VBRI)
+  uint16 encoder_padding;       // samples added at the end
+  uint32 music_length;          // bytes of audio, the Info frame included
+  float replaygain_peak;        // 1.0 is full scale; 0 if not given
+  float replaygain_track;       // in dB, if has_replaygain_track
+  float replaygain_album;       // in dB, if has_replaygain_album
+  bool has_replaygain_track;
+  bool has_replaygain_album;
+};
+
+/** What ID3_Tag::VerifyMp3() found. **/
+ID3_STRUCT(Mp3_Integrity)
+{
+  uint32 frames;                // nr of frames walked
+  uint32 checked;               // nr of them with a crc that was checked
+  uint32 corrupt;               // nr of bad crcs and of places the frames broke off
+};
+
+/** What a single mpeg audio frame header says about its frame; filled in
+ ** by ID3_DecodeMp3Header().
+ **/
+ID3_STRUCT(Mp3_FrameHeader)
+{
+  Mpeg_Version version;
+  Mpeg_Layers layer;
+  Mp3_ChannelMode channelmode;
+  uint32 bitrate;               // in bits per second, 0 for free format
+  uint32 frequency;             // samplerate
+  uint32 framesize;             // in bytes, header included; 0 for free format
+  uint32 samples;               // nr of samples per channel in the frame
+  uint32 sideinfo;              // size of the layer III side information
+  bool crc;                     // the header is followed by a crc
+  bool padding;
+};
+
+#define ID3_COMMON_TEXT_SIZE    (256)
+#define ID3_COMMON_YEAR_SIZE    (32)
+#define ID3_COMMON_MIME_SIZE    (64)
+
+/** The metadata most players show, filled in by ID3Tag_ExtractCommon() in a
+ ** single pass over the frames.  Text is UTF-8, cut short to fit if need be;
+ ** anything not in the tag is left empty (or 0).
+ **/
+ID3_STRUCT(ID3_CommonTags)
+{
+  char title[ID3_COMMON_TEXT_SIZE];          // TIT2
+  char artist[ID3_COMMON_TEXT_SIZE];         // TPE1
+  char album_artist[ID3_COMMON_TEXT_SIZE];   // TPE2
+  char album[ID3_COMMON_TEXT_SIZE];          // TALB
+  char year[ID3_COMMON_YEAR_SIZE];           // TYER, or else TDRC
+  char genre[ID3_COMMON_TEXT_SIZE];          // TCON, as it is in the tag
+  char composer[ID3_COMMON_TEXT_SIZE];       // TCOM
+  uint32 track;                 // TRCK, as in "track/tracks"
+  uint32 tracks;
+  uint32 disc;                  // TPOS, as in "disc/discs"
+  uint32 discs;
+  bool compilation;             // TCMP is set
+  uint32 duration;              // in ms: TLEN, or else from the mpeg audio
+  // the front cover, or else the first picture
+  uint32 picture_offset;        // as GetBinaryStartPosition() gives it
+  uint32 picture_size;          // 0 if there is no picture
+  char picture_mimetype[ID3_COMMON_MIME_SIZE];
+};
+
+/** Walks the items of a text field's raw view, each from where the one
+ ** before it ended; set up by ID3Field_GetTextItems().
+ **/
+ID3_STRUCT(ID3_TextItemIterator)
+{
+  const uchar* next;            // start of the next item, NULL after the last
+  const uchar* end;             // end of the field's text
+  ID3_TextEnc enc;
 };
 
 #define ID3_NR_OF_V1_GENRES 148
@@ -47,6 +47,11 @@ namespace dami
       ID3_C_EXPORT ID3_Frame* setFrameText(ID3_TagImpl&, ID3_FrameID, String);
       ID3_C_EXPORT size_t     removeFrames(ID3_TagImpl&, ID3_FrameID);
 
+      // Frame predicates, for ID3_Tag::RemoveFrames() and the like.  The
+      // description is a const char*, compared with the comment's in latin-1.
+      ID3_C_EXPORT bool       isArtist(const ID3_Frame*, void* = NULL);
+      ID3_C_EXPORT bool       isCommentWithDescription(const ID3_Frame*, void* desc);
+
       ID3_C_EXPORT ID3_Frame* hasArtist(const ID3_TagImpl&);
       ID3_C_EXPORT String     getArtist(const ID3_TagImpl&);
       ID3_C_EXPORT ID3_Frame* setArtist(ID3_TagImpl&, String);
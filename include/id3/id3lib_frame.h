@@ -77,6 +77,7 @@ public:
   ID3_Frame&  operator=(const ID3_Frame &);
   bool        HasChanged() const;
   bool        Parse(ID3_Reader&);
+  bool        Parse(ID3_Reader&, const char* source);
   void        Render(ID3_Writer&) const;
   size_t      Size();
   bool        Contains(ID3_FieldID fld) const;
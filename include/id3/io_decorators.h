@@ -85,6 +85,91 @@ namespace dami
       { 
         return this->readChars((char_type*) buf, len); 
       }
+      size_type skipChars(size_type len);
+
+      void close() { ; }
+    };
+
+    /**
+     * Serves reads near the end of another reader from a single block, read
+     * in one go.  The parsers of the tags appended to a file seek around its
+     * end, backwards and forwards; with this in front of the file they do so
+     * in memory.  Positions are those of the underlying reader, and anything
+     * before the block (part of a tag larger than it) is read from there.
+     */
+    class ID3_CPP_EXPORT TailReader : public ID3_Reader
+    {
+      typedef ID3_Reader SUPER;
+
+      ID3_Reader& _reader;
+      BString  _block;
+      pos_type _blockBeg, _cur, _end;
+
+     public:
+      /**
+       * Reads the last \c size characters of \c reader, or as many as there
+       * are from \c beg onwards, whichever is fewer.
+       */
+      TailReader(ID3_Reader& reader, pos_type beg, size_type size);
+
+      pos_type setCur(pos_type cur) 
+      { 
+        return _cur = mid(this->getBeg(), cur, this->getEnd());
+      }
+
+      pos_type getCur() { return _cur; }
+      pos_type getBeg() { return _reader.getBeg(); }
+      pos_type getEnd() { return _end; }
+
+      int_type peekChar();
+
+      size_type readChars(char_type buf[], size_type len);
+      size_type readChars(char buf[], size_type len)
+      { 
+        return this->readChars((char_type*) buf, len); 
+      }
+      size_type skipChars(size_type len);
+
+      void close() { ; }
+    };
+
+    /**
+     * Serves reads of the next \c size characters of another reader from a
+     * single block, read in one go, so that a tag's frames are parsed from
+     * memory rather than with a read of the file apiece.  Positions are those
+     * of the underlying reader, and the reader is left at the end of the
+     * block.
+     */
+    class ID3_CPP_EXPORT BlockReader : public ID3_Reader
+    {
+      typedef ID3_Reader SUPER;
+
+      BString  _block;
+      pos_type _beg, _cur;
+
+     public:
+      BlockReader(ID3_Reader& reader, size_type size);
+
+      pos_type setCur(pos_type cur) 
+      { 
+        return _cur = mid(this->getBeg(), cur, this->getEnd());
+      }
+
+      pos_type getCur() { return _cur; }
+      pos_type getBeg() { return _beg; }
+      pos_type getEnd() { return _beg + _block.size(); }
+
+      int_type peekChar()
+      {
+        return this->atEnd() ? END_OF_READER : _block[_cur - _beg];
+      }
+
+      size_type readChars(char_type buf[], size_type len);
+      size_type readChars(char buf[], size_type len)
+      { 
+        return this->readChars((char_type*) buf, len); 
+      }
+      size_type skipChars(size_type len);
 
       void close() { ; }
     };
@@ -167,9 +252,9 @@ namespace dami
       void flush();
 
       /**
-       * Write \c len characters into the array \c buf.  Since the stream needs
-       * might have been unsynced, this function copies the characters one at a
-       * time.
+       * Write \c len characters into the array \c buf.  Runs of characters
+       * that don't need a sync byte are passed on to the underlying writer in
+       * one go; a '\\0' is inserted wherever a false sync would occur.
        */
       size_type writeChars(const char_type[], size_type len);
       size_type writeChars(const char buf[], size_type len)
@@ -211,6 +296,68 @@ namespace dami
       pos_type getCur() { return _data.size(); }
       void close() { ; }
     };
+
+    /**
+     * Discards everything written to it, keeping only a count of the bytes.
+     * Used to compute the exact rendered size of a frame or tag before it is
+     * written out, so that the header can be rendered ahead of the data
+     * without first buffering the data.
+     */
+    class ID3_CPP_EXPORT CountingWriter : public ID3_Writer
+    {
+      typedef ID3_Writer SUPER;
+
+      size_type _count;
+     public:
+      CountingWriter() : _count(0) { ; }
+
+      size_type writeChars(const char_type[], size_type len)
+      {
+        _count += len;
+        return len;
+      }
+      size_type writeChars(const char buf[], size_type len)
+      {
+        return this->writeChars(reinterpret_cast<const char_type*>(buf), len);
+      }
+      size_type writeFromFile(int fd, pos_type offset, size_type len);
+
+      pos_type getCur() { return _count; }
+      void flush() { ; }
+      void close() { ; }
+    };
+
+    /**
+     * Passes everything on to another writer, keeping a crc-32 of it.  Lets
+     * a tag's crc be worked out as it is sized, rather than in a pass of
+     * its own.
+     */
+    class ID3_CPP_EXPORT Crc32Writer : public ID3_Writer
+    {
+      typedef ID3_Writer SUPER;
+
+      ID3_Writer& _writer;
+      uint32 _crc;
+     public:
+      explicit Crc32Writer(ID3_Writer& writer, uint32 crc = 0)
+        : _writer(writer), _crc(crc)
+      { ; }
+
+      uint32 getCrc() const { return _crc; }
+
+      size_type writeChars(const char_type[], size_type len);
+      size_type writeChars(const char buf[], size_type len)
+      {
+        return this->writeChars(reinterpret_cast<const char_type*>(buf), len);
+      }
+
+      void flush() { _writer.flush(); }
+      void close() { ; }
+
+      pos_type getBeg() { return _writer.getBeg(); }
+      pos_type getCur() { return _writer.getCur(); }
+      pos_type getEnd() { return _writer.getEnd(); }
+    };
   };
 };
 
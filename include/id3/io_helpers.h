@@ -75,6 +75,14 @@ namespace dami
     ID3_C_EXPORT size_t      writeBENumber(ID3_Writer&, uint32 val, size_t);
     ID3_C_EXPORT size_t      writeTrailingSpaces(ID3_Writer&, String, size_t);
     ID3_C_EXPORT size_t      writeUInt28(ID3_Writer&, uint32);
+
+    // Positional reads and writes on a file descriptor, retried until done.
+    // They use pread() and pwrite(), so the descriptor's file position is
+    // left alone; on Windows they seek instead.  readAt() returns the number
+    // of bytes read, which is short at the end of the file or on error.
+    ID3_C_EXPORT size_t      readAt(int fd, void*, size_t len, size_t offset);
+    ID3_C_EXPORT bool        writeAt(int fd, const void*, size_t len,
+                                     size_t offset);
   };
 };
 
@@ -126,6 +126,15 @@ ID3_C_EXPORT size_t ID3_GetPictureDataOfPicType(ID3_Tag* tag, const uchar*& data
 
 ID3_C_EXPORT size_t ID3_GetPictureDataOfPicTypeAndStartPosition(ID3_Tag*, const uchar*& data, size_t& start, ID3_PictureType pictype);
 
+// stream the picture data to a writer, or to a descriptor at its file
+// position, without reading it into memory first where it hasn't been already
+ID3_C_EXPORT size_t ID3_GetPictureDataOfPicType(ID3_Tag*, ID3_Writer&, ID3_PictureType pictype);
+ID3_C_EXPORT size_t ID3_GetPictureDataOfPicTypeToFd(ID3_Tag*, int fd, ID3_PictureType pictype);
+
+// adds a picture whose data is copied from the whole of the file fd when the
+// tag is rendered; fd has to stay open until then
+ID3_C_EXPORT ID3_Frame* ID3_AttachPicture(ID3_Tag*, int fd, const char* MimeType, ID3_PictureType pictype, const char* Description, bool replace = false);
+
 //following routine courtesy of John George
 ID3_C_EXPORT char *ID3_GetMimeTypeOfPicType(ID3_Tag*, ID3_PictureType pictype);
 
@@ -135,6 +144,18 @@ ID3_C_EXPORT char *ID3_GetDescriptionOfPicType(ID3_Tag*, ID3_PictureType pictype
 //following routine courtesy of John George
 ID3_C_EXPORT size_t ID3_RemovePictureType(ID3_Tag*, ID3_PictureType pictype);
 
+// fills in common with the usual metadata in one pass over the frames, without
+// allocating; returns false if there is no tag or nowhere to put it
+ID3_C_EXPORT bool ID3_GetCommonTags(const ID3_Tag*, ID3_CommonTags* common);
+
+// writes the id3v1 tag of each linked tag in place, through the same v1-only
+// path as Update(ID3TT_ID3V1); returns the number of files written
+ID3_C_EXPORT size_t ID3_UpdateV1Tags(ID3_Tag* const tags[], size_t count);
+
+// decodes a 4 byte mpeg audio frame header, read big endian, without
+// reading or allocating anything; returns false if it isn't a valid header.
+// info may be NULL just to validate it.  Defined in 'mp3_parse.cpp'
+ID3_C_EXPORT bool ID3_DecodeMp3Header(uint32 header, Mp3_FrameHeader* info);
 
 #endif /* _ID3LIB_MISC_SUPPORT_H_ */
 
@@ -70,6 +70,21 @@ class ID3_CPP_EXPORT ID3_IStreamReader : public ID3_Reader
   /** Set the value of the internal position for reading.
    **/
   virtual pos_type setCur(pos_type pos) { _stream.seekg(pos); return pos; }
+
+  /** Skip up to \c len chars by seeking past them, rather than reading
+   ** them, unless the stream can't tell where it is.
+   **/
+  virtual size_type skipChars(size_type len)
+  {
+    pos_type cur = this->getCur(), end = this->getEnd();
+    if (cur == pos_type(-1) || end == pos_type(-1))
+    {
+      return ID3_Reader::skipChars(len);
+    }
+    size_type size = (end < cur) ? 0 : (end - cur < len) ? end - cur : len;
+    this->setCur(cur + size);
+    return size;
+  }
 };
   
 class ID3_CPP_EXPORT ID3_IFStreamReader : public ID3_IStreamReader
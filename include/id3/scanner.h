@@ -0,0 +1,138 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_SCANNER_H_
+#define _ID3LIB_SCANNER_H_
+
+#include <vector>
+#include <id3/tag.h>
+
+#ifdef __APPLE__
+#pragma GCC visibility push(default)
+#endif
+
+/** What ID3_Scanner found out about one file.
+ **
+ ** Everything here belongs to the scanner and is only good for the length of
+ ** the ID3_Scanner::Handler::Scanned() call it is passed to.
+ **/
+struct ID3_ScanResult
+{
+  /// The file's path, as it was added
+  const char* path;
+  /// The file's place in the order the files were added
+  size_t index;
+  /// The tag linked with the file, or NULL if the file couldn't be read
+  const ID3_Tag* tag;
+  /// One frame per SelectFrame() call, in the same order; NULL where the
+  /// file has no such frame
+  const ID3_Frame* const* frames;
+  size_t numFrames;
+  /// The mpeg audio header info, or NULL if there is none
+  const Mp3_Headerinfo* mp3;
+  /// Why the file couldn't be read, or NULL if it could
+  const char* error;
+};
+
+/** Links many files at once, on a pool of threads.
+ **
+ ** Add the files with AddFile(), or whole directory trees with
+ ** AddDirectory(), say what is wanted from them and call Scan().  Each
+ ** thread keeps a tag of its own that it links with one file after another,
+ ** and the threads share out the files by stealing from each other, so a
+ ** slow file holds up only the thread it is on.  The files are read in
+ ** batches (see SetBatchSize()), so that a thread has reads for many files
+ ** outstanding at once.
+ **
+ ** \code
+ **   class Printer : public ID3_Scanner::Handler
+ **   {
+ **   public:
+ **     void Scanned(const ID3_ScanResult& result)
+ **     {
+ **       if (result.frames[0])
+ **       {
+ **         cout << result.path << ": "
+ **              << result.frames[0]->GetField(ID3FN_TEXT)->GetRawText() << endl;
+ **       }
+ **     }
+ **   };
+ **
+ **   ID3_Scanner scanner;
+ **   scanner.AddDirectory("/music");
+ **   scanner.SelectFrame(ID3FID_TITLE);
+ **   Printer printer;
+ **   scanner.Scan(printer);
+ ** \endcode
+ **/
+class ID3_CPP_EXPORT ID3_Scanner
+{
+public:
+  /** Gets the results of a scan.
+   **
+   ** Scanned() is called once per file, on whichever thread linked it, but
+   ** never for two files at once, so it needs no locking of its own.  The
+   ** files come in no particular order; ID3_ScanResult::index tells which
+   ** one it is.
+   **/
+  class Handler
+  {
+  public:
+    virtual ~Handler() { }
+    virtual void Scanned(const ID3_ScanResult&) = 0;
+  };
+
+  ID3_Scanner();
+
+  void       AddFile(const char* path);
+  size_t     AddDirectory(const char* root, const char* suffix = ".mp3");
+  size_t     NumFiles() const { return _paths.size(); }
+
+  void       SelectFrame(ID3_FrameID);
+  void       SetTagTypes(flags_t);
+  void       SetLinkOptions(flags_t);
+  void       SetThreads(size_t);
+  void       SetBatchSize(size_t);
+
+  static bool HasAsyncReads();
+
+  size_t     Scan(Handler&) const;
+
+private:
+  std::vector<dami::String> _paths;
+  std::vector<ID3_FrameID> _frames;
+  flags_t _tag_types;
+  flags_t _options;
+  size_t _threads;
+  size_t _batch;
+};
+
+#ifdef __APPLE__
+#pragma GCC visibility pop
+#endif
+
+#endif /* _ID3LIB_SCANNER_H_ */
@@ -29,6 +29,7 @@
 #ifndef _ID3LIB_TAG_H_
 #define _ID3LIB_TAG_H_
 
+#include <vector>
 #include <id3/id3lib_frame.h>
 #include <id3/field.h>
 #include <id3/utils.h>//for ID3_PATH_LENGTH
@@ -80,17 +81,24 @@ public:
   bool       SetUnsync(bool);
   bool       SetExtendedHeader(bool);
   bool       SetExperimental(bool);
+  bool       SetCrc(bool);
 
   bool       GetUnsync() const;
   bool       GetExtendedHeader() const;
   bool       GetExperimental() const;
+  bool       GetCrc() const;
+  ID3_TagCrc GetCrcStatus() const;
 
   bool       SetPadding(bool);
+  bool       SetAppended(bool);
+  bool       GetAppended() const;
 
   void       AddFrame(const ID3_Frame&);
   void       AddFrame(const ID3_Frame*);
   bool       AttachFrame(ID3_Frame*);
   ID3_Frame* RemoveFrame(const ID3_Frame *);
+  size_t     RemoveFrames(ID3_FrameID);
+  size_t     RemoveFrames(bool (*matches)(const ID3_Frame*, void*), void* data = NULL);
 
   size_t     Parse(const uchar*, size_t);
   bool       Parse(ID3_Reader& reader);
@@ -98,14 +106,26 @@ public:
   size_t     Render(ID3_Writer&, ID3_TagType = ID3TT_ID3V2) const;
 
 #ifdef WIN32
-  size_t     Link(const wchar_t *fileInfo, flags_t = (flags_t) ID3TT_ALL);
+  size_t     Link(const wchar_t *fileInfo, flags_t = (flags_t) ID3TT_ALL,
+                   flags_t = (flags_t) ID3LO_DEFAULT);
+  size_t     Link(const wchar_t *fileInfo, flags_t, ID3_LinkOption);
 #else
-  size_t     Link(const char *fileInfo, flags_t = (flags_t) ID3TT_ALL);
+  size_t     Link(const char *fileInfo, flags_t = (flags_t) ID3TT_ALL,
+                   flags_t = (flags_t) ID3LO_DEFAULT);
+  size_t     Link(const char *fileInfo, flags_t, ID3_LinkOption);
+  size_t     Link(const char *fileInfo, ID3_Reader &reader,
+                   flags_t = (flags_t) ID3TT_ALL, flags_t = (flags_t) ID3LO_DEFAULT);
 #endif
-  size_t     Link(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ALL);
+  size_t     Link(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ALL,
+                   flags_t = (flags_t) ID3LO_DEFAULT);
   flags_t    Update(flags_t = (flags_t) ID3TT_ALL);
   flags_t    Strip(flags_t = (flags_t) ID3TT_ALL);
 
+  void       BeginEdit();
+  flags_t    CommitEdit(flags_t = (flags_t) ID3TT_ALL);
+  void       AbortEdit();
+  bool       InEdit() const;
+
   size_t     GetPrependedBytes() const;
   size_t     GetAppendedBytes() const;
   size_t     GetFileSize() const;
@@ -116,9 +136,22 @@ public:
   ID3_Frame* Find(ID3_FrameID, ID3_FieldID, const char*) const;
   ID3_Frame* Find(ID3_FrameID, ID3_FieldID, const unicode_t*) const;
 
+  ID3_Frame* FindFirst(ID3_FrameID) const;
+  ID3_Frame* FindFirst(ID3_FrameID, ID3_FieldID, uint32) const;
+  ID3_Frame* FindFirst(ID3_FrameID, ID3_FieldID, const char*) const;
+  ID3_Frame* FindFirst(ID3_FrameID, ID3_FieldID, const unicode_t*) const;
+  size_t     FindAll(ID3_FrameID, std::vector<ID3_Frame*>&) const;
+  size_t     FindAll(ID3_FrameID, ID3_FieldID, uint32, std::vector<ID3_Frame*>&) const;
+  size_t     FindAll(ID3_FrameID, ID3_FieldID, const char*, std::vector<ID3_Frame*>&) const;
+  size_t     FindAll(ID3_FrameID, ID3_FieldID, const unicode_t*, std::vector<ID3_Frame*>&) const;
+
   size_t     NumFrames() const;
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const;
+  bool       GetMp3Offset(uint32 milliseconds, size_t& offset) const;
+  bool       GetMp3Time(size_t offset, uint32& milliseconds) const;
+  bool       VerifyMp3(Mp3_Integrity&, uint32* corrupt = NULL, size_t max = 0,
+                       size_t threads = 0) const;
 
   Iterator*  CreateIterator();
   ConstIterator* CreateIterator() const;
@@ -89,6 +89,24 @@ class ID3_CPP_EXPORT ID3_Writer
     return this->writeChars(reinterpret_cast<const char_type *>(buf), len);
   }
 
+  /** Write \c len zero bytes and advance the internal position accordingly.
+   ** Returns the number of zero bytes written.  The default implementation
+   ** writes the zeros in page-sized blocks through writeChars(); writers that
+   ** can do better (e.g. memset a buffer, or point several iovecs at the same
+   ** zero page) should override it.
+   **/
+  virtual size_type writeZeros(size_type len);
+
+  /** Write \c len bytes read from the file descriptor \c fd, starting at
+   ** \c offset, and advance the internal position accordingly.  The
+   ** descriptor's own file position is left alone.  Returns the number of
+   ** bytes written, which is short if the file ends first or can't be read.
+   ** The default implementation reads the data in blocks and writes them
+   ** through writeChars(); writers that are themselves writing to a file can
+   ** have the system copy it instead.
+   **/
+  virtual size_type writeFromFile(int fd, pos_type offset, size_type len);
+
   virtual bool atEnd()
   {
     return this->getCur() >= this->getEnd();
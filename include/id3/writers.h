@@ -173,6 +173,18 @@ class ID3_CPP_EXPORT ID3_MemoryWriter : public ID3_Writer
     return size;
   }
     
+  virtual size_type writeZeros(size_type len)
+  {
+    size_type remaining = _end - _cur;
+    size_type size = (remaining > len) ? len : remaining;
+    ::memset(_cur, 0, size);
+    _cur += size;
+    return size;
+  }
+
+  /** Reads straight into the buffer. **/
+  virtual size_type writeFromFile(int fd, pos_type offset, size_type len);
+    
   virtual pos_type getCur() 
   { 
     return _cur - _beg; 
@@ -189,5 +201,65 @@ class ID3_CPP_EXPORT ID3_MemoryWriter : public ID3_Writer
   }
 };
 
+/** Writes to a file descriptor at an explicit offset, leaving the
+ ** descriptor's own file position untouched.
+ **
+ ** Small writes are copied into an internal buffer; large writes and runs of
+ ** zeros (which all point at one shared zero page) are queued as they are.
+ ** The queue is handed to the system as a single gathered write (pwritev
+ ** where available) whenever it fills up, a large write arrives, or the
+ ** writer is flushed.  Data written from another file is copied from file
+ ** to file by the system (copy_file_range where available).  The writer
+ ** never closes the descriptor; close() and the destructor only flush it.
+ **/
+class ID3_CPP_EXPORT ID3_FDWriter : public ID3_Writer
+{
+ public:
+  enum
+  {
+    BUFFER_SIZE = 16 * 1024,
+    MAX_SEGMENTS = 64
+  };
+ private:
+  struct Segment
+  {
+    const char_type* data;
+    size_type size;
+  };
+
+  int      _fd;
+  pos_type _beg;
+  pos_type _cur;
+  pos_type _off;   // file offset of the first queued byte
+  bool     _good;
+  size_type _used;
+  size_t   _numSegments;
+  Segment  _segments[MAX_SEGMENTS];
+  char_type _buffer[BUFFER_SIZE];
+
+  void addSegment(const char_type* data, size_type size);
+
+ public:
+  ID3_FDWriter(int fd, pos_type offset = 0);
+  virtual ~ID3_FDWriter();
+
+  virtual void close();
+  virtual void flush();
+
+  virtual size_type writeChars(const char buf[], size_type len)
+  { 
+    return this->writeChars(reinterpret_cast<const char_type *>(buf), len);
+  }
+  virtual size_type writeChars(const char_type buf[], size_type len);
+  virtual size_type writeZeros(size_type len);
+  virtual size_type writeFromFile(int fd, pos_type offset, size_type len);
+
+  virtual pos_type getBeg() { return _beg; }
+  virtual pos_type getCur() { return _cur; }
+
+  /** Returns false once a write to the descriptor has failed. **/
+  bool good() const { return _good; }
+};
+
 #endif /* _ID3LIB_WRITERS_H_ */
 
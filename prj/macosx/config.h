@@ -37,11 +37,11 @@
 #define HAVE_ZLIB 1
 #define HAVE_GETOPT_LONG 1
 #define _ID3LIB_NAME "id3lib"
-#define _ID3LIB_VERSION "3.8.3"
-#define _ID3LIB_FULLNAME "id3lib-3.8.3"
+#define _ID3LIB_VERSION "3.8.4"
+#define _ID3LIB_FULLNAME "id3lib-3.8.4"
 #define _ID3LIB_MAJOR_VERSION 3
 #define _ID3LIB_MINOR_VERSION 8
-#define _ID3LIB_PATCH_VERSION 3
+#define _ID3LIB_PATCH_VERSION 4
 #define _ID3LIB_INTERFACE_AGE 0
 #define _ID3LIB_BINARY_AGE 0
 #define _ID3_COMPILED_WITH_DEBUGGING "minimum"
@@ -160,7 +160,7 @@
 #define STDC_HEADERS 1
 
 /* Version number of package */
-#define VERSION "3.8.3"
+#define VERSION "3.8.4"
 
 /* Define if you need to in order for stat and other things to work. */
 /* #undef _POSIX_SOURCE */
@@ -29,6 +29,7 @@
 #include "id3.h"
 #include "tag.h"
 #include "field.h"
+#include "misc_support.h"
 #include "id3lib_strings.h"
 
 #if defined HAVE_CONFIG_H
@@ -255,6 +256,22 @@ extern "C"
   }
 
 
+  // Always the first frame with the id; unlike ID3Tag_FindFrameWithID(), it
+  // keeps no cursor, so threads may share the tag.
+  ID3_C_EXPORT ID3Frame* CCONV
+  ID3Tag_FindFirstFrameWithID(const ID3Tag *tag, ID3_FrameID id)
+  {
+    ID3_Frame *frame = NULL;
+
+    if (tag)
+    {
+      ID3_CATCH(frame = reinterpret_cast<const ID3_Tag *>(tag)->FindFirst(id));
+    }
+
+    return reinterpret_cast<ID3Frame *>(frame);
+  }
+
+
   ID3_C_EXPORT ID3Frame* CCONV
   ID3Tag_FindFrameWithINT(const ID3Tag *tag, ID3_FrameID id,
                           ID3_FieldID fld, uint32 data)
@@ -705,6 +722,94 @@ extern "C"
     }
   }
 
+
+  // The field's data as it is kept, not copied; see ID3_Field::GetRawView().
+  // enc is ID3TE_NONE for anything but text.
+  ID3_C_EXPORT const uchar* CCONV
+  ID3Field_GetRawView(const ID3Field *field, size_t *size, ID3_TextEnc *enc)
+  {
+    const uchar* data = NULL;
+    size_t len = 0;
+    ID3_TextEnc fieldEnc = ID3TE_NONE;
+    if (field)
+    {
+      const ID3_Field* fld = reinterpret_cast<const ID3_Field *>(field);
+      ID3_CATCH(data = fld->GetRawView(len));
+      if (fld->GetType() == ID3FTY_TEXTSTRING)
+      {
+        fieldEnc = fld->GetEncoding();
+      }
+    }
+    if (size)
+    {
+      *size = len;
+    }
+    if (enc)
+    {
+      *enc = fieldEnc;
+    }
+    return data;
+  }
+
+  // Sets iter up to walk the field's text items in order; false if the field
+  // isn't text.  Unlike ID3Field_GetASCIIItem(), each step picks up where the
+  // last one left off rather than counting items from the start.
+  ID3_C_EXPORT bool CCONV
+  ID3Field_GetTextItems(const ID3Field *field, ID3_TextItemIterator *iter)
+  {
+    if (!iter)
+    {
+      return false;
+    }
+    size_t size = 0;
+    iter->next = ID3Field_GetRawView(field, &size, &iter->enc);
+    iter->end = iter->next + size;
+    if (iter->enc == ID3TE_NONE)
+    {
+      iter->next = NULL;
+      return false;
+    }
+    if (size == 0)
+    {
+      iter->next = NULL;
+    }
+    return true;
+  }
+
+  // Returns the next text item, and its size in bytes, or NULL when there
+  // are no more.  The item is in the field's encoding and is not null
+  // terminated.
+  ID3_C_EXPORT const uchar* CCONV
+  ID3TextItemIterator_GetNext(ID3_TextItemIterator *iter, size_t *size)
+  {
+    if (!iter || !iter->next)
+    {
+      return NULL;
+    }
+    const size_t width = ID3TE_IS_DOUBLE_BYTE_ENC(iter->enc) ? 2 : 1;
+    const uchar* item = iter->next;
+    const uchar* cur = item;
+    while (static_cast<size_t>(iter->end - cur) >= width &&
+           (cur[0] != '\0' || (width == 2 && cur[1] != '\0')))
+    {
+      cur += width;
+    }
+    if (size)
+    {
+      *size = cur - item;
+    }
+    // skip the separator; without one, that was the last item
+    if (static_cast<size_t>(iter->end - cur) >= width)
+    {
+      iter->next = cur + width;
+    }
+    else
+    {
+      iter->next = NULL;
+    }
+    return item;
+  }
+
   ID3_C_EXPORT const Mp3_Headerinfo* CCONV
   ID3Tag_GetMp3HeaderInfo ( ID3Tag *tag )
   {
@@ -716,6 +821,19 @@ extern "C"
          return HeaderInfo ;
   }
 
+  // Fills in the common metadata with one call, rather than a find and a
+  // copy for each frame.
+  ID3_C_EXPORT bool CCONV
+  ID3Tag_ExtractCommon(const ID3Tag *tag, ID3_CommonTags *common)
+  {
+    bool found = false;
+    if (tag)
+    {
+      ID3_CATCH(found = ID3_GetCommonTags(reinterpret_cast<const ID3_Tag*>(tag), common));
+    }
+    return found;
+  }
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -416,6 +416,20 @@ static ID3_FieldDef ID3FD_PlayCounter[] =
   { ID3FN_NOFIELD }
 };
 
+static ID3_FieldDef ID3FD_Seek[] =
+{
+  {
+    ID3FN_OFFSET,                       // FIELD NAME
+    ID3FTY_INTEGER,                     // FIELD TYPE
+    4,                                  // FIXED LEN
+    ID3V2_EARLIEST,                     // INITIAL SPEC
+    ID3V2_LATEST,                       // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  { ID3FN_NOFIELD }
+};
+
 static ID3_FieldDef ID3FD_Popularimeter[] =
 {
   {
@@ -675,6 +689,7 @@ static ID3_FieldDef ID3FD_Volume[] =
 // PCNT  CNT  ID3FID_PLAYCOUNTER       Play counter
 // POPM  POP  ID3FID_POPULARIMETER     Popularimeter
 // PRIV       ID3FID_PRIVATE           Private frame
+// SEEK       ID3FID_SEEKFRAME         Seek frame
 // SYLT  SLT  ID3FID_SYNCEDLYRICS      Synchronized lyric/text
 // TALB  TAL  ID3FID_ALBUM             Album/Movie/Show title
 // TBPM  TBP  ID3FID_BPM               BPM (beats per minute)
@@ -768,6 +783,7 @@ static  ID3_FrameDef ID3_FrameDefs[] =
   {ID3FID_BUFFERSIZE,        "BUF", "RBUF", false, false, ID3FD_Unimplemented, "Recommended buffer size"},
   {ID3FID_VOLUMEADJ,         "RVA", "RVAD", false, true,  ID3FD_Unimplemented, "Relative volume adjustment"},
   {ID3FID_REVERB,            "REV", "RVRB", false, false, ID3FD_Unimplemented, "Reverb"},
+  {ID3FID_SEEKFRAME,         ""   , "SEEK", false, false, ID3FD_Seek,          "Seek frame"},
   {ID3FID_SYNCEDLYRICS,      "SLT", "SYLT", false, false, ID3FD_SyncLyrics,    "Synchronized lyric/text"},
   {ID3FID_SYNCEDTEMPO,       "STC", "SYTC", false, true,  ID3FD_Unimplemented, "Synchronized tempo codes"},
   {ID3FID_ALBUM,             "TAL", "TALB", false, false, ID3FD_Text,          "Album/Movie/Show title"},
@@ -893,7 +909,10 @@ ID3_FieldImpl::ID3_FieldImpl()
     _changed(false),
     _fixed_size(0),
     _num_items(0),
-    _enc(ID3TE_NONE)
+    _enc(ID3TE_NONE),
+    _source_fd(-1),
+    _source_reader(NULL),
+    _source_size(0)
 {
   this->Clear();
 }
@@ -907,7 +926,10 @@ ID3_FieldImpl::ID3_FieldImpl(const ID3_FieldDef& def)
     _changed(false),
     _fixed_size(def._fixed_size),
     _num_items(0),
-    _enc((_type == ID3FTY_TEXTSTRING) ? ID3TE_ASCII : ID3TE_NONE)
+    _enc((_type == ID3FTY_TEXTSTRING) ? ID3TE_ASCII : ID3TE_NONE),
+    _source_fd(-1),
+    _source_reader(NULL),
+    _source_size(0)
 {
   this->Clear();
 }
@@ -933,6 +955,10 @@ void ID3_FieldImpl::Clear()
     case ID3FTY_BINARY:
     {
       _binary.erase();
+      _source.erase();
+      _source_fd = -1;
+      _source_reader = NULL;
+      _source_size = 0;
       if (_fixed_size > 0)
       {
         _binary.assign(_fixed_size, '\0');
@@ -942,6 +968,8 @@ void ID3_FieldImpl::Clear()
     case ID3FTY_TEXTSTRING:
     {
       _text.erase();
+      _num_items = 0;
+      _item_offsets.clear();
       if (_fixed_size > 0)
       {
         if (ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()))
@@ -1033,6 +1061,10 @@ size_t ID3_FieldImpl::Size() const
   {
     size = _text.size();
   }
+  else if (this->IsBinaryDeferred())
+  {
+    size = _source_size;
+  }
   else
   {
     size = _binary.size();
@@ -1041,6 +1073,38 @@ size_t ID3_FieldImpl::Size() const
   return size;
 }
 
+/** Returns the field's data where it is kept, without copying it, and its
+ ** size in bytes; NULL (and 0) for integer fields.
+ **
+ ** Text comes as it is stored: in the field's encoding, double-byte text in
+ ** the machine's byte order, and with the items of a list separated by a
+ ** null character.  Binary data left in the file or attached from elsewhere
+ ** is read in first.  The pointer stays good until the field is changed or
+ ** the frame it is in is deleted.
+ **/
+const uchar* ID3_FieldImpl::GetRawView(size_t& size) const
+{
+  const uchar* data = NULL;
+  size = 0;
+  if (_type == ID3FTY_TEXTSTRING)
+  {
+    data = reinterpret_cast<const uchar*>(_text.data());
+    size = _text.size();
+    if (ID3TE_IS_DOUBLE_BYTE_ENC(_enc))
+    {
+      // unicode text read from a tag is left with an odd null byte at the end
+      size -= size % 2;
+    }
+  }
+  else if (_type == ID3FTY_BINARY)
+  {
+    this->LoadBinary();
+    data = _binary.data();
+    size = _binary.size();
+  }
+  return data;
+}
+
 bool ID3_FieldImpl::Parse(ID3_Reader& reader)
 {
   bool success = false;
@@ -1193,6 +1257,7 @@ bool ID3_FieldImpl::SetEncoding(ID3_TextEnc enc)
   {
     _text = convert(_text, _enc, enc);
     _enc = enc;
+    this->IndexTextItems();
     _changed = true;
   }
   return changed;
@@ -30,10 +30,19 @@
 
 #include "field_impl.h"
 #include "reader.h"
-#include "writer.h"
+#include "writers.h"
 #include "io_helpers.h"
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
 
+#if !defined WIN32
+#  if defined HAVE_FCNTL_H
+#    include <fcntl.h>
+#  endif
+#  if defined HAVE_UNISTD_H
+#    include <unistd.h>
+#  endif
+#endif
+
 using namespace dami;
 
 size_t ID3_FieldImpl::Set(const uchar* data, size_t len)
@@ -83,16 +92,23 @@ BString ID3_FieldImpl::GetBinary() const
   BString data;
   if (this->GetType() == ID3FTY_BINARY)
   {
+    this->LoadBinary();
     data = _binary;
   }
   return data;
 }
 
 
+/** Returns the field's binary data, or NULL if it hasn't been read in.
+ **
+ ** A tag linked with ID3LO_PICTUREOFFSETS leaves picture data in the file;
+ ** GetBinaryStartPosition() and Size() say where it is.  Data attached with
+ ** Attach() isn't read in either.  ToWriter() copies it from where it is.
+ **/
 const uchar* ID3_FieldImpl::GetRawBinary() const
 {
   const uchar* data = NULL;
-  if (this->GetType() == ID3FTY_BINARY)
+  if (this->GetType() == ID3FTY_BINARY && !this->IsBinaryDeferred())
   {
     data = _binary.data();
   }
@@ -129,6 +145,8 @@ size_t ID3_FieldImpl::Get(uchar *buffer,    //< Destination of retrieved string
     bytes = dami::min(max_bytes, this->Size());
     if (NULL != buffer && bytes > 0)
     {
+      this->LoadBinary();
+      bytes = dami::min(bytes, _binary.size());
       ::memcpy(buffer, _binary.data(), bytes);
     }
   }
@@ -157,14 +175,19 @@ void ID3_FieldImpl::FromFile(const char *info //< Source filename
     size_t fileSize = ::ftell(temp_file);
     ::fseek(temp_file, 0, SEEK_SET);
 
-    uchar* buffer = new uchar[fileSize];
-    if (buffer != NULL)
+    if (fileSize > 0 && _fixed_size == 0)
     {
-      ::fread(buffer, 1, fileSize, temp_file);
-
-      this->Set(buffer, fileSize);
-
-      delete [] buffer;
+      // read straight into the field, rather than through a buffer
+      this->Clear();
+      _binary.resize(fileSize);
+      _binary.resize(::fread(&_binary[0], 1, fileSize, temp_file));
+      _changed = true;
+    }
+    else if (fileSize > 0)
+    {
+      BString data(fileSize, '\0');
+      data.resize(::fread(&data[0], 1, fileSize, temp_file));
+      this->SetBinary(data);
     }
 
     ::fclose(temp_file);
@@ -189,18 +212,106 @@ void ID3_FieldImpl::ToFile(const char *info //< Destination filename
   size_t size = this->Size();
   if (size > 0)
   {
+#if defined WIN32
+    this->LoadBinary();
     FILE* temp_file = ::fopen(info, "wb");
     if (temp_file != NULL)
     {
-      ::fwrite(_binary.data(), 1, size, temp_file);
+      ::fwrite(_binary.data(), 1, _binary.size(), temp_file);
       ::fclose(temp_file);
     }
+#else
+    int fd = ::open(info, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd >= 0)
+    {
+      ID3_FDWriter out(fd);
+      this->ToWriter(out);
+      out.flush();
+      ::close(fd);
+    }
+#endif
   }
 
   return ;
 }
 
 
+/** Writes the field's binary data to the writer.
+ **
+ ** Data that hasn't been read in, because it was left in the file or
+ ** attached with Attach(), is copied straight from where it is, without
+ ** being read into the field; an ID3_FDWriter has the system copy it from
+ ** file to file.  Returns the number of bytes written.
+ **
+ ** \code
+ **   ID3_FDWriter out(fd);
+ **   myFrame.GetField(ID3FN_DATA)->ToWriter(out);
+ ** \endcode
+ **/
+size_t ID3_FieldImpl::ToWriter(ID3_Writer& writer) const
+{
+  if (this->GetType() != ID3FTY_BINARY)
+  {
+    return 0;
+  }
+  if (this->IsBinaryDeferred())
+  {
+    return this->CopyBinarySource(writer);
+  }
+  return writer.writeChars(_binary.data(), _binary.size());
+}
+
+
+/** Attaches \c size bytes of binary data at \c offset in the file \c fd to
+ ** the field, rather than copying them in.
+ **
+ ** The data is copied from the file when the field is rendered or written
+ ** with ToWriter(), so the descriptor has to stay open, and the data
+ ** unchanged, until then.  It is read in for good if it is asked for with
+ ** Get().  Returns false if the field isn't a (variable length) binary one.
+ **
+ ** \code
+ **   int fd = open("mypic.jpg", O_RDONLY);
+ **   myFrame.GetField(ID3FN_DATA)->Attach(fd, 0, size);
+ **   myTag.Update();
+ **   close(fd);
+ ** \endcode
+ **/
+bool ID3_FieldImpl::Attach(int fd, size_t offset, size_t size)
+{
+  if (this->GetType() != ID3FTY_BINARY || _fixed_size > 0 || fd < 0)
+  {
+    return false;
+  }
+  this->Clear();
+  _start_position = offset;
+  _source_fd = fd;
+  _source_size = size;
+  _changed = true;
+  return true;
+}
+
+/** Attaches the next \c size bytes of the reader to the field, rather than
+ ** copying them in.
+ **
+ ** As with Attach(int, size_t, size_t), the reader has to outlive the data
+ ** being rendered or read in.
+ **/
+bool ID3_FieldImpl::Attach(ID3_Reader& reader, size_t size)
+{
+  if (this->GetType() != ID3FTY_BINARY || _fixed_size > 0)
+  {
+    return false;
+  }
+  this->Clear();
+  _start_position = reader.getCur();
+  _source_reader = &reader;
+  _source_size = size;
+  _changed = true;
+  return true;
+}
+
+
 bool ID3_FieldImpl::ParseBinary(ID3_Reader& reader)
 {
   // copy the remaining bytes, unless we're fixed length, in which case copy
@@ -210,8 +321,93 @@ bool ID3_FieldImpl::ParseBinary(ID3_Reader& reader)
   return true;
 }
 
-void ID3_FieldImpl::RenderBinary(ID3_Writer& writer) const
+// Notes where the binary data is in the file source, which the reader is
+// reading at its own offsets, and skips over it rather than reading it in.
+bool ID3_FieldImpl::ParseBinary(ID3_Reader& reader, const char* source)
 {
-  writer.writeChars(this->GetRawBinary(), this->Size());
+  _binary.erase();
+  _start_position = reader.getCur();
+  _source = source;
+  _source_fd = -1;
+  _source_reader = NULL;
+  _source_size = reader.getEnd() - reader.getCur();
+  reader.setCur(reader.getEnd());
+  return true;
 }
 
+// Writes binary data that hasn't been read in, straight from where it is.
+// Returns how much of it could be written.
+size_t ID3_FieldImpl::CopyBinarySource(ID3_Writer& writer) const
+{
+  size_t size = 0;
+  if (_source_reader != NULL)
+  {
+    ID3_Reader::char_type buffer[16 * 1024];
+    _source_reader->setCur(_start_position);
+    while (size < _source_size)
+    {
+      size_t len = _source_reader->readChars(buffer, 
+        dami::min(sizeof(buffer), _source_size - size));
+      size_t written = len ? writer.writeChars(buffer, len) : 0;
+      size += written;
+      if (written == 0 || written < len)
+      {
+        break;
+      }
+    }
+  }
+  else if (_source_fd >= 0)
+  {
+    size = writer.writeFromFile(_source_fd, _start_position, _source_size);
+  }
+#if !defined WIN32
+  else if (!_source.empty())
+  {
+    int fd = ::open(_source.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+      size = writer.writeFromFile(fd, _start_position, _source_size);
+      ::close(fd);
+    }
+  }
+#endif
+  return size;
+}
+
+// Reads in binary data that was left in the file or attached.  Whatever
+// can't be read is left out.
+void ID3_FieldImpl::LoadBinary() const
+{
+  if (!this->IsBinaryDeferred())
+  {
+    return;
+  }
+  BString data;
+  if (_source_size > 0)
+  {
+    data.resize(_source_size);
+    ID3_MemoryWriter writer(&data[0], _source_size);
+    data.resize(this->CopyBinarySource(writer));
+  }
+  _binary.swap(data);
+  _source.erase();
+  _source_fd = -1;
+  _source_reader = NULL;
+}
+
+void ID3_FieldImpl::RenderBinary(ID3_Writer& writer) const
+{
+  // data left in the tag's own file is read in, since the file is about to
+  // be rewritten; attached data is copied straight from where it is
+  if (!_source.empty())
+  {
+    this->LoadBinary();
+  }
+  size_t size = this->Size();
+  size_t written = this->ToWriter(writer);
+  if (written < size)
+  {
+    // the frame was sized for all of it
+    writer.writeZeros(size - written);
+  }
+}
@@ -29,6 +29,7 @@
 #define _ID3LIB_FIELD_IMPL_H_
 
 #include <stdlib.h>
+#include <vector>
 #include "field.h"
 #include "id3/id3lib_strings.h"
 
@@ -65,6 +66,7 @@ public:
   size_t        Get(char*, size_t, size_t) const;
   const char*   GetRawText() const;
   const char*   GetRawTextItem(size_t) const;
+  const char*   GetRawTextItem(size_t, size_t& size) const;
   size_t        Add(const char* data);
 
   // Unicode string field functions
@@ -86,7 +88,15 @@ public:
   const uchar*  GetRawBinary() const;
   void          FromFile(const char*);
   void          ToFile(const char *sInfo) const;
+  size_t        ToWriter(ID3_Writer&) const;
+  bool          Attach(int fd, size_t offset, size_t size);
+  bool          Attach(ID3_Reader&, size_t size);
   size_t        GetBinaryStartPosition();
+  bool          IsBinaryDeferred() const
+  { return !_source.empty() || _source_fd >= 0 || _source_reader != NULL; }
+  void          LoadBinary() const;
+  bool          ParseBinary(ID3_Reader&, const char* source);
+  const uchar*  GetRawView(size_t& size) const;
 
   // miscelaneous functions
   ID3_Field&    operator=( const ID3_Field & );
@@ -106,6 +116,7 @@ public:
 
 private:
   size_t        GetRawTextItemLen( size_t index =0 ) const;
+  void          IndexTextItems();
 
 private:
   // To prevent public instantiation, the constructor is made private
@@ -119,15 +130,23 @@ private:
   const flags_t       _flags;       // special field flags
   mutable bool        _changed;     // field changed since last parse/render?
 
-  dami::BString       _binary;      // for binary strings
+  mutable dami::BString _binary;    // for binary strings
   dami::String        _text;        // for all strings
   uint32              _integer;     // for numbers
 
   const size_t        _fixed_size;  // for fixed length fields (0 if not)
   size_t              _num_items;   // the number of items in the text string
+  std::vector<size_t> _item_offsets; // where each of them starts in _text
   ID3_TextEnc         _enc;         // encoding for text fields
 
   uint32              _start_position;
+  // where binary data is until it is read in: the file it was left in when
+  // it was parsed, or the descriptor or reader it was attached from; and how
+  // much of it there is
+  mutable dami::String _source;
+  mutable int         _source_fd;
+  mutable ID3_Reader* _source_reader;
+  size_t              _source_size;
 protected:
   void          SetInteger(uint32);
   uint32        GetInteger() const;
@@ -138,6 +157,7 @@ protected:
   void RenderInteger(ID3_Writer&) const;
   void RenderText(ID3_Writer&) const;
   void RenderBinary(ID3_Writer&) const;
+  size_t CopyBinarySource(ID3_Writer&) const;
   
   bool ParseInteger(ID3_Reader&);
   bool ParseText(ID3_Reader&);
@@ -131,15 +131,18 @@ const char* ID3_FieldImpl::GetRawTextItem(size_t index) const
       (index>0 && index >= GetNumTextItems()) ) // we have at least one text item
     return NULL;
 
-  const char* text = _text.c_str();
-  for ( size_t i = 0; i < index; ++i ) {
+  if( index >= _item_offsets.size() )
+    return _text.c_str();
+  return _text.c_str() + _item_offsets[index];
+}
 
-    // find next text start
-    if( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) )
-      text += (ucslen((const unicode_t*)text) + 1)*2;
-    else
-      text += strlen(text) + 1;
-  }
+/** Get a text item by number, and its size in bytes.
+ ** \return null if not a text string or index is to big.
+ **/
+const char* ID3_FieldImpl::GetRawTextItem(size_t index, size_t& size) const
+{
+  const char* text = GetRawTextItem(index);
+  size = text ? GetRawTextItemLen(index) : 0;
   return text;
 }
 
@@ -149,24 +152,48 @@ const char* ID3_FieldImpl::GetRawTextItem(size_t index) const
 size_t ID3_FieldImpl::GetRawTextItemLen( size_t index ) const
 {
   if( GetType() != ID3FTY_TEXTSTRING ||
-      index >= GetNumTextItems() )
+      index >= GetNumTextItems() ||
+      index >= _item_offsets.size() )
     return 0;
 
-  if( GetNumTextItems() == 1 )
-    return _text.size();
+  // the last item has no termination; unicode read from a tag may have an
+  // odd null byte after it
+  if( index == GetNumTextItems()-1 ) {
+    size_t len = _text.size() - _item_offsets[index];
+    if( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) )
+      len -= len % 2;
+    return len;
+  }
 
-  const char* text = GetRawTextItem( index );
-  if( !text )
-    return 0;
+  size_t sep = ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) ? 2 : 1;
+  return _item_offsets[index+1] - _item_offsets[index] - sep;
+}
 
-  // the last item has no termination
-  if( index == GetNumTextItems()-1 )
-    return _text.size() - (text-_text.c_str() );
+/** Finds where each of the _num_items items starts in _text, by walking it
+ ** once; for when the text has been replaced as a whole.
+ **/
+void ID3_FieldImpl::IndexTextItems()
+{
+  _item_offsets.clear();
+  const char* text = _text.c_str();
+  size_t offset = 0;
+  for ( size_t i = 0; i < _num_items; ++i ) {
+    _item_offsets.push_back( offset );
+    if( i+1 == _num_items )
+      break;
 
-   if( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) )
-     return ucslen((const unicode_t*)text)*2;
-   else
-      return strlen(text);
+    // find next text start
+    if( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) ) {
+      size_t len = 0;
+      while( offset + 2*len + 1 < _text.size() &&
+             (text[offset + 2*len] != '\0' || text[offset + 2*len + 1] != '\0') )
+        ++len;
+      offset += (len + 1)*2;
+    }
+    else
+      offset += strlen(text + offset) + 1;
+    offset = dami::min(offset, _text.size());
+  }
 }
 
 namespace
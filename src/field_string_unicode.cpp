@@ -88,12 +88,7 @@ const unicode_t* ID3_FieldImpl::GetRawUnicodeTextItem(size_t index) const
       GetEncoding() == ID3TE_UNICODE &&
       index < this->GetNumTextItems())
   {
-    String unicode = _text + '\0' + '\0';
-    text = (unicode_t *) unicode.data();
-    for (size_t i = 0; i < index; ++i)
-    {
-      text += ucslen(text) + 1;
-    }
+    text = (const unicode_t *) GetRawTextItem(index);
   }
   return text;
 }
@@ -148,57 +143,50 @@ size_t ID3_FieldImpl::SetText( String data, size_t index, ID3_TextEnc enc )
 
   String str = convert( data, enc, GetEncoding() );
 
+  String sep( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) ? 2 : 1, '\0' );
+
   // fixed size (always first item, always ISO8859_1)
   if( _fixed_size != 0 ) {
     _text = String(str, 0, _fixed_size);
     if( str.size()<_fixed_size )
       _text.append( _fixed_size - str.size(), '\0' );
-
-  // no fixed size
+    _item_offsets.assign( 1, 0 );
+
+  // a new first item
+  } else if( index == 0 && _num_items == 0 ) {
+    _text = str;
+    _item_offsets.assign( 1, 0 );
+
+  // a new item at the end, as Add() and parsing a list make: the items
+  // already there stay where they are
+  } else if( index == _num_items ) {
+    // drop the odd null byte unicode read from a tag is left with
+    _text.erase( _text.size() - _text.size() % sep.size() );
+    _text += sep;
+    _item_offsets.push_back( _text.size() );
+    _text += str;
+
+  // an item replaced: rebuild the text around it
   } else {
-
-    // printf("Debug: SetText0: numItems: %d, index: %d %d, %s\n", _num_items, index, _text.size(), _text.c_str() );
     String newText;
-
-    // add old items in front
-    for( size_t i=0; i<index; i++ ) {
-      if( i>0 ) {
-        newText += '\0';
-        if ( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) )
-          newText += '\0';
-      }
-      newText.append( GetRawTextItem(i) );
+    std::vector<size_t> newOffsets;
+    for( size_t i=0; i<_num_items; i++ ) {
+      if( i>0 )
+        newText += sep;
+      newOffsets.push_back( newText.size() );
+      if( i == index )
+        newText.append( str );
+      else
+        newText.append( GetRawTextItem(i), GetRawTextItemLen(i) );
     }
-
-    // printf("Debug: SetText1: %d, %s\n", newText.size(), newText.c_str() );
-    // add new item
-    if( index>0 ) {
-      newText += '\0';
-      if ( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) )
-        newText += '\0';
-    }
-    newText.append( str );
-    // printf("Debug: SetText2: %d, %s\n", newText.size(), newText.c_str() );
-
-    // add old items in back (if any)
-    for( size_t i=index+1; i<_num_items; i++ ) {
-      if( i>0 ) {
-        newText += '\0';
-        if ( ID3TE_IS_DOUBLE_BYTE_ENC(this->GetEncoding()) )
-          newText += '\0';
-      }
-      newText.append( GetRawTextItem(i) );
-    }
-
     _text = newText;
+    _item_offsets.swap( newOffsets );
   }
 
   _changed = true;
   if( index >= _num_items )
     _num_items++;
 
-  // printf("Debug: SetText end: items: %d\n", _num_items );
-
   return GetRawTextItemLen( index );
 }
 
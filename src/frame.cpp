@@ -209,6 +209,26 @@ bool ID3_Frame::Parse(ID3_Reader& reader)
 	}
 }
 
+/** Parses the frame, leaving any picture data in the file it is read from.
+ **
+ ** The reader has to be reading the file named by source as it is stored,
+ ** at the file's own offsets.  The picture data's offset and size are noted
+ ** in the field instead of the data, which is read in when it is needed.
+ ** Compressed and encrypted frames are read in as usual.
+ **/
+bool ID3_Frame::Parse(ID3_Reader& reader, const char* source) 
+{
+  try
+  {
+    return _impl->Parse(reader, source);
+  }
+  catch(...)
+  {
+    ID3D_WARNING( "ID3_Frame::Parse: call to _impl->Parse() failed");
+    return false;
+  }
+}
+
 void ID3_Frame::Render(ID3_Writer& writer) const
 {
   _impl->Render(writer);
@@ -69,7 +69,7 @@ public:
 
   ID3_FrameImpl&  operator=(const ID3_Frame &);
   bool        HasChanged() const;
-  bool        Parse(ID3_Reader&);
+  bool        Parse(ID3_Reader&, const char* source = NULL);
   void        Render(ID3_Writer&) const;
   size_t      Size();
   bool        Contains(ID3_FieldID fld) const
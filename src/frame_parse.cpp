@@ -29,13 +29,14 @@
 #endif
 
 #include "frame_impl.h"
+#include "field_impl.h"
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 
 using namespace dami;
 
 namespace
 {
-  bool parseFields(ID3_Reader& rdr, ID3_FrameImpl& frame)
+  bool parseFields(ID3_Reader& rdr, ID3_FrameImpl& frame, const char* source)
   {
     int iLoop;
     int iFields;
@@ -87,7 +88,19 @@ namespace
       ID3D_NOTICE( "ID3_FrameImpl::Parse(): parsing field, cur = " << beg );
       ID3D_NOTICE( "ID3_FrameImpl::Parse(): parsing field, end = " << 
                    rdr.getEnd() );
-      if (!fp->Parse(rdr) || rdr.getCur() == beg) 
+      // picture data can be left in the file, if the frame is read from it
+      // as it is stored
+      bool parsed = false;
+      if (source != NULL && frame.GetID() == ID3FID_PICTURE && 
+          fp->GetID() == ID3FN_DATA && fp->GetType() == ID3FTY_BINARY)
+      {
+        parsed = ((ID3_FieldImpl*) fp)->ParseBinary(rdr, source);
+      }
+      else
+      {
+        parsed = fp->Parse(rdr);
+      }
+      if (!parsed || rdr.getCur() == beg) 
       { 
         // nothing to parse!  ack!  parse error... 
         ID3D_WARNING( "ID3_FrameImpl::Parse(): no data parsed, bad parse" );
@@ -106,7 +119,7 @@ namespace
   }
 };
 
-bool ID3_FrameImpl::Parse(ID3_Reader& reader) 
+bool ID3_FrameImpl::Parse(ID3_Reader& reader, const char* source) 
 { 
   io::ExitTrigger et(reader);
   ID3D_NOTICE( "ID3_FrameImpl::Parse(): reader.getBeg() = " << reader.getBeg() );
@@ -171,12 +184,13 @@ bool ID3_FrameImpl::Parse(ID3_Reader& reader)
   // expand out the data if it's compressed 
   if (!_hdr.GetCompression())
   {
-    success = parseFields(wr, *this);
+    // encrypted data has to be read in to be of any use
+    success = parseFields(wr, *this, _hdr.GetEncryption() ? NULL : source);
   }
   else
   {
     io::CompressedReader csr(wr, origSize);
-    success = parseFields(csr, *this);
+    success = parseFields(csr, *this, NULL);
   }
   et.setExitPos(wr.getCur());
 
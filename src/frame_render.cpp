@@ -81,15 +81,20 @@ void ID3_FrameImpl::Render(ID3_Writer& writer) const
   
   const size_t hdr_size = hdr.Size();
 
-  // 1.  Write out the field data to the buffer, with the assumption that
-  //     we won't be decompressing, since this is the usual behavior
+  // 1.  Work out the size of the field data.  Uncompressed fields are
+  //     counted now and rendered straight to the writer once the header is
+  //     out, so the field data is never held in memory.  Compressed fields
+  //     have to be buffered, since the compressed size isn't known until the
+  //     data has been deflated.
   String flds;
   io::StringWriter fldWriter(flds);
   size_t origSize = 0;
+  size_t fldSize = 0;
   if (!this->GetCompression())
   {
-    renderFields(fldWriter, *this);
-    origSize = flds.size();
+    io::CountingWriter counter;
+    renderFields(counter, *this);
+    origSize = fldSize = counter.getCur();
     ID3D_NOTICE ( "ID3_FrameImpl::Render(): uncompressed fields" );
   }
   else
@@ -98,11 +103,11 @@ void ID3_FrameImpl::Render(ID3_Writer& writer) const
     renderFields(cr, *this);
     cr.flush();
     origSize = cr.getOrigSize();
+    fldSize = flds.size();
     ID3D_NOTICE ( "ID3_FrameImpl::Render(): compressed fields, orig size = " <<
                   origSize );
   }
 
-  size_t fldSize = flds.size();
   ID3D_NOTICE ( "ID3_FrameImpl::Render(): field size = " << fldSize );
 // No need to not write empty frames, why would we not? They can be used to fill up padding space
 // which is even recommended in the id3 spec.
@@ -154,7 +159,14 @@ void ID3_FrameImpl::Render(ID3_Writer& writer) const
     }
 
     // Write the field data
-    writer.writeChars(flds.data(), fldSize);
+    if (this->GetCompression())
+    {
+      writer.writeChars(flds.data(), fldSize);
+    }
+    else
+    {
+      renderFields(writer, *this);
+    }
   }
   _changed = false;
 }
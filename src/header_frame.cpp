@@ -148,35 +148,50 @@ bool ID3_FrameHeader::Parse(ID3_Reader& reader)
       // We are using the synchsafe integer by deafult, but if the next frame dosn't look valid
       // we test to see if a big endian frame size looks valid. If it does, then use that,
       // otherwise fallback to the spec version.
+      // A size with any high bit set can only be big endian.
       uint32 current = reader.getCur();
-      dataSize = io::readUInt28(reader); 
+      uint32 beSize = io::readBENumber(reader, _info->frame_bytes_size);
+      dataSize = ((beSize & 0x7F000000) >> 3) | ((beSize & 0x007F0000) >> 2) |
+                 ((beSize & 0x00007F00) >> 1) |  (beSize & 0x0000007F);
+      uint32 original_position = reader.getCur();
 
-      uint32 new_position =  current + 4 + 2 + dataSize; // 4 bytes size, 2 bytes flags
-      if (reader.getEnd() > new_position)
+      if (beSize & 0x80808080)
       {
-        uint32 original_position = reader.getCur();
-
-        //skip to  the begining of the next frame
-        reader.setCur(new_position);
-
-        //validate the next frame id
-        String textID = io::readText(reader, _info->frame_bytes_id);
-        if (!isValidFrameIdString(textID.c_str()))
+        dataSize = beSize;
+      }
+      else if (beSize != dataSize)
+      {
+        uint32 new_position =  current + 4 + 2 + dataSize; // 4 bytes size, 2 bytes flags
+        if (reader.getEnd() > new_position)
         {
-          reader.setCur(current);
-
-          uint32 tmpDataSize = io::readBENumber(reader, _info->frame_bytes_size);
-          textID = io::readText(reader, _info->frame_bytes_id);
-          if (!isValidFrameIdString(textID.c_str())) {
-            reader.setCur(original_position);
-          } else {
-            dataSize = tmpDataSize;
+          //skip to  the begining of the next frame
+          reader.setCur(new_position);
+
+          //validate the next frame id; padding will do too
+          String textID = io::readText(reader, _info->frame_bytes_id);
+          if (!isValidFrameIdString(textID.c_str()) &&
+              !textID.empty() && textID[0] != '\0')
+          {
+            // see whether the big endian size lands on a frame, on padding
+            // or right at the end
+            uint32 be_position = current + 4 + 2 + beSize;
+            if (be_position == reader.getEnd())
+            {
+              dataSize = beSize;
+            }
+            else if (reader.getEnd() > be_position)
+            {
+              reader.setCur(be_position);
+              textID = io::readText(reader, _info->frame_bytes_id);
+              if (isValidFrameIdString(textID.c_str()) || textID.empty() ||
+                  textID[0] == '\0')
+              {
+                dataSize = beSize;
+              }
+            }
           }
         }
-        else
-        {
-          reader.setCur(original_position);
-        }
+        reader.setCur(original_position);
       }
   } 
   else
@@ -35,6 +35,7 @@
 using namespace dami;
 
 const char* const ID3_TagHeader::ID = "ID3";
+const char* const ID3_TagHeader::FOOTER_ID = "3DI";
 
 bool ID3_TagHeader::SetSpec(ID3_V2Spec spec)
 {
@@ -50,6 +51,15 @@ bool ID3_TagHeader::SetSpec(ID3_V2Spec spec)
   return changed;
 }
 
+bool ID3_TagHeader::Clear()
+{
+  bool changed = this->ID3_Header::Clear();
+  changed = this->SetCrc(false) || changed;
+  _crc = 0;
+  _padding_size = 0;
+  return changed;
+}
+
 size_t ID3_TagHeader::Size() const
 {
   size_t bytesUsed = ID3_TagHeader::SIZE;
@@ -74,30 +84,51 @@ void ID3_TagHeader::Render(ID3_Writer& writer) const
   writer.writeChar(static_cast<uchar>(_flags.get() & MASK8));
   io::writeUInt28(writer, this->GetDataSize()); //now includes the extended header
 
-  // now we render the extended header
+  // now we render the extended header, in the form of the version written
   if (_flags.test(HEADER_FLAG_EXTENDED))
   {
-    if (this->GetSpec() == ID3V2_4_0)
+    if (ID3V2_LATEST == ID3V2_4_0)
     {
-      io::writeUInt28(writer, 6); //write 4 bytes of v2.4.0 ext header containing size '6'
-      io::writeBENumber(writer, 1, 1); //write that it has only one flag byte (value '1')
-      io::writeBENumber(writer, 0, 1); //write flag byte with value '0'
-    }
-    else if (this->GetSpec() == ID3V2_3_0)
-    {
-      io::writeBENumber(writer, 6, sizeof(uint32));
-      for (size_t i = 0; i < 6; ++i)
+      // the size of the whole v2.4.0 ext header, then a single flag byte
+      io::writeUInt28(writer, _is_crc ? 6 + EXT_V4_CRC_SIZE : 6);
+      io::writeBENumber(writer, 1, 1);
+      io::writeBENumber(writer, _is_crc ? EXT_HEADER_FLAG_BIT3 : 0, 1);
+      if (_is_crc)
       {
-        if (writer.writeChar('\0') == ID3_Writer::END_OF_WRITER)
+        writer.writeChar(EXT_V4_CRC_SIZE - 1);
+        for (int i = EXT_V4_CRC_SIZE - 2; i >= 0; --i)
         {
-          break;
+          writer.writeChar(static_cast<uchar>((_crc >> (7 * i)) & MASK7));
         }
       }
     }
-  //  else //not implemented
+    else if (ID3V2_LATEST == ID3V2_3_0)
+    {
+      // the size of the v2.3.0 ext header less its size field, the flags and
+      // the padding size
+      io::writeBENumber(writer, _is_crc ? 6 + EXT_V3_CRC_SIZE : 6, 
+                        sizeof(uint32));
+      io::writeBENumber(writer, _is_crc ? EXT_V3_FLAG_CRC : 0, 2);
+      io::writeBENumber(writer, _padding_size, sizeof(uint32));
+      if (_is_crc)
+      {
+        io::writeBENumber(writer, _crc, EXT_V3_CRC_SIZE);
+      }
+    }
   }
 }
 
+void ID3_TagHeader::RenderFooter(ID3_Writer& writer) const
+{
+  writer.writeChars((uchar *) FOOTER_ID, strlen(FOOTER_ID));
+
+  writer.writeChar(ID3_V2SpecToVer(ID3V2_LATEST));
+  writer.writeChar(ID3_V2SpecToRev(ID3V2_LATEST));
+
+  writer.writeChar(static_cast<uchar>(_flags.get() & MASK8));
+  io::writeUInt28(writer, this->GetDataSize());
+}
+
 bool ID3_TagHeader::Parse(ID3_Reader& reader)
 {
   io::ExitTrigger et(reader);
@@ -144,14 +175,12 @@ void ID3_TagHeader::ParseExtended(ID3_Reader& reader)
     reader.setCur(reader.getCur()+4); //Extended header size
     //io::readBENumber(reader, 4); //Extended header size
     uint16 tmpval = io::readBENumber(reader, 2); //Extended Flags
-    // skip over padding size, we are not using it anyway
-    reader.setCur(reader.getCur()+4); //Size of padding
-    // io::readBENumber(reader, 4); //Size of padding
+    // the crc leaves out the padding, so its size is needed to check it
+    _padding_size = io::readBENumber(reader, 4); //Size of padding
     if (tmpval != 0) //there is only one flag defined in ID3V2_3_0: crc
     {
-      //skip over crc data, we are not using it anyway
-      reader.setCur(reader.getCur()+4); //Crc
-      //io::readBENumber(reader, 4); //Crc
+      this->SetCrc(true);
+      _crc = io::readBENumber(reader, EXT_V3_CRC_SIZE); //Crc
       _info->extended_bytes = 14;
     }
     else
@@ -169,15 +198,18 @@ void ID3_TagHeader::ParseExtended(ID3_Reader& reader)
 
     io::readUInt28(reader);
     const int extflagbytes = reader.readChar(); //Number of flag bytes
-    ID3_Flags* extflags[1]; // ID3V2_4_0 has 1 flag byte, extflagbytes should be equal to 1
+    ID3_Flags extflags[1]; // ID3V2_4_0 has 1 flag byte, extflagbytes should be equal to 1
     for (i = 0; i < extflagbytes; ++i)
     {
-      extflags[i] = new ID3_Flags;
-      extflags[i]->set(reader.readChar()); //flags
+      const uchar flags = reader.readChar(); //flags
+      if (i == 0)
+      {
+        extflags[i].set(flags);
+      }
     }
     extrabytes = 0; 
-    //extflags[0]->test(EXT_HEADER_FLAG_BIT1); // ID3V2_4_0 ext header flag bit 1 *should* be 0
-    if (extflagbytes > 0 && extflags[0]->test(EXT_HEADER_FLAG_BIT2))
+    //extflags[0].test(EXT_HEADER_FLAG_BIT1); // ID3V2_4_0 ext header flag bit 1 *should* be 0
+    if (extflagbytes > 0 && extflags[0].test(EXT_HEADER_FLAG_BIT2))
     {
       // ID3V2_4_0 ext header flag bit 2 = Tag is an update
       // read size
@@ -188,18 +220,29 @@ void ID3_TagHeader::ParseExtended(ID3_Reader& reader)
       reader.setCur(reader.getCur() + extheaderflagdatasize);
       //reader.readChars(buf, extheaderflagdatasize); //buf should be at least 127 bytes = max extended header flagdata size
     }
-   if (extflagbytes > 0 && extflags[0]->test(EXT_HEADER_FLAG_BIT3))
+   if (extflagbytes > 0 && extflags[0].test(EXT_HEADER_FLAG_BIT3))
    {
       // ID3V2_4_0 ext header flag bit 3 = CRC data present
       // read size
       extrabytes += 1; // add a byte for the char containing the extflagdatasize
       const int extheaderflagdatasize = reader.readChar();
       extrabytes += extheaderflagdatasize;
-      // Set the cursor right; we are not parsing the data, no-one is using extended flags anyway
-      reader.setCur(reader.getCur() + extheaderflagdatasize);
-      //reader.readChars(buf, extheaderflagdatasize); //buf should be at least 127 bytes = max extended header flagdata size
+      if (extheaderflagdatasize == EXT_V4_CRC_SIZE - 1)
+      {
+        // a 35 bit synchsafe integer
+        this->SetCrc(true);
+        _crc = 0;
+        for (i = 0; i < extheaderflagdatasize; ++i)
+        {
+          _crc = (_crc << 7) | (reader.readChar() & MASK7);
+        }
+      }
+      else
+      {
+        reader.setCur(reader.getCur() + extheaderflagdatasize);
+      }
     }
-    if (extflagbytes > 0 && extflags[0]->test(EXT_HEADER_FLAG_BIT4))
+    if (extflagbytes > 0 && extflags[0].test(EXT_HEADER_FLAG_BIT4))
     {
       // ID3V2_4_0 ext header flag bit 4 = Tag restrictions
       // read size
@@ -51,17 +51,25 @@ public:
     EXT_HEADER_FLAG_BIT4  = 1 << 4
   };
 
-  ID3_TagHeader() : ID3_Header() { ; }
+  ID3_TagHeader() : ID3_Header(), _is_crc(false), _crc(0), _padding_size(0) { ; }
   virtual ~ID3_TagHeader() { ; }
   ID3_TagHeader(const ID3_TagHeader& rhs) : ID3_Header() { *this = rhs; }
 
   bool   SetSpec(ID3_V2Spec);
+  bool   Clear();
   size_t Size() const;
   void Render(ID3_Writer&) const;
+  void RenderFooter(ID3_Writer&) const;
   bool Parse(ID3_Reader&);
   void ParseExtended(ID3_Reader&);
   ID3_TagHeader& operator=(const ID3_TagHeader&hdr)
-  { this->ID3_Header::operator=(hdr); return *this; }
+  { 
+    this->ID3_Header::operator=(hdr); 
+    _is_crc = hdr._is_crc;
+    _crc = hdr._crc;
+    _padding_size = hdr._padding_size;
+    return *this; 
+  }
 
   bool SetUnsync(bool b)
   {
@@ -92,12 +100,32 @@ public:
   }
   bool GetFooter() const { return _flags.test(HEADER_FLAG_FOOTER); }
 
+  // The crc in the extended header: for id3v2.3 that of the frames before
+  // unsynchronisation, for id3v2.4 that of everything after the extended
+  // header, padding included, as it is written.  An id3v2.3 extended header
+  // also records the size of the padding.
+  bool SetCrc(bool b)
+  {
+    bool changed = _is_crc != b;
+    _changed = _changed || changed;
+    _is_crc = b;
+    return changed;
+  }
+  bool GetCrc() const { return _is_crc; }
+  void SetCrcValue(uint32 crc) { _crc = crc; }
+  uint32 GetCrcValue() const { return _crc; }
+  void SetPaddingSize(size_t size) { _padding_size = size; }
+  size_t GetPaddingSize() const { return _padding_size; }
+
   // id3v2 tag header signature:  $49 44 33 MM mm GG ss ss ss ss
   // MM = major version (will never be 0xFF)
   // mm = minor version (will never be 0xFF)
   // ff = flags byte 
   // ss = size bytes (less than $80)
   static const char* const ID;
+  // an id3v2.4 footer is a copy of the header with the signature reversed:
+  // $33 44 49 MM mm GG ss ss ss ss
+  static const char* const FOOTER_ID;
   enum
   {
     ID_SIZE        = 3,
@@ -107,7 +135,18 @@ public:
     SIZE_OFFSET    = 6,
     SIZE           = 10 // does not include extented headers
   };
-  
+
+  enum
+  {
+    EXT_V3_FLAG_CRC = 1 << 15,  // the id3v2.3 extended flags are 2 bytes
+    EXT_V3_CRC_SIZE = 4,
+    EXT_V4_CRC_SIZE = 1 + 5     // a length byte and a 35 bit synchsafe integer
+  };
+
+private:
+  bool   _is_crc;
+  uint32 _crc;
+  size_t _padding_size;
 };
 
 #endif /* _ID3LIB_HEADER_TAG_H_ */
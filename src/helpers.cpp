@@ -62,17 +62,27 @@ String id3::v2::getStringAtIndex(const ID3_Frame* frame, ID3_FieldID fldName,
 
 size_t id3::v2::removeFrames(ID3_TagImpl& tag, ID3_FrameID id)
 {
-  size_t numRemoved = 0;
-  ID3_Frame* frame = NULL;
+  return tag.RemoveFrames(id);
+}
 
-  while ((frame = tag.Find(id)) != NULL)
+bool id3::v2::isArtist(const ID3_Frame* frame, void*)
+{
+  ID3_FrameID id = frame->GetID();
+  return id == ID3FID_LEADARTIST || id == ID3FID_BAND ||
+         id == ID3FID_CONDUCTOR  || id == ID3FID_COMPOSER;
+}
+
+bool id3::v2::isCommentWithDescription(const ID3_Frame* frame, void* desc)
+{
+  if (frame->GetID() != ID3FID_COMMENT)
   {
-    frame = tag.RemoveFrame(frame);
-    delete frame;
-    numRemoved++;
+    return false;
   }
-
-  return numRemoved;
+  // See if the description we have matches the description of the
+  // current comment.  It is converted in a copy, leaving the field as it is.
+  ID3_Field* fld = frame->GetField(ID3FN_DESCRIPTION);
+  return fld != NULL && 
+         fld->GetText(0, ID3TE_ISO8859_1) == static_cast<const char*>(desc);
 }
 
 String id3::v2::getFrameText(const ID3_TagImpl& tag, ID3_FrameID id)
@@ -120,17 +130,7 @@ ID3_Frame* id3::v2::setArtist(ID3_TagImpl& tag, String text)
 
 size_t id3::v2::removeArtists(ID3_TagImpl& tag)
 {
-  size_t numRemoved = 0;
-  ID3_Frame* frame = NULL;
-
-  while ((frame = hasArtist(tag)) != NULL)
-  {
-    frame = tag.RemoveFrame(frame);
-    delete frame;
-    numRemoved++;
-  }
-
-  return numRemoved;
+  return tag.RemoveFrames(isArtist, NULL);
 }
 
 ////////////////////////////////////////////////////////////
@@ -287,30 +287,8 @@ size_t id3::v2::removeAllComments(ID3_TagImpl& tag)
 // Remove all comments from the tag with the given description
 size_t id3::v2::removeComments(ID3_TagImpl& tag, String desc)
 {
-  size_t numRemoved = 0;
-
-  for (ID3_TagImpl::iterator iter = tag.begin(); iter != tag.end(); ++iter)
-  {
-    ID3_Frame* frame = *iter;
-    if (frame == NULL)
-    {
-      continue;
-    }
-    if (frame->GetID() == ID3FID_COMMENT)
-    {
-      // See if the description we have matches the description of the
-      // current comment.  If so, remove the comment
-      String tmpDesc = getString(frame, ID3FN_DESCRIPTION);
-      if (tmpDesc == desc)
-      {
-        frame = tag.RemoveFrame(frame);
-        delete frame;
-        numRemoved++;
-      }
-    }
-  }
-
-  return numRemoved;
+  return tag.RemoveFrames(isCommentWithDescription, 
+                          const_cast<char*>(desc.c_str()));
 }
 
 ////////////////////////////////////////////////////////////
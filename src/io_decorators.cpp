@@ -33,6 +33,10 @@
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "zlib.h"
 
+#if defined HAVE_SYS_STAT_H
+#  include <sys/stat.h>
+#endif
+
 using namespace dami;
 
 void io::WindowedReader::setWindow(pos_type beg, size_type size)
@@ -144,6 +148,103 @@ ID3_Reader::size_type io::WindowedReader::readChars(char_type buf[], size_type l
   return size;
 }
 
+ID3_Reader::size_type io::WindowedReader::skipChars(size_type len)
+{
+  // the skip is passed on, so that a reader that can seek past the
+  // characters does so instead of reading them
+  pos_type cur = this->getCur();
+  size_type size = 0;
+  if (this->inWindow(cur))
+  {
+    size = _reader.skipChars(min<size_type>(len, _end - cur));
+  }
+  return size;
+}
+
+io::TailReader::TailReader(ID3_Reader& reader, pos_type beg, size_type size)
+  : _reader(reader), _block(), _blockBeg(0), _cur(reader.getCur()), 
+    _end(reader.getEnd())
+{
+  beg = mid(reader.getBeg(), beg, _end);
+  _blockBeg = (_end - beg > size) ? _end - size : beg;
+
+  size_type numChars = 0;
+  if (_end > _blockBeg)
+  {
+    _block.resize(_end - _blockBeg);
+    _reader.setCur(_blockBeg);
+    numChars = _reader.readChars(&_block[0], _block.size());
+    _block.resize(numChars);
+  }
+  _end = _blockBeg + numChars;
+  ID3D_NOTICE( "TailReader: [blockBeg, end] = [" << _blockBeg << ", " << 
+               _end << "]" );
+
+  this->setCur(_cur);
+}
+
+ID3_Reader::int_type io::TailReader::peekChar()
+{
+  if (this->atEnd())
+  {
+    return END_OF_READER;
+  }
+  if (_cur >= _blockBeg)
+  {
+    return _block[_cur - _blockBeg];
+  }
+  _reader.setCur(_cur);
+  return _reader.peekChar();
+}
+
+ID3_Reader::size_type io::TailReader::readChars(char_type buf[], size_type len)
+{
+  size_type numChars = 0;
+  if (_cur < _blockBeg)
+  {
+    // only a tag larger than the block gets this far back
+    _reader.setCur(_cur);
+    numChars = _reader.readChars(buf, min<size_type>(len, _blockBeg - _cur));
+    _cur += numChars;
+    if (_cur < _blockBeg)
+    {
+      return numChars;
+    }
+  }
+  size_type size = min<size_type>(len - numChars, _end - _cur);
+  ::memcpy(buf + numChars, _block.data() + (_cur - _blockBeg), size);
+  _cur += size;
+  return numChars + size;
+}
+
+ID3_Reader::size_type io::TailReader::skipChars(size_type len)
+{
+  pos_type cur = _cur;
+  return this->setCur(cur + min<size_type>(len, _end - cur)) - cur;
+}
+
+io::BlockReader::BlockReader(ID3_Reader& reader, size_type size)
+  : _block(readBinary(reader, size)), _beg(reader.getCur() - _block.size()),
+    _cur(_beg)
+{
+  ID3D_NOTICE( "BlockReader: [beg, end] = [" << _beg << ", " << 
+               this->getEnd() << "]" );
+}
+
+ID3_Reader::size_type io::BlockReader::readChars(char_type buf[], size_type len)
+{
+  size_type size = min<size_type>(len, this->getEnd() - _cur);
+  ::memcpy(buf, _block.data() + (_cur - _beg), size);
+  _cur += size;
+  return size;
+}
+
+ID3_Reader::size_type io::BlockReader::skipChars(size_type len)
+{
+  pos_type cur = _cur;
+  return this->setCur(cur + min<size_type>(len, this->getEnd() - cur)) - cur;
+}
+
 ID3_Reader::size_type io::CharReader::readChars(char_type buf[], size_type len)
 {
   size_type numChars = 0;
@@ -239,18 +340,48 @@ void io::UnsyncedWriter::flush()
 ID3_Writer::size_type 
 io::UnsyncedWriter::writeChars(const char_type buf[], size_type len)
 {
-  pos_type beg = this->getCur();
   ID3D_NOTICE( "UnsyncedWriter::writeChars(): len = " << len );
-  for (size_t i = 0; i < len; ++i)
+  size_type numChars = 0;
+  size_type run = 0;
+  while (run < len)
   {
-    if (this->atEnd())
+    // find the end of the run of characters that can be written unchanged
+    size_type i = run;
+    int_type last = _last;
+    for (; i < len; ++i)
+    {
+      if (last == 0xFF && (buf[i] == 0x00 || buf[i] >= 0xE0))
+      {
+        break;
+      }
+      last = buf[i];
+    }
+    if (i > run)
+    {
+      size_type written = _writer.writeChars(buf + run, i - run);
+      numChars += written;
+      if (written < i - run)
+      {
+        _last = (written > 0) ? buf[run + written - 1] : _last;
+        break;
+      }
+      _last = last;
+    }
+    if (i == len)
+    {
+      break;
+    }
+    // i points at a character that follows an 0xFF and needs a sync byte
+    if (_writer.writeChar('\0') == END_OF_WRITER)
     {
       break;
     }
-    this->writeChar(buf[i]);
+    _numSyncs++;
+    numChars++;
+    _last = '\0';
+    run = i;
   }
-  size_type numChars = this->getCur() - beg;
-  ID3D_NOTICE( "CharWriter::writeChars(): numChars = " << numChars );
+  ID3D_NOTICE( "UnsyncedWriter::writeChars(): numChars = " << numChars );
   return numChars;
 }
 
@@ -288,6 +419,14 @@ void io::CompressedWriter::flush()
   _data.erase();
 }
 
+ID3_Writer::size_type 
+io::Crc32Writer::writeChars(const char_type buf[], size_type len)
+{
+  size_type written = _writer.writeChars(buf, len);
+  _crc = crc32(_crc, buf, written);
+  return written;
+}
+
 ID3_Writer::size_type 
 io::CompressedWriter::writeChars(const char_type buf[], size_type len)
 { 
@@ -296,3 +435,22 @@ io::CompressedWriter::writeChars(const char_type buf[], size_type len)
   return len;
 }
 
+// Only the size is wanted, so the data isn't read.  As with a write that
+// copies it, what the file doesn't have isn't counted, which leaves it to
+// the caller to make up the difference.
+ID3_Writer::size_type 
+io::CountingWriter::writeFromFile(int fd, pos_type offset, size_type len)
+{
+#if defined HAVE_SYS_STAT_H
+  struct stat st;
+  if (::fstat(fd, &st) == 0)
+  {
+    const off_t size = st.st_size;
+    len = (size <= static_cast<off_t>(offset)) ? 0 :
+      (size - static_cast<off_t>(offset) < static_cast<off_t>(len)) ?
+      static_cast<size_type>(size - offset) : len;
+  }
+#endif
+  _count += len;
+  return len;
+}
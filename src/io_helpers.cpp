@@ -30,6 +30,13 @@
 
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#if defined WIN32
+#  include <io.h>
+#endif
+
 using namespace dami;
 
 String io::readString(ID3_Reader& reader)
@@ -130,11 +137,18 @@ String io::readUnicodeString(ID3_Reader& reader)
   {
     return unicode;
   }
+  // keep the text in the machine's byte order, as readUnicodeText() does
   int bom = isBOM(ch1, ch2);
+#ifdef WORDS_BIGENDIAN
+  bom = -bom; // switch things around for big endian
+  bool swap = (bom >= 0);
+#else
+  bool swap = (bom == 1);
+#endif
   if (!bom)
   {
-    unicode += static_cast<char>(ch1);
-    unicode += static_cast<char>(ch2);
+    unicode += static_cast<char>(swap ? ch2 : ch1);
+    unicode += static_cast<char>(swap ? ch1 : ch2);
   }
   while (!reader.atEnd())
   {
@@ -142,7 +156,7 @@ String io::readUnicodeString(ID3_Reader& reader)
     {
       break;
     }
-    if (bom == -1)
+    if (swap)
     {
       unicode += static_cast<char>(ch2);
       unicode += static_cast<char>(ch1);
@@ -217,16 +231,25 @@ BString io::readAllBinary(ID3_Reader& reader)
 BString io::readBinary(ID3_Reader& reader, size_t len)
 {
   BString binary;
-  binary.reserve(len);
-  
+
+  // Read straight into the string, as much as there is room for at a time,
+  // so that a file reader gets one read for all but the largest data.  The
+  // room doubles as it fills, so a length that is too big for what's left
+  // to read doesn't cost as much memory.
   size_t remaining = len;
-  const size_t SIZE = 1024;
-  ID3_Reader::char_type buf[SIZE];
+  const size_t SIZE = 64 * 1024;
   while (!reader.atEnd() && remaining > 0)
   {
-    size_t numRead = reader.readChars(buf, min(remaining, SIZE));
+    const size_t have = binary.size();
+    const size_t want = min(remaining, max(SIZE, have));
+    binary.resize(have + want);
+    size_t numRead = reader.readChars(&binary[have], want);
+    binary.resize(have + numRead);
+    if (numRead == 0)
+    {
+      break;
+    }
     remaining -= numRead;
-    binary.append(reinterpret_cast<BString::value_type *>(buf), numRead);
   }
   
   return binary;
@@ -378,11 +401,10 @@ size_t io::writeUnicodeText(ID3_Writer& writer, String data, bool bom)
   }
   int is_bom = isBOM(data[0],data[1]);
   if (!is_bom && bom) {
-    // Write the BOM: 0xFEFF
-    const unsigned char BOMch1 = 0xFE;
-    const unsigned char BOMch2 = 0xFF;
-    writer.writeChars(&BOMch1, 1);
-    writer.writeChars(&BOMch2, 1);
+    // Write the BOM: 0xFEFF, in the byte order the text is kept in, which is
+    // the machine's own
+    const unicode_t BOM = 0xFEFF;
+    writer.writeChars(reinterpret_cast<const unsigned char*>(&BOM), 2);
   }
   for (size_t i = 0; i < size; i += 2)
   {
@@ -402,3 +424,53 @@ size_t io::writeUnicodeText(ID3_Writer& writer, String data, bool bom)
   return writer.getCur() - beg;
 }
 
+size_t io::readAt(int fd, void* buf, size_t len, size_t offset)
+{
+  char* data = static_cast<char*>(buf);
+  size_t total = 0;
+  while (total < len)
+  {
+#if defined WIN32
+    int n = -1;
+    const long pos = static_cast<long>(offset + total);
+    if (::_lseek(fd, pos, SEEK_SET) == pos)
+    {
+      n = ::_read(fd, data + total, len - total);
+    }
+#else
+    ssize_t n = ::pread(fd, data + total, len - total, offset + total);
+#endif
+    if (n <= 0)
+    {
+      break;
+    }
+    total += n;
+  }
+  return total;
+}
+
+bool io::writeAt(int fd, const void* buf, size_t len, size_t offset)
+{
+  const char* data = static_cast<const char*>(buf);
+  while (len > 0)
+  {
+#if defined WIN32
+    int n = -1;
+    const long pos = static_cast<long>(offset);
+    if (::_lseek(fd, pos, SEEK_SET) == pos)
+    {
+      n = ::_write(fd, data, len);
+    }
+#else
+    ssize_t n = ::pwrite(fd, data, len, offset);
+#endif
+    if (n <= 0)
+    {
+      return false;
+    }
+    data += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
@@ -27,11 +27,24 @@
 
 //#include <ctype.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "misc_support.h"
 //#include "field.h"
+#include "writers.h"
+#include "helpers.h"
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
 
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#if defined HAVE_SYS_STAT_H
+#  include <sys/stat.h>
+#endif
+#if defined WIN32
+#  include <io.h>
+#endif
+
 //using namespace dami;
 
 char *ID3_GetString(const ID3_Frame *frame, ID3_FieldID fldName)
@@ -42,12 +55,11 @@ char *ID3_GetString(const ID3_Frame *frame, ID3_FieldID fldName)
   if (NULL != frame && NULL != (fld = frame->GetField(fldName)))
   {
 //    ID3_Field* fld = frame->GetField(fldName);
-    ID3_TextEnc enc = fld->GetEncoding();
-    fld->SetEncoding(ID3TE_ISO8859_1);
-    size_t nText = fld->Size();
-    text = new char[nText + 1];
-    fld->Get(text, nText + 1);
-    fld->SetEncoding(enc);
+    // converted in a copy, leaving the field as it is
+    dami::String str = fld->GetText(0, ID3TE_ISO8859_1);
+    text = new char[str.size() + 1];
+    ::memcpy(text, str.data(), str.size());
+    text[str.size()] = '\0';
   }
   return text;
 }
@@ -79,10 +91,10 @@ char *ID3_GetArtist(const ID3_Tag *tag)
   }
 
   ID3_Frame *frame = NULL;
-  if ((frame = tag->Find(ID3FID_LEADARTIST)) ||
-      (frame = tag->Find(ID3FID_BAND))       ||
-      (frame = tag->Find(ID3FID_CONDUCTOR))  ||
-      (frame = tag->Find(ID3FID_COMPOSER)))
+  if ((frame = tag->FindFirst(ID3FID_LEADARTIST)) ||
+      (frame = tag->FindFirst(ID3FID_BAND))       ||
+      (frame = tag->FindFirst(ID3FID_CONDUCTOR))  ||
+      (frame = tag->FindFirst(ID3FID_COMPOSER)))
   {
     sArtist = ID3_GetString(frame, ID3FN_TEXT);
   }
@@ -117,40 +129,12 @@ ID3_Frame* ID3_AddArtist(ID3_Tag *tag, const char *text, bool replace)
 
 size_t ID3_RemoveArtists(ID3_Tag *tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame *frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_LEADARTIST)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
-  }
-  while ((frame = tag->Find(ID3FID_BAND)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
-  }
-  while ((frame = tag->Find(ID3FID_CONDUCTOR)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
-  }
-  while ((frame = tag->Find(ID3FID_COMPOSER)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(dami::id3::v2::isArtist);
 }
 
 char *ID3_GetAlbum(const ID3_Tag *tag)
@@ -161,7 +145,7 @@ char *ID3_GetAlbum(const ID3_Tag *tag)
     return sAlbum;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_ALBUM);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_ALBUM);
   if (frame != NULL)
   {
     sAlbum = ID3_GetString(frame, ID3FN_TEXT);
@@ -194,22 +178,12 @@ ID3_Frame* ID3_AddAlbum(ID3_Tag *tag, const char *text, bool replace)
 
 size_t ID3_RemoveAlbums(ID3_Tag *tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame *frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_ALBUM)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_ALBUM);
 }
 
 char *ID3_GetTitle(const ID3_Tag *tag)
@@ -220,7 +194,7 @@ char *ID3_GetTitle(const ID3_Tag *tag)
     return sTitle;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_TITLE);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_TITLE);
   if (frame != NULL)
   {
     sTitle = ID3_GetString(frame, ID3FN_TEXT);
@@ -253,22 +227,12 @@ ID3_Frame* ID3_AddTitle(ID3_Tag *tag, const char *text, bool replace)
 
 size_t ID3_RemoveTitles(ID3_Tag *tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame *frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_TITLE)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_TITLE);
 }
 
 char *ID3_GetYear(const ID3_Tag *tag)
@@ -279,7 +243,7 @@ char *ID3_GetYear(const ID3_Tag *tag)
     return sYear;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_YEAR);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_YEAR);
   if (frame != NULL)
   {
     sYear = ID3_GetString(frame, ID3FN_TEXT);
@@ -312,22 +276,12 @@ ID3_Frame* ID3_AddYear(ID3_Tag *tag, const char *text, bool replace)
 
 size_t ID3_RemoveYears(ID3_Tag *tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame *frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_YEAR)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_YEAR);
 }
 
 char *ID3_GetComment(const ID3_Tag *tag, const char* desc)
@@ -422,44 +376,18 @@ ID3_Frame* ID3_AddComment(ID3_Tag *tag, const char *text,
 // desc is NULL)
 size_t ID3_RemoveComments(ID3_Tag *tag, const char *desc)
 {
-  size_t num_removed = 0;
-
   if (NULL == tag)
   {
-    return num_removed;
+    return 0;
   }
 
-  ID3_Tag::Iterator* iter = tag->CreateIterator();
-  ID3_Frame* frame = NULL;
-  while ((frame = iter->GetNext()) != NULL)
+  // A null description means remove all comments
+  if (NULL == desc)
   {
-    if (frame->GetID() == ID3FID_COMMENT)
-    {
-      bool remove = false;
-      // A null description means remove all comments
-      if (NULL == desc)
-      {
-        remove = true;
-      }
-      else
-      {
-        // See if the description we have matches the description of the
-        // current comment.  If so, set the "remove the comment" flag to true.
-        char *tmp_desc = ID3_GetString(frame, ID3FN_DESCRIPTION);
-        remove = (strcmp(tmp_desc, desc) == 0);
-        delete [] tmp_desc;
-      }
-      if (remove)
-      {
-        frame = tag->RemoveFrame(frame);
-        delete frame;
-        num_removed++;
-      }
-    }
+    return tag->RemoveFrames(ID3FID_COMMENT);
   }
-  delete iter;
-
-  return num_removed;
+  return tag->RemoveFrames(dami::id3::v2::isCommentWithDescription,
+                           const_cast<char*>(desc));
 }
 
 char *ID3_GetTrack(const ID3_Tag *tag)
@@ -470,7 +398,7 @@ char *ID3_GetTrack(const ID3_Tag *tag)
     return sTrack;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_TRACKNUM);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_TRACKNUM);
   if (frame != NULL)
   {
     sTrack = ID3_GetString(frame, ID3FN_TEXT);
@@ -611,49 +539,42 @@ ID3_Frame* ID3_AddPicture(ID3_Tag* tag, const char* TempPicPath, const char* Mim
 //following routine courtesy of John George
 size_t ID3_RemovePictures(ID3_Tag* tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame* frame = NULL;
-
   if (NULL == tag)
-    return num_removed;
+    return 0;
 
-  while ((frame = tag->Find(ID3FID_PICTURE)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
-  }
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_PICTURE);
 }
 
-//following routine courtesy of John George
-size_t ID3_RemovePictureType(ID3_Tag* tag, ID3_PictureType pictype)
+namespace
 {
-  size_t bremoved = 0;
-  ID3_Frame* frame = NULL;
-
-  if (NULL == tag)
-    return bremoved;
-
-  ID3_Tag::Iterator* iter = tag->CreateIterator();
+  // matches the first picture of the type only
+  struct FirstPicture
+  {
+    ID3_PictureType pictype;
+    bool found;
+  };
 
-  while (NULL != (frame = iter->GetNext()))
+  bool isFirstPicture(const ID3_Frame* frame, void* data)
   {
-    if (frame->GetID() == ID3FID_PICTURE)
+    FirstPicture* first = static_cast<FirstPicture*>(data);
+    if (first->found || frame->GetID() != ID3FID_PICTURE ||
+        frame->GetField(ID3FN_PICTURETYPE)->Get() != (uint32)first->pictype)
     {
-      if (frame->GetField(ID3FN_PICTURETYPE)->Get() == (uint32)pictype)
-        break;
+      return false;
     }
+    first->found = true;
+    return true;
   }
-  delete iter;
+}
 
-  if (NULL != frame)
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    bremoved = 1;
-  }
-  return bremoved;
+//following routine courtesy of John George
+size_t ID3_RemovePictureType(ID3_Tag* tag, ID3_PictureType pictype)
+{
+  if (NULL == tag)
+    return 0;
+
+  FirstPicture first = { pictype, false };
+  return tag->RemoveFrames(isFirstPicture, &first);
 }
 
 //following routine courtesy of John George
@@ -782,6 +703,78 @@ size_t ID3_GetPictureDataOfPicTypeAndStartPosition(ID3_Tag* tag, const uchar*& d
   }
 }
 
+namespace
+{
+  ID3_Frame* findPicture(ID3_Tag* tag, ID3_PictureType pictype)
+  {
+    ID3_Frame* frame = NULL;
+    ID3_Tag::Iterator* iter = tag->CreateIterator();
+
+    while (NULL != (frame = iter->GetNext()))
+    {
+      if (frame->GetID() == ID3FID_PICTURE &&
+          frame->GetField(ID3FN_PICTURETYPE)->Get() == (uint32)pictype)
+        break;
+    }
+    delete iter;
+    return frame;
+  }
+}
+
+size_t ID3_GetPictureDataOfPicType(ID3_Tag* tag, ID3_Writer& writer, ID3_PictureType pictype)
+{
+  if (NULL == tag)
+    return 0;
+
+  ID3_Frame* frame = findPicture(tag, pictype);
+  if (frame != NULL)
+  {
+    ID3_Field* myField = frame->GetField(ID3FN_DATA);
+    if (myField != NULL)
+      return myField->ToWriter(writer);
+  }
+  return 0;
+}
+
+size_t ID3_GetPictureDataOfPicTypeToFd(ID3_Tag* tag, int fd, ID3_PictureType pictype)
+{
+  long pos = ::lseek(fd, 0, SEEK_CUR);
+  if (pos < 0)
+    return 0;
+
+  ID3_FDWriter out(fd, pos);
+  size_t size = ID3_GetPictureDataOfPicType(tag, out, pictype);
+  out.flush();
+  ::lseek(fd, pos + size, SEEK_SET);
+  return out.good() ? size : 0;
+}
+
+ID3_Frame* ID3_AttachPicture(ID3_Tag *tag, int fd, const char *MimeType, ID3_PictureType pictype, const char* Description, bool replace)
+{
+  ID3_Frame* frame = NULL;
+#if defined HAVE_SYS_STAT_H
+  struct stat fileStat;
+  if (NULL != tag && fstat(fd, &fileStat) == 0)
+  {
+    if (replace)
+      ID3_RemovePictureType(tag, pictype);
+    if (replace || NULL == tag->Find(ID3FID_PICTURE))
+    {
+      frame = new ID3_Frame(ID3FID_PICTURE);
+      if (NULL != frame)
+      {
+        frame->GetField(ID3FN_DATA)->Attach(fd, 0, fileStat.st_size);
+        frame->GetField(ID3FN_MIMETYPE)->Set(MimeType);
+        frame->GetField(ID3FN_PICTURETYPE)->Set((uint32)pictype);
+        frame->GetField(ID3FN_DESCRIPTION)->Set(Description);
+        tag->AttachFrame(frame);
+      }
+    }
+  }
+#endif
+  return frame;
+}
+
 //following routine courtesy of John George
 char* ID3_GetMimeTypeOfPicType(ID3_Tag* tag, ID3_PictureType pictype)
 {
@@ -839,22 +832,12 @@ char* ID3_GetDescriptionOfPicType(ID3_Tag* tag, ID3_PictureType pictype)
 
 size_t ID3_RemoveTracks(ID3_Tag* tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame* frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_TRACKNUM)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_TRACKNUM);
 }
 
 char *ID3_GetGenre(const ID3_Tag *tag)
@@ -865,7 +848,7 @@ char *ID3_GetGenre(const ID3_Tag *tag)
     return sGenre;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_CONTENTTYPE);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_CONTENTTYPE);
   if (frame != NULL)
   {
     sGenre = ID3_GetString(frame, ID3FN_TEXT);
@@ -943,22 +926,12 @@ ID3_Frame* ID3_AddGenre(ID3_Tag *tag, size_t genreNum, bool replace)
 
 size_t ID3_RemoveGenres(ID3_Tag *tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame *frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_CONTENTTYPE)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_CONTENTTYPE);
 }
 
 char *ID3_GetLyrics(const ID3_Tag *tag)
@@ -969,7 +942,7 @@ char *ID3_GetLyrics(const ID3_Tag *tag)
     return sLyrics;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_UNSYNCEDLYRICS);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_UNSYNCEDLYRICS);
   if (frame != NULL)
   {
     sLyrics = ID3_GetString(frame, ID3FN_TEXT);
@@ -1016,22 +989,12 @@ ID3_Frame* ID3_AddLyrics(ID3_Tag *tag, const char *text, const char* desc,
 
 size_t ID3_RemoveLyrics(ID3_Tag *tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame *frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_UNSYNCEDLYRICS)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_UNSYNCEDLYRICS);
 }
 
 char *ID3_GetLyricist(const ID3_Tag *tag)
@@ -1042,7 +1005,7 @@ char *ID3_GetLyricist(const ID3_Tag *tag)
     return sLyricist;
   }
 
-  ID3_Frame *frame = tag->Find(ID3FID_LYRICIST);
+  ID3_Frame *frame = tag->FindFirst(ID3FID_LYRICIST);
   if (frame != NULL)
   {
     sLyricist = ID3_GetString(frame, ID3FN_TEXT);
@@ -1075,22 +1038,12 @@ ID3_Frame* ID3_AddLyricist(ID3_Tag *tag, const char *text, bool replace)
 
 size_t ID3_RemoveLyricist(ID3_Tag *tag)
 {
-  size_t num_removed = 0;
-  ID3_Frame *frame = NULL;
-
   if (NULL == tag)
   {
-    return num_removed;
-  }
-
-  while ((frame = tag->Find(ID3FID_LYRICIST)))
-  {
-    frame = tag->RemoveFrame(frame);
-    delete frame;
-    num_removed++;
+    return 0;
   }
 
-  return num_removed;
+  return tag->RemoveFrames(ID3FID_LYRICIST);
 }
 
 ID3_Frame* ID3_AddSyncLyrics(ID3_Tag *tag, const uchar *data, size_t datasize,
@@ -1238,3 +1191,261 @@ ID3_Frame *ID3_GetSyncLyrics(const ID3_Tag* tag, const char* lang,
   return frmExist;
 }
 
+namespace
+{
+  // Appends the code point c to buffer as UTF-8, if it fits in what is left
+  // of size (keeping room for the terminator).  Returns false if it doesn't.
+  bool putUtf8(char* buffer, size_t size, size_t& len, uint32 c)
+  {
+    char bytes[4];
+    size_t n = 0;
+    if (c < 0x80)
+    {
+      bytes[n++] = static_cast<char>(c);
+    }
+    else if (c < 0x800)
+    {
+      bytes[n++] = static_cast<char>(0xC0 | (c >> 6));
+      bytes[n++] = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000)
+    {
+      bytes[n++] = static_cast<char>(0xE0 | (c >> 12));
+      bytes[n++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      bytes[n++] = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else
+    {
+      bytes[n++] = static_cast<char>(0xF0 | (c >> 18));
+      bytes[n++] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      bytes[n++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      bytes[n++] = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    if (len + n >= size)
+    {
+      return false;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+      buffer[len++] = bytes[i];
+    }
+    return true;
+  }
+
+  // Copies the text of the frame's text field into buffer as UTF-8, straight
+  // from the field, cutting it short at a character if it doesn't fit.
+  void getUtf8(const ID3_Frame* frame, char* buffer, size_t size)
+  {
+    size_t len = 0;
+    const ID3_Field* fld = frame->GetField(ID3FN_TEXT);
+    const char* text = fld ? fld->GetRawText() : NULL;
+    if (text != NULL)
+    {
+      ID3_TextEnc enc = fld->GetEncoding();
+      if (ID3TE_IS_DOUBLE_BYTE_ENC(enc))
+      {
+        // in the byte order the field keeps it in, as dami::convert() reads it
+        const unicode_t* unicode = reinterpret_cast<const unicode_t*>(text);
+        for (size_t i = 0; unicode[i] != 0; ++i)
+        {
+          uint32 c = unicode[i];
+          if (c >= 0xD800 && c < 0xDC00 &&
+              unicode[i + 1] >= 0xDC00 && unicode[i + 1] < 0xE000)
+          {
+            c = 0x10000 + ((c - 0xD800) << 10) + (unicode[++i] - 0xDC00);
+          }
+          if (!putUtf8(buffer, size, len, c))
+          {
+            break;
+          }
+        }
+      }
+      else if (enc == ID3TE_UTF8)
+      {
+        len = dami::min(::strlen(text), size - 1);
+        // don't leave half a character behind
+        if (text[len] != '\0')
+        {
+          while (len > 0 && (text[len] & 0xC0) == 0x80)
+          {
+            --len;
+          }
+        }
+        ::memcpy(buffer, text, len);
+      }
+      else
+      {
+        for (const uchar* ch = reinterpret_cast<const uchar*>(text); *ch; ++ch)
+        {
+          if (!putUtf8(buffer, size, len, *ch))
+          {
+            break;
+          }
+        }
+      }
+    }
+    buffer[len] = '\0';
+  }
+
+  // Reads the leading number of text, and the one after a '/' if there is
+  // one, as in "3/12".
+  void getPosition(const char* text, uint32& pos, uint32& total)
+  {
+    pos = 0;
+    total = 0;
+    for (; *text >= '0' && *text <= '9'; ++text)
+    {
+      pos = pos * 10 + (*text - '0');
+    }
+    if (*text == '/')
+    {
+      for (++text; *text >= '0' && *text <= '9'; ++text)
+      {
+        total = total * 10 + (*text - '0');
+      }
+    }
+  }
+}
+
+bool ID3_GetCommonTags(const ID3_Tag* tag, ID3_CommonTags* common)
+{
+  if (NULL == tag || NULL == common)
+    return false;
+
+  ::memset(common, 0, sizeof(ID3_CommonTags));
+
+  char number[ID3_COMMON_YEAR_SIZE];
+  bool hasYear = false, hasTrack = false, hasDisc = false, hasLength = false;
+  bool hasCover = false;
+  ID3_Tag::ConstIterator* iter = tag->CreateIterator();
+  const ID3_Frame* frame = NULL;
+  while (NULL != (frame = iter->GetNext()))
+  {
+    switch (frame->GetID())
+    {
+      case ID3FID_TITLE:
+        if (!*common->title)
+          getUtf8(frame, common->title, sizeof(common->title));
+        break;
+      case ID3FID_LEADARTIST:
+        if (!*common->artist)
+          getUtf8(frame, common->artist, sizeof(common->artist));
+        break;
+      case ID3FID_BAND:
+        if (!*common->album_artist)
+          getUtf8(frame, common->album_artist, sizeof(common->album_artist));
+        break;
+      case ID3FID_ALBUM:
+        if (!*common->album)
+          getUtf8(frame, common->album, sizeof(common->album));
+        break;
+      case ID3FID_YEAR:
+        // TYER wins over TDRC
+        if (!hasYear)
+        {
+          getUtf8(frame, common->year, sizeof(common->year));
+          hasYear = true;
+        }
+        break;
+      case ID3FID_RECORDINGTIME:
+        if (!*common->year)
+          getUtf8(frame, common->year, sizeof(common->year));
+        break;
+      case ID3FID_CONTENTTYPE:
+        if (!*common->genre)
+          getUtf8(frame, common->genre, sizeof(common->genre));
+        break;
+      case ID3FID_COMPOSER:
+        if (!*common->composer)
+          getUtf8(frame, common->composer, sizeof(common->composer));
+        break;
+      case ID3FID_TRACKNUM:
+        if (!hasTrack)
+        {
+          getUtf8(frame, number, sizeof(number));
+          getPosition(number, common->track, common->tracks);
+          hasTrack = true;
+        }
+        break;
+      case ID3FID_PARTINSET:
+        if (!hasDisc)
+        {
+          getUtf8(frame, number, sizeof(number));
+          getPosition(number, common->disc, common->discs);
+          hasDisc = true;
+        }
+        break;
+      case ID3FID_ITUNESCOMPILATION:
+      {
+        // kept as it is in the tag: an encoding byte, then "1" in it
+        const ID3_Field* fld = frame->GetField(ID3FN_DATA);
+        const uchar* data = fld ? fld->GetRawBinary() : NULL;
+        size_t size = data ? fld->Size() : 0;
+        size_t i = 1;
+        while (i < size && (data[i] < '0' || data[i] > '9'))
+          ++i;
+        common->compilation = i < size && data[i] == '1';
+        break;
+      }
+      case ID3FID_SONGLEN:
+        if (!hasLength)
+        {
+          uint32 tracks;
+          getUtf8(frame, number, sizeof(number));
+          getPosition(number, common->duration, tracks);
+          hasLength = true;
+        }
+        break;
+      case ID3FID_PICTURE:
+      {
+        ID3_Field* data = frame->GetField(ID3FN_DATA);
+        ID3_Field* type = frame->GetField(ID3FN_PICTURETYPE);
+        bool cover = type && type->Get() == (uint32)ID3PT_COVERFRONT;
+        if (data && !hasCover && (cover || !common->picture_size))
+        {
+          const ID3_Field* mime = frame->GetField(ID3FN_MIMETYPE);
+          const char* text = mime ? mime->GetRawText() : NULL;
+          common->picture_offset = data->GetBinaryStartPosition();
+          common->picture_size = data->Size();
+          common->picture_mimetype[0] = '\0';
+          if (text)
+          {
+            ::strncat(common->picture_mimetype, text, 
+                      sizeof(common->picture_mimetype) - 1);
+          }
+          hasCover = cover;
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+  delete iter;
+
+  if (!hasLength)
+  {
+    const Mp3_Headerinfo* info = tag->GetMp3HeaderInfo();
+    if (info)
+    {
+      common->duration = info->milliseconds ? info->milliseconds 
+                                            : info->time * 1000;
+    }
+  }
+  return true;
+}
+
+size_t ID3_UpdateV1Tags(ID3_Tag* const tags[], size_t count)
+{
+  size_t updated = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    // tags whose v1 data hasn't changed cost nothing: Update() returns
+    // without opening the file
+    if (tags[i] && (tags[i]->Update(ID3TT_ID3V1) & ID3TT_ID3V1))
+    {
+      ++updated;
+    }
+  }
+  return updated;
+}
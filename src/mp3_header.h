@@ -28,6 +28,7 @@
 #ifndef _MP3_HEADER_H_
 #define _MP3_HEADER_H_
 
+#include <vector>
 #include "io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 
 class ID3_TagImpl;
@@ -36,12 +37,21 @@ class Mp3Info
 public:
 	friend class ID3_TagImpl;
 
-  Mp3Info() { _mp3_header_output = new Mp3_Headerinfo; };
+  Mp3Info() : _audio_beg(0), _audio_end(0), _seek_step(0), _seek_end(0), _seek_duration(0), _seek_exact(false)
+  { _mp3_header_output = new Mp3_Headerinfo; };
   ~Mp3Info() { this->Clean(); };
   void Clean();
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const { return _mp3_header_output; };
   bool Parse(ID3_Reader&, size_t mp3size);
+  bool ParseFrames(ID3_Reader&, size_t mp3size);
+  static bool FindSync(ID3_Reader&, size_t window);
+
+  bool TimeToOffset(uint32 milliseconds, size_t& offset) const;
+  bool OffsetToTime(size_t offset, uint32& milliseconds) const;
+
+  void Verify(int fd, Mp3_Integrity&, uint32* corrupt, size_t max, 
+              size_t threads) const;
 
   Mpeg_Layers Layer() const { return _mp3_header_output->layer; };
   Mpeg_Version Version() const { return _mp3_header_output->version; };
@@ -58,62 +68,26 @@ public:
   bool Copyrighted() const { return _mp3_header_output->copyrighted; };
   bool Original() const { return _mp3_header_output->original; };
   uint32 Seconds() const { return _mp3_header_output->time; };
+  uint32 Milliseconds() const { return _mp3_header_output->milliseconds; };
+  uint32 AvgBitrate() const { return _mp3_header_output->avg_bitrate; };
+  uint32 AudioStart() const { return _mp3_header_output->audio_start; };
+  uint32 AudioEnd() const { return _mp3_header_output->audio_end; };
 
 private:
-
-#ifdef _LINUX
-#pragma pack(push, 1)	/* required pragma syntax on LINUX */
-#else
-#pragma pack(push)  /* push current alignment to stack */
-#pragma pack(1)     /* set alignment to 1 byte boundary */
-#endif
-
-  struct _mp3_header_internal //http://www.mp3-tech.org/programmer/frame_header.html
-  {
-//byte 1
-    unsigned char frame_sync_a : 8; /* all bits should be set */
-//byte 2
-#ifdef __BIG_ENDIAN__
-    unsigned char frame_sync_b : 3; /* all bits should be set */
-    unsigned char id : 2;
-    unsigned char layer : 2;
-    unsigned char protection_bit : 1;
-#else
-    unsigned char protection_bit : 1;
-    unsigned char layer : 2;
-    unsigned char id : 2;
-    unsigned char frame_sync_b : 3; /* all bits should be set */
-#endif
-//byte 3
-#ifdef __BIG_ENDIAN__
-    unsigned char bitrate_index : 4;
-    unsigned char frequency : 2;
-    unsigned char padding_bit : 1;
-    unsigned char private_bit : 1;
-#else
-    unsigned char private_bit : 1;
-    unsigned char padding_bit : 1;
-    unsigned char frequency : 2;
-    unsigned char bitrate_index : 4;
-#endif
-//byte 4
-#ifdef __BIG_ENDIAN__
-    unsigned char mode : 2;
-    unsigned char mode_ext : 2;//only used in joint stereo
-    unsigned char copyright : 1;
-    unsigned char original : 1;
-    unsigned char emphasis : 2;
-#else
-    unsigned char emphasis : 2;
-    unsigned char original : 1;
-    unsigned char copyright : 1;
-    unsigned char mode_ext : 2;//only used in joint stereo
-    unsigned char mode : 2;
-#endif
-  };
-#pragma pack(pop)   /* restore original alignment from stack */
+  void SetSeekTable(ID3_Reader&, size_t mp3size, const Mp3_FrameHeader&,
+                    const uchar* toc);
 
   Mp3_Headerinfo* _mp3_header_output;
+  uint32 _audio_beg; // the frames, from the first
+  uint32 _audio_end;
+
+  // where the audio is every _seek_step milliseconds, from the Xing toc,
+  // the VBRI table or the frame walk, up to _seek_end at _seek_duration
+  std::vector<uint32> _seek_offsets;
+  double _seek_step;
+  uint32 _seek_end;
+  uint32 _seek_duration;
+  bool   _seek_exact; // the offsets are those of frames
 }; //Info
 
 #endif /* _MP3_HEADER_H_ */
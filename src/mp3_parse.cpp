@@ -25,14 +25,25 @@
 // id3lib.  These files are distributed with id3lib at
 // http://download.sourceforge.net/id3lib/
 
+#include <string.h>
+#include <algorithm>
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 #include "mp3_header.h"
+#include "thread_pool.h"
+#include "id3/misc_support.h"
+
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
 
 #define FRAMES_FLAG     0x0001
 #define BYTES_FLAG      0x0002
 #define TOC_FLAG        0x0004
 #define SCALE_FLAG      0x0008
 
-static int ExtractI4(unsigned char *buf)
+static int ExtractI4(const unsigned char *buf)
 {
   int x;
   // big endian extract
@@ -65,174 +76,369 @@ uint32 fto_nearest_i(float f)
     return i;
 }
 
-uint16 calcCRC(char *pFrame, size_t audiodatasize)
+namespace
 {
-  size_t icounter;
-  int tmpchar, crcmask, tmpi;
-  uint16 crc = 0xffff;
-
-  for (icounter = 2;  icounter < audiodatasize;  ++icounter)
+  // The mpeg audio crc-16 (polynomial 0x8005, most significant bit first)
+  // a table at a time: TABLE[0] is the crc of each byte value, and each
+  // TABLE[k] that of each byte value followed by k zero bytes, so eight
+  // bytes can be taken at once ("slicing-by-8").
+  class Crc16Tables
   {
-    if (icounter != 4  &&  icounter != 5) //skip the 2 chars of the crc itself
+  public:
+    uint16 TABLE[8][256];
+
+    Crc16Tables()
     {
-      crcmask = 1 << 8;
-      tmpchar = pFrame[icounter];
-      while (crcmask >>= 1)
+      for (size_t b = 0; b < 256; ++b)
+      {
+        uint16 crc = b << 8;
+        for (size_t bit = 0; bit < 8; ++bit)
+        {
+          crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : (crc << 1);
+        }
+        TABLE[0][b] = crc;
+      }
+      for (size_t k = 1; k < 8; ++k)
       {
-        tmpi = crc & 0x8000;
-        crc <<= 1;
-        if (!tmpi ^ !(tmpchar & crcmask))
-          crc ^= 0x8005;
+        for (size_t b = 0; b < 256; ++b)
+        {
+          const uint16 crc = TABLE[k - 1][b];
+          TABLE[k][b] = (crc << 8) ^ TABLE[0][crc >> 8];
+        }
       }
     }
+  };
+
+  const Crc16Tables CRC16;
+
+  uint16 crc16(uint16 crc, const uchar* data, size_t len)
+  {
+    const uint16 (*T)[256] = CRC16.TABLE;
+    for (; len >= 8; data += 8, len -= 8)
+    {
+      crc = T[7][data[0] ^ (crc >> 8)] ^ T[6][data[1] ^ (crc & 0xFF)] ^
+            T[5][data[2]] ^ T[4][data[3]] ^ T[3][data[4]] ^ T[2][data[5]] ^
+            T[1][data[6]] ^ T[0][data[7]];
+    }
+    for (; len > 0; ++data, --len)
+    {
+      crc = (crc << 8) ^ T[0][(crc >> 8) ^ *data];
+    }
+    return crc;
   }
-  crc &= 0xffff;
-  return crc;
 }
 
-void Mp3Info::Clean()
+uint16 calcCRC(char *pFrame, size_t audiodatasize)
 {
-  if (_mp3_header_output != NULL)
-    delete _mp3_header_output;
-  _mp3_header_output = NULL;
+  if (audiodatasize <= 2)
+  {
+    return 0xffff;
+  }
+  //skip the 2 chars of the crc itself
+  const uchar* frame = reinterpret_cast<const uchar*>(pFrame);
+  uint16 crc = crc16(0xffff, frame + 2, dami::min<size_t>(audiodatasize, 4) - 2);
+  if (audiodatasize > 6)
+  {
+    crc = crc16(crc, frame + 6, audiodatasize - 6);
+  }
+  return crc;
 }
 
-using namespace dami;
-
-bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
+namespace
 {
-  MP3_BitRates _mp3_bitrates[2][3][16] =
-  {
-    {
-      { //MPEG 1, LAYER I
-        MP3BITRATE_NONE,
-        MP3BITRATE_32K,
-        MP3BITRATE_64K,
-        MP3BITRATE_96K,
-        MP3BITRATE_128K,
-        MP3BITRATE_160K,
-        MP3BITRATE_192K,
-        MP3BITRATE_224K,
-        MP3BITRATE_256K,
-        MP3BITRATE_288K,
-        MP3BITRATE_320K,
-        MP3BITRATE_352K,
-        MP3BITRATE_384K,
-        MP3BITRATE_416K,
-        MP3BITRATE_448K,
-        MP3BITRATE_FALSE
-      },
-      { //MPEG 1, LAYER II
-        MP3BITRATE_NONE,
-        MP3BITRATE_32K,
-        MP3BITRATE_48K,
-        MP3BITRATE_56K,
-        MP3BITRATE_64K,
-        MP3BITRATE_80K,
-        MP3BITRATE_96K,
-        MP3BITRATE_112K,
-        MP3BITRATE_128K,
-        MP3BITRATE_160K,
-        MP3BITRATE_192K,
-        MP3BITRATE_224K,
-        MP3BITRATE_256K,
-        MP3BITRATE_320K,
-        MP3BITRATE_384K,
-        MP3BITRATE_FALSE
-      },
-      { //MPEG 1, LAYER III
-        MP3BITRATE_NONE,
-        MP3BITRATE_32K,
-        MP3BITRATE_40K,
-        MP3BITRATE_48K,
-        MP3BITRATE_56K,
-        MP3BITRATE_64K,
-        MP3BITRATE_80K,
-        MP3BITRATE_96K,
-        MP3BITRATE_112K,
-        MP3BITRATE_128K,
-        MP3BITRATE_160K,
-        MP3BITRATE_192K,
-        MP3BITRATE_224K,
-        MP3BITRATE_256K,
-        MP3BITRATE_320K,
-        MP3BITRATE_FALSE
-      }
+  const size_t VBRI_OFFSET = 4 + 32;
+  const size_t LAME_EXTENSION_SIZE = 36;
+  // the largest xing header with its LAME extension, after a frame header,
+  // crc and side information
+  const size_t VBR_BLOCK_SIZE = 4 + 2 + 32 + 120 + LAME_EXTENSION_SIZE;
+
+  // bitrates in kbit/s, by [mpeg 1 or not][layer I, II or III][index]
+  const uint16 FRAME_BITRATES[2][3][16] =
+  {
+    {
+      { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+      { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+      { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 0 }
     },
     {
-      { //MPEG 2 or 2.5, LAYER I
-        MP3BITRATE_NONE,
-        MP3BITRATE_32K,
-        MP3BITRATE_48K,
-        MP3BITRATE_56K,
-        MP3BITRATE_64K,
-        MP3BITRATE_80K,
-        MP3BITRATE_96K,
-        MP3BITRATE_112K,
-        MP3BITRATE_128K,
-        MP3BITRATE_144K,
-        MP3BITRATE_160K,
-        MP3BITRATE_176K,
-        MP3BITRATE_192K,
-        MP3BITRATE_224K,
-        MP3BITRATE_256K,
-        MP3BITRATE_FALSE
-      },
-      { //MPEG 2 or 2.5, LAYER II
-        MP3BITRATE_NONE,
-        MP3BITRATE_8K,
-        MP3BITRATE_16K,
-        MP3BITRATE_24K,
-        MP3BITRATE_32K,
-        MP3BITRATE_40K,
-        MP3BITRATE_48K,
-        MP3BITRATE_56K,
-        MP3BITRATE_64K,
-        MP3BITRATE_80K,
-        MP3BITRATE_96K,
-        MP3BITRATE_112K,
-        MP3BITRATE_128K,
-        MP3BITRATE_144K,
-        MP3BITRATE_160K,
-        MP3BITRATE_FALSE
-      },
-      { //MPEG 2 or 2.5, LAYER III
-        MP3BITRATE_NONE,
-        MP3BITRATE_8K,
-        MP3BITRATE_16K,
-        MP3BITRATE_24K,
-        MP3BITRATE_32K,
-        MP3BITRATE_40K,
-        MP3BITRATE_48K,
-        MP3BITRATE_56K,
-        MP3BITRATE_64K,
-        MP3BITRATE_80K,
-        MP3BITRATE_96K,
-        MP3BITRATE_112K,
-        MP3BITRATE_128K,
-        MP3BITRATE_144K,
-        MP3BITRATE_160K,
-        MP3BITRATE_FALSE
-      }
+      { 0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+      { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160, 0 },
+      { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160, 0 }
     }
   };
 
-  Mp3_Frequencies _mp3_frequencies[4][4] =
+  // sample rates, by [version bits][frequency bits]
+  const uint32 FRAME_FREQUENCIES[4][4] =
+  {
+    { 11025, 12000,  8000, 0 }, // MPEG 2.5
+    {     0,     0,     0, 0 }, // reserved
+    { 22050, 24000, 16000, 0 }, // MPEG 2
+    { 44100, 48000, 32000, 0 }  // MPEG 1
+  };
+
+  // samples per frame, by [mpeg 1 or not][layer I, II or III]
+  const uint16 FRAME_SAMPLES[2][3] =
   {
-    { MP3FREQUENCIES_11025HZ, MP3FREQUENCIES_12000HZ, MP3FREQUENCIES_8000HZ,MP3FREQUENCIES_Reserved },  //MPEGVERSION_2_5
-    { MP3FREQUENCIES_Reserved, MP3FREQUENCIES_Reserved, MP3FREQUENCIES_Reserved, MP3FREQUENCIES_Reserved},          //MPEGVERSION_Reserved
-    { MP3FREQUENCIES_22050HZ, MP3FREQUENCIES_24000HZ, MP3FREQUENCIES_16000HZ, MP3FREQUENCIES_Reserved }, //MPEGVERSION_2
-    { MP3FREQUENCIES_44100HZ, MP3FREQUENCIES_48000HZ, MP3FREQUENCIES_32000HZ, MP3FREQUENCIES_Reserved }  //MPEGVERSION_1
+    { 384, 1152, 1152 },
+    { 384, 1152,  576 }
   };
 
-  _mp3_header_internal *_tmpheader;
+  // bytes of layer III side information, by [mpeg 1 or not][mono or not]
+  const uint16 FRAME_SIDEINFO[2][2] =
+  {
+    { 32, 17 },
+    { 17,  9 }
+  };
+
+  uint32 headerAt(const uchar* p)
+  {
+    return (uint32(p[0]) << 24) | (uint32(p[1]) << 16) | 
+           (uint32(p[2]) << 8) | uint32(p[3]);
+  }
+
+  // Decodes the frame header at p, failing for free format frames as well
+  // as invalid ones: they can't be stepped over.
+  bool decodeFrame(const uchar* p, Mp3_FrameHeader& frame)
+  {
+    return ID3_DecodeMp3Header(headerAt(p), &frame) && frame.framesize > 0;
+  }
+
+  // Do the two headers belong to the same stream?  The version, layer and
+  // sample rate can't change from one frame to the next.
+  bool sameStream(const uchar a[4], const uchar b[4])
+  {
+    return (a[1] & 0xFE) == (b[1] & 0xFE) && (a[2] & 0x0C) == (b[2] & 0x0C);
+  }
+
+  // The offset of the first 0xFF in buf, or len if there's none.  Sixteen
+  // bytes are compared at a time where SSE2 is available; elsewhere memchr()
+  // is left to do the same.
+  size_t findFF(const uchar* buf, size_t len)
+  {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i ff = _mm_set1_epi8((char) 0xFF);
+    for (; i + 16 <= len; i += 16)
+    {
+      const __m128i bytes = 
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i));
+      const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, ff));
+      if (mask != 0)
+      {
+        return i + __builtin_ctz(mask);
+      }
+    }
+#endif
+    const void* found = memchr(buf + i, 0xFF, len - i);
+    return found ? static_cast<const uchar*>(found) - buf : len;
+  }
+
+  // Is the frame at frame a Xing, Info or VBRI frame, which holds no audio?
+  bool isInfoFrame(const Mp3_FrameHeader& header, const uchar* frame, 
+                   size_t length)
+  {
+    const size_t offset = 4 + (header.crc ? 2 : 0) + header.sideinfo;
+    return (offset + 4 <= length &&
+            (memcmp(frame + offset, "Xing", 4) == 0 || 
+             memcmp(frame + offset, "Info", 4) == 0)) ||
+           (VBRI_OFFSET + 4 <= length && 
+            memcmp(frame + VBRI_OFFSET, "VBRI", 4) == 0);
+  }
+
+  uint16 ExtractI2(const uchar *buf)
+  {
+    return (buf[0] << 8) | buf[1];
+  }
+
+  // A LAME ReplayGain field: the name code in the top three bits, then
+  // three bits for who set it, a sign bit and the gain in tenths of a dB.
+  bool replayGain(uint16 field, uint16 name, float& gain)
+  {
+    if ((field >> 13) != name)
+    {
+      return false;
+    }
+    gain = (field & 0x1FF) / 10.0f;
+    if (field & 0x200)
+    {
+      gain = -gain;
+    }
+    return true;
+  }
+
+  // The LAME extension follows the Xing or Info header, in the files of
+  // LAME and of the encoders that copied it.
+  void parseLame(const uchar* data, size_t len, Mp3_Headerinfo& info)
+  {
+    if (len < LAME_EXTENSION_SIZE ||
+        (memcmp(data, "LAME", 4) != 0 && memcmp(data, "Lavf", 4) != 0 &&
+         memcmp(data, "Lavc", 4) != 0))
+    {
+      return;
+    }
+    info.lame = true;
+    info.replaygain_peak = ExtractI4(data + 11) / 8388608.0f;
+    info.has_replaygain_track = 
+      replayGain(ExtractI2(data + 15), 1, info.replaygain_track);
+    info.has_replaygain_album = 
+      replayGain(ExtractI2(data + 17), 2, info.replaygain_album);
+    info.encoder_delay = (data[21] << 4) | (data[22] >> 4);
+    info.encoder_padding = ((data[22] & 0x0F) << 8) | data[23];
+    info.music_length = ExtractI4(data + 28);
+  }
+
+  // The Xing header, or the Info header LAME writes to CBR files, comes
+  // straight after the side information.
+  bool parseXing(const uchar* data, size_t len, size_t offset, 
+                 Mp3_Headerinfo& info, const uchar*& toc)
+  {
+    const size_t VBR_HEADER_MIN_SIZE = 8;     // "xing" + flags are fixed
+    if (len < offset + VBR_HEADER_MIN_SIZE)
+    {
+      return false;
+    }
+    const uchar* pvbrdata = data + offset;
+    if (memcmp(pvbrdata, "Xing", 4) == 0)
+    {
+      info.vbr_header = MP3VBRHEADER_XING;
+    }
+    else if (memcmp(pvbrdata, "Info", 4) == 0)
+    {
+      info.vbr_header = MP3VBRHEADER_INFO;
+    }
+    else
+    {
+      return false;
+    }
 
+    // get vbr flags
+    const int vbr_flags = ExtractI4(pvbrdata + 4);
+    pvbrdata += VBR_HEADER_MIN_SIZE;
+
+    //  is the entire vbr header there?
+    const size_t vbr_header_size = VBR_HEADER_MIN_SIZE
+                         + ((vbr_flags & FRAMES_FLAG)? 4:0)
+                         + ((vbr_flags & BYTES_FLAG)? 4:0)
+                         + ((vbr_flags & TOC_FLAG)? 100:0)
+                         + ((vbr_flags & SCALE_FLAG)? 4:0);
+    if (len < offset + vbr_header_size)
+    {
+      return true;
+    }
+
+    // get frames, bytes, toc and scale
+    if (vbr_flags & FRAMES_FLAG)
+    {
+      info.vbr_frames = ExtractI4(pvbrdata);
+      pvbrdata +=4;
+    }
+    if (vbr_flags & BYTES_FLAG)
+    {
+      info.vbr_bytes = ExtractI4(pvbrdata);
+      pvbrdata +=4;
+    }
+    if (vbr_flags & TOC_FLAG)
+    {
+      // seek offsets, in 256ths of the file, at each percent of the song
+      toc = pvbrdata;
+      pvbrdata +=100;
+    }
+    if (vbr_flags & SCALE_FLAG)
+    {
+      pvbrdata +=4;
+    }
+
+    parseLame(pvbrdata, len - (pvbrdata - data), info);
+    return true;
+  }
+
+  // The Fraunhofer encoder's VBRI header is at a fixed offset, whatever the
+  // side information.
+  bool parseVbri(const uchar* data, size_t len, Mp3_Headerinfo& info)
+  {
+    const size_t VBRI_HEADER_SIZE = 26; // without the toc
+    if (len < VBRI_OFFSET + VBRI_HEADER_SIZE || 
+        memcmp(data + VBRI_OFFSET, "VBRI", 4) != 0)
+    {
+      return false;
+    }
+    const uchar* vbri = data + VBRI_OFFSET;
+    info.vbr_header = MP3VBRHEADER_VBRI;
+    info.encoder_delay = ExtractI2(vbri + 6);
+    info.vbr_bytes = ExtractI4(vbri + 10);
+    info.vbr_frames = ExtractI4(vbri + 14);
+    return true;
+  }
+}
+
+bool ID3_DecodeMp3Header(uint32 header, Mp3_FrameHeader* info)
+{
+  const uint32 version   = (header >> 19) & 0x03;
+  const uint32 layer     = (header >> 17) & 0x03;
+  const uint32 bitrate   = (header >> 12) & 0x0F;
+  const uint32 frequency = (header >> 10) & 0x03;
+  if ((header & 0xFFE00000) != 0xFFE00000 || 
+      version == MPEGVERSION_Reserved || layer == MPEGLAYER_UNDEFINED ||
+      bitrate == 0x0F || frequency == 0x03)
+  {
+    return false;
+  }
+  if (info == NULL)
+  {
+    return true;
+  }
+
+  const size_t mpeg = (version == MPEGVERSION_1) ? 0 : 1;
+  const size_t index = MPEGLAYER_I - layer; // 0 for layer I
+  info->version = static_cast<Mpeg_Version>(version);
+  info->layer = static_cast<Mpeg_Layers>(layer);
+  info->channelmode = static_cast<Mp3_ChannelMode>((header >> 6) & 0x03);
+  info->bitrate = 1000 * FRAME_BITRATES[mpeg][index][bitrate];
+  info->frequency = FRAME_FREQUENCIES[version][frequency];
+  info->samples = FRAME_SAMPLES[mpeg][index];
+  // only layer III frames have side information
+  info->sideinfo = info->layer != MPEGLAYER_III ? 0u :
+    FRAME_SIDEINFO[mpeg][info->channelmode == MP3CHANNELMODE_SINGLE_CHANNEL];
+  info->crc = (header & 0x00010000) == 0;
+  info->padding = ((header >> 9) & 0x01) != 0;
+
+  //http://www.mp3-tech.org/programmer/frame_header.html
+  // See http://www.hydrogenaudio.org/forums/lofiversion/index.php/t43172.html
+  // and http://minnie.tuhs.org/pipermail/mp3encoder/2003-February/005598.html
+  // on discussion about the frame size calculation. --DmitryD
+  if (info->bitrate == 0)
+  {
+    info->framesize = 0; // free format, unable to determine
+  }
+  else if (info->layer == MPEGLAYER_I)
+  {
+    info->framesize = 4 * (12 * info->bitrate / info->frequency + info->padding);
+  }
+  else
+  {
+    info->framesize = 
+      info->samples / 8 * info->bitrate / info->frequency + info->padding;
+  }
+  return true;
+}
+
+void Mp3Info::Clean()
+{
+  if (_mp3_header_output != NULL)
+    delete _mp3_header_output;
+  _mp3_header_output = NULL;
+}
+
+using namespace dami;
+
+bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
+{
   const size_t HEADERSIZE = 4;//
-  char buf[HEADERSIZE+1]; //+1 to hold the \0 char
+  uchar buf[HEADERSIZE];
   ID3_Reader::pos_type beg = reader.getCur() ;
   ID3_Reader::pos_type end = beg + HEADERSIZE ;
+  const ID3_Reader::pos_type frame_beg = beg;
   reader.setCur(beg);
-  int bitrate_index;
 
   _mp3_header_output->layer = MPEGLAYER_FALSE;
   _mp3_header_output->version = MPEGVERSION_FALSE;
@@ -246,190 +452,62 @@ bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
   _mp3_header_output->frames = 0;
   _mp3_header_output->time = 0;
   _mp3_header_output->vbr_bitrate = 0;
+  _mp3_header_output->milliseconds = 0;
+  _mp3_header_output->avg_bitrate = 0;
+  _mp3_header_output->audio_start = 0;
+  _mp3_header_output->audio_end = 0;
+  _mp3_header_output->vbr_header = MP3VBRHEADER_NONE;
+  _mp3_header_output->vbr_frames = 0;
+  _mp3_header_output->vbr_bytes = 0;
+  _mp3_header_output->lame = false;
+  _mp3_header_output->encoder_delay = 0;
+  _mp3_header_output->encoder_padding = 0;
+  _mp3_header_output->music_length = 0;
+  _mp3_header_output->replaygain_peak = 0;
+  _mp3_header_output->replaygain_track = 0;
+  _mp3_header_output->replaygain_album = 0;
+  _mp3_header_output->has_replaygain_track = false;
+  _mp3_header_output->has_replaygain_album = false;
 
-  reader.readChars(buf, HEADERSIZE);
-  buf[HEADERSIZE]='\0';
-  // copy the pointer to the struct
-
-  if (((buf[0] & 0xFF) != 0xFF) || ((buf[1] & 0xE0) != 0xE0)) //first 11 bits should be 1
-  {
-    this->Clean();
-    return false;
-  }
-
-  _tmpheader = reinterpret_cast<_mp3_header_internal *>(buf);
-
-  bitrate_index = 0;
-  switch (_tmpheader->id)
-  {
-    case 3:
-      _mp3_header_output->version = MPEGVERSION_1;
-      bitrate_index = 0;
-      break;
-    case 2:
-      _mp3_header_output->version = MPEGVERSION_2;
-      bitrate_index = 1;
-      break;
-    case 1:
-      this->Clean();
-      return false; //wouldn't know how to handle it
-      break;
-    case 0:
-      _mp3_header_output->version = MPEGVERSION_2_5;
-      bitrate_index = 1;
-      break;
-    default:
-      this->Clean();
-      return false;
-      break;
-  };
-
-  switch (_tmpheader->layer)
-  {
-    case 3:
-      _mp3_header_output->layer = MPEGLAYER_I;
-      break;
-    case 2:
-      _mp3_header_output->layer = MPEGLAYER_II;
-      break;
-    case 1:
-      _mp3_header_output->layer = MPEGLAYER_III;
-      break;
-    case 0:
-      this->Clean();
-      return false; //wouldn't know how to handle it
-      break;
-    default:
-      this->Clean();
-      return false; //how can two unsigned bits be something else??
-      break;
-  };
-
-  // mpegversion, layer and bitrate are all valid
-  _mp3_header_output->bitrate = _mp3_bitrates[bitrate_index][3-_tmpheader->layer][_tmpheader->bitrate_index];
-  if (_mp3_header_output->bitrate == MP3BITRATE_FALSE)
+  Mp3_FrameHeader frame;
+  if (reader.readChars(buf, HEADERSIZE) < HEADERSIZE)
   {
-    this->Clean();
     return false;
   }
-  _mp3_header_output->frequency = _mp3_frequencies[_tmpheader->id][_tmpheader->frequency];
-  if (_mp3_header_output->frequency == MP3FREQUENCIES_Reserved)
+  const uint32 header = headerAt(buf);
+  if (!ID3_DecodeMp3Header(header, &frame))
   {
-    this->Clean();
     return false;
   }
 
-  _mp3_header_output->privatebit = (bool)_tmpheader->private_bit;
-  _mp3_header_output->copyrighted = (bool)_tmpheader->copyright;
-  _mp3_header_output->original = (bool)_tmpheader->original;
-  _mp3_header_output->crc = (Mp3_Crc)!(bool)_tmpheader->protection_bit;
-
-  switch (_tmpheader->mode)
-  {
-  case 3:
-    _mp3_header_output->channelmode = MP3CHANNELMODE_SINGLE_CHANNEL;
-    break;
-  case 2:
-    _mp3_header_output->channelmode = MP3CHANNELMODE_DUAL_CHANNEL;
-    break;
-  case 1:
-    _mp3_header_output->channelmode = MP3CHANNELMODE_JOINT_STEREO;
-    break;
-  case 0:
-    _mp3_header_output->channelmode = MP3CHANNELMODE_STEREO;
-    break;
-  default:
-    this->Clean();
-    return false; //wouldn't know how to handle it
-    break;
-  }
+  // mpegversion, layer and bitrate are all valid
+  _mp3_header_output->version = frame.version;
+  _mp3_header_output->layer = frame.layer;
+  _mp3_header_output->bitrate = static_cast<MP3_BitRates>(frame.bitrate);
+  _mp3_header_output->frequency = frame.frequency;
+  _mp3_header_output->framesize = frame.framesize;
+  _mp3_header_output->channelmode = frame.channelmode;
+  _mp3_header_output->crc = frame.crc ? MP3CRC_OK : MP3CRC_NONE;
+  _mp3_header_output->privatebit = ((header >> 8) & 0x01) != 0;
+  _mp3_header_output->copyrighted = ((header >> 3) & 0x01) != 0;
+  _mp3_header_output->original = ((header >> 2) & 0x01) != 0;
+  _mp3_header_output->emphasis = static_cast<Mp3_Emphasis>(header & 0x03);
 
   if (_mp3_header_output->channelmode == MP3CHANNELMODE_JOINT_STEREO)
   {
     // these have a different meaning for different layers, better give them a generic name in the enum
-    switch (_tmpheader->mode_ext)
-    {
-    case 3:
-      _mp3_header_output->modeext = MP3MODEEXT_3;
-      break;
-    case 2:
-      _mp3_header_output->modeext = MP3MODEEXT_2;
-      break;
-    case 1:
-      _mp3_header_output->modeext = MP3MODEEXT_1;
-      break;
-    case 0:
-      _mp3_header_output->modeext = MP3MODEEXT_0;
-      break;
-    default:
-      this->Clean();
-      return false; //wouldn't know how to handle it
-      break;
-    }
+    _mp3_header_output->modeext = static_cast<Mp3_ModeExt>((header >> 4) & 0x03);
   }
   else //it's valid to have a valid false one in this case, since it's only used with joint stereo
     _mp3_header_output->modeext = MP3MODEEXT_FALSE;
 
-  switch (_tmpheader->emphasis)
-  {
-  case 3:
-    _mp3_header_output->emphasis = MP3EMPHASIS_CCIT_J17;
-    break;
-  case 2:
-    _mp3_header_output->emphasis = MP3EMPHASIS_Reserved;
-    break;
-  case 1:
-    _mp3_header_output->emphasis = MP3EMPHASIS_50_15MS;
-    break;
-  case 0:
-    _mp3_header_output->emphasis = MP3EMPHASIS_NONE;
-    break;
-  default:
-    this->Clean();
-    return false; //wouldn't know how to handle it
-    break;
-  }
-
-//http://www.mp3-tech.org/programmer/frame_header.html
-  if (_mp3_header_output->bitrate != MP3BITRATE_NONE && _mp3_header_output->frequency > 0)
-  {
-
-    switch(_mp3_header_output->layer)
-    {
-      case MPEGLAYER_I: // Layer 1
-        _mp3_header_output->framesize = 4 * (12 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0));
-        break;
-      case MPEGLAYER_II: // Layer 2
-        _mp3_header_output->framesize = 144 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0);
-        break;
-      case MPEGLAYER_III: // Layer 3
-            // See http://www.hydrogenaudio.org/forums/lofiversion/index.php/t43172.html
-            // and http://minnie.tuhs.org/pipermail/mp3encoder/2003-February/005598.html
-            // on discussion about the frame size calculation. --DmitryD
-        if(_mp3_header_output->version == MPEGVERSION_1)
-          _mp3_header_output->framesize = 144 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0); //Mpeg1
-        else
-          _mp3_header_output->framesize =  72 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0); //Mpeg2 + Mpeg2.5
-        break;
-    }
-//    if (_mp3_header_output->layer == MPEGLAYER_I)
-//      _mp3_header_output->framesize = fto_nearest_i((float)((48 * (float)_mp3_header_output->bitrate) / _mp3_header_output->frequency)) + (_tmpheader->padding_bit ? 4 : 0);
-//    else
-//      _mp3_header_output->framesize = fto_nearest_i((float)((144 * (float)_mp3_header_output->bitrate) / _mp3_header_output->frequency)) + (_tmpheader->padding_bit ? 1 : 0);
-  }
-  else
-    _mp3_header_output->framesize = 0; //unable to determine
-
   const size_t CRCSIZE = 2;
-  size_t sideinfo_len;
-
-  if (_mp3_header_output->version == MPEGVERSION_1) /* MPEG 1 */
-    sideinfo_len = (_mp3_header_output->channelmode == MP3CHANNELMODE_SINGLE_CHANNEL) ? 4 + 17 : 4 + 32;
-  else                /* MPEG 2 */
-    sideinfo_len = (_mp3_header_output->channelmode == MP3CHANNELMODE_SINGLE_CHANNEL) ? 4 + 9 : 4 + 17;
+  size_t sideinfo_len = HEADERSIZE + frame.sideinfo;
 
-  int vbr_header_offest = beg + sideinfo_len;
-  int vbr_frames = 0;
+  // from the frame header; a crc comes between the header and the side
+  // information, as isInfoFrame() has it
+  const size_t vbr_header_offset = 
+    HEADERSIZE + (frame.crc ? CRCSIZE : 0) + frame.sideinfo;
 
   sideinfo_len += 2; // add two for the crc itself
 
@@ -466,106 +544,537 @@ bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
   // read xing/vbr header if present
   // derived from code in vbrheadersdk.zip 
   // from http://www.xingtech.com/developer/mp3/
+  // the LAME extension is described at http://gabriel.mp3-tech.org/mp3infotag.html
+  uchar vbrdata[VBR_BLOCK_SIZE];
+  reader.setCur(frame_beg);
+  const size_t vbrlen = 
+    reader.readChars(vbrdata, dami::min<size_t>(VBR_BLOCK_SIZE, mp3size));
 
-  const size_t VBR_HEADER_MIN_SIZE = 8;     // "xing" + flags are fixed
-  const size_t VBR_HEADER_MAX_SIZE = 120;   // frames, bytes, toc and scale are optional
+  const uchar* toc = NULL;
+  if (!parseXing(vbrdata, vbrlen, vbr_header_offset, *_mp3_header_output, toc))
+  {
+    parseVbri(vbrdata, vbrlen, *_mp3_header_output);
+  }
 
-  if (mp3size >= vbr_header_offest + VBR_HEADER_MIN_SIZE) 
+  const uint32 vbr_frames = _mp3_header_output->vbr_frames;
+  if (vbr_frames > 0 && _mp3_header_output->vbr_header != MP3VBRHEADER_INFO)
   {
-    char vbrheaderdata[VBR_HEADER_MAX_SIZE+1]; //+1 to hold the 0 char
-    unsigned char *pvbrdata = (unsigned char *)vbrheaderdata;
-    int vbr_filesize = 0;
-    int vbr_scale = 0;
-    int vbr_flags = 0;
+    const size_t vbr_filesize = _mp3_header_output->vbr_bytes;
+    _mp3_header_output->vbr_bitrate = (((vbr_filesize!=0) ? vbr_filesize : mp3size) / vbr_frames) * _mp3_header_output->frequency / (frame.samples / 8);
+    _mp3_header_output->vbr_bitrate -= _mp3_header_output->vbr_bitrate%1000;   // round the bitrate:
+  }
 
-    // get fixed part of vbr header 
-    // and check if valid
+  if (vbr_frames > 0)
+  {
+    // the frame count makes the length exact
+    const double seconds = (double) vbr_frames * frame.samples / frame.frequency;
+    _mp3_header_output->frames = vbr_frames;
+    _mp3_header_output->time = fto_nearest_i((float) seconds);
+    _mp3_header_output->milliseconds = fto_nearest_i((float) (seconds * 1000));
+  }
+  else if (_mp3_header_output->framesize > 0 && mp3size >= _mp3_header_output->framesize) // this means bitrate is not none too
+  {
+    _mp3_header_output->frames = fto_nearest_i((float)mp3size / _mp3_header_output->framesize);
 
-    beg = vbr_header_offest;
-    reader.setCur(beg);
-    reader.readChars(vbrheaderdata, VBR_HEADER_MIN_SIZE);
-    vbrheaderdata[VBR_HEADER_MIN_SIZE] = '\0';
-
-    if (pvbrdata[0] == 'X' &&
-        pvbrdata[1] == 'i' &&
-        pvbrdata[2] == 'n' &&
-        pvbrdata[3] == 'g')
-    {
-      // get vbr flags
-      pvbrdata += 4;
-      vbr_flags = ExtractI4(pvbrdata);
-      pvbrdata += 4;
-
-      //  read entire vbr header
-      int vbr_header_size = VBR_HEADER_MIN_SIZE
-                           + ((vbr_flags & FRAMES_FLAG)? 4:0)
-                           + ((vbr_flags & BYTES_FLAG)? 4:0)
-                           + ((vbr_flags & TOC_FLAG)? 100:0)
-                           + ((vbr_flags & SCALE_FLAG)? 4:0);
-
-      if (mp3size >= vbr_header_offest + vbr_header_size) 
+    // bitrate becomes byterate (per second) if divided by 8
+    _mp3_header_output->time = fto_nearest_i( (float)mp3size / (_mp3_header_output->bitrate / 8) );
+  }
+  else
+  {
+    _mp3_header_output->frames = 0;
+    _mp3_header_output->time = 0;
+  }
+  _audio_beg = frame_beg;
+  _audio_end = frame_beg + mp3size;
+  reader.setCur(frame_beg);
+  this->SetSeekTable(reader, mp3size, frame, toc);
+
+  //if we got to here it's okay
+  return true;
+}
+
+// Walks the frames from the reader's current position, stepping from one
+// header to the next, and replaces the estimated frame count and duration
+// with exact ones.  The audio is read sequentially, a block at a time.
+// Anything that isn't a frame header is skipped by looking for the next
+// sync, up to RESYNC_WINDOW bytes on; walking stops after mp3size bytes.
+// Also fills in the average bitrate and the range of the audio frames,
+// not counting a leading Xing or Info frame.
+bool Mp3Info::ParseFrames(ID3_Reader& reader, size_t mp3size)
+{
+  if (_mp3_header_output == NULL)
+  {
+    return false;
+  }
+
+  const size_t HEADERSIZE = 4;
+  const size_t BLOCKSIZE = 64 * 1024;
+  const size_t RESYNC_WINDOW = 4 * 1024;
+  const uint32 INDEX_STEP = 32; // frames between the entries of the seek table
+  BString block(BLOCKSIZE, '\0');
+  std::vector<uint32> index;
+  const ID3_Reader::pos_type start = reader.getCur();
+
+  size_t pos = 0;                    // of the next frame, from start
+  size_t blockPos = 0, blockLen = 0; // of the block, from start
+  size_t first = 0, last = 0;        // of the audio frames, from start
+  uint32 frames = 0, frequency = 0, frameSamples = 0;
+  double samples = 0;
+  while (pos + HEADERSIZE <= mp3size)
+  {
+    if (pos + HEADERSIZE > blockPos + blockLen)
+    {
+      // keep what's left of the block, and fill the rest from the reader
+      size_t keep = 0;
+      if (pos < blockPos + blockLen)
       {
-        reader.readChars(&vbrheaderdata[VBR_HEADER_MIN_SIZE], vbr_header_size - VBR_HEADER_MIN_SIZE); 
-        vbrheaderdata[vbr_header_size] = '\0';
+        keep = blockPos + blockLen - pos;
+        memmove(&block[0], &block[pos - blockPos], keep);
+      }
+      else
+      {
+        reader.setCur(start + pos);
+      }
+      blockPos = pos;
+      blockLen = keep + reader.readChars(&block[keep], 
+        dami::min<size_t>(BLOCKSIZE, mp3size - pos) - keep);
+      if (blockLen < HEADERSIZE)
+      {
+        break;
+      }
+    }
+
+    const uchar* data = block.data() + (pos - blockPos);
+    Mp3_FrameHeader frame;
+    if (!decodeFrame(data, frame) || 
+        (frequency != 0 && frame.frequency != frequency))
+    {
+      // junk between the frames: look for where they go on
+      reader.setCur(start + pos + 1);
+      if (!Mp3Info::FindSync(reader, RESYNC_WINDOW))
+      {
+        break;
+      }
+      pos = reader.getCur() - start;
+      blockPos = pos;
+      blockLen = 0;
+      continue;
+    }
+    if (frames > 0 || !isInfoFrame(frame, data, blockPos + blockLen - pos))
+    {
+      if (frames == 0)
+      {
+        first = pos;
+        frameSamples = frame.samples;
+      }
+      if (frames % INDEX_STEP == 0)
+      {
+        index.push_back(start + pos);
+      }
+      frequency = frame.frequency;
+      samples += frame.samples;
+      ++frames;
+      last = dami::min<size_t>(pos + frame.framesize, mp3size);
+    }
+    pos += frame.framesize;
+  }
 
-        // get frames, bytes, toc and scale
+  if (frames == 0)
+  {
+    return false;
+  }
+  const double seconds = samples / frequency;
+  _mp3_header_output->frames = frames;
+  _mp3_header_output->time = fto_nearest_i((float) seconds);
+  _mp3_header_output->milliseconds = fto_nearest_i((float) (seconds * 1000));
+  _mp3_header_output->avg_bitrate = 
+    fto_nearest_i((float) ((last - first) * 8 / seconds));
+  _mp3_header_output->audio_start = start + first;
+  _mp3_header_output->audio_end = start + last;
 
-        if (vbr_flags & FRAMES_FLAG)
-        {
-          vbr_frames = ExtractI4(pvbrdata); 
-          pvbrdata +=4;
-        }
+  // the frames found make a better seek table than any header
+  _seek_offsets.swap(index);
+  _seek_step = 1000.0 * INDEX_STEP * frameSamples / frequency;
+  _seek_end = _mp3_header_output->audio_end;
+  _seek_duration = _mp3_header_output->milliseconds;
+  _seek_exact = true;
+  return true;
+}
+
+// Moves the reader to the first frame header within window bytes of its
+// current position that is followed by at least SYNC_FRAMES - 1 more frames
+// of the same stream, or by the end of the reader.  The candidates are
+// found by scanning a block at a time for the sync byte and checking the
+// header alone; only the frames following a candidate are read separately.
+// The reader is left where it was if no sync is found.
+bool Mp3Info::FindSync(ID3_Reader& reader, size_t window)
+{
+  const size_t HEADERSIZE = 4;
+  const size_t BLOCKSIZE = 8 * 1024;
+  const size_t SYNC_FRAMES = 3;
+
+  const ID3_Reader::pos_type start = reader.getCur();
+  const ID3_Reader::pos_type end = reader.getEnd();
+  if (end <= start)
+  {
+    return false;
+  }
+  const ID3_Reader::pos_type last = 
+    start + dami::min<size_t>(window, end - start);
+
+  uchar block[BLOCKSIZE];
+  ID3_Reader::pos_type blockPos = start;
+  while (blockPos < last)
+  {
+    reader.setCur(blockPos);
+    const size_t blockLen = reader.readChars(block, 
+      dami::min<size_t>(BLOCKSIZE, end - blockPos));
+    if (blockLen < HEADERSIZE)
+    {
+      break;
+    }
+    // candidates must have their whole header in this block, and start
+    // within the window
+    const size_t scanLen = 
+      dami::min<size_t>(blockLen - HEADERSIZE + 1, last - blockPos);
+
+    for (size_t i = findFF(block, scanLen); i < scanLen; 
+         i += 1 + findFF(block + i + 1, scanLen - i - 1))
+    {
+      const uchar* hdr = block + i;
+      Mp3_FrameHeader frame;
+      if (!decodeFrame(hdr, frame))
+      {
+        continue;
+      }
 
-        if (vbr_flags & BYTES_FLAG)
+      // follow the frames after it
+      ID3_Reader::pos_type pos = blockPos + i + frame.framesize;
+      size_t frames = 1;
+      while (frames < SYNC_FRAMES && pos + HEADERSIZE <= end)
+      {
+        uchar next[HEADERSIZE];
+        if (pos + HEADERSIZE <= blockPos + blockLen)
         {
-          vbr_filesize = ExtractI4(pvbrdata); 
-          pvbrdata +=4;
+          memcpy(next, block + (pos - blockPos), HEADERSIZE);
         }
-
-        if (vbr_flags & TOC_FLAG)
+        else
         {
-          // seek offsets
-          // we are not using
-          // for(i=0;i<100;i++) seek_offsets[i] = pvbrdata[i];
-
-          pvbrdata +=100;
+          reader.setCur(pos);
+          reader.readChars(next, HEADERSIZE);
         }
-
-        if (vbr_flags & SCALE_FLAG)
+        if (!decodeFrame(next, frame) || !sameStream(hdr, next))
         {
-          vbr_scale = ExtractI4(pvbrdata); 
-          pvbrdata +=4;
+          break;
         }
+        pos += frame.framesize;
+        ++frames;
+      }
+      if (frames == SYNC_FRAMES || pos + HEADERSIZE > end)
+      {
+        reader.setCur(blockPos + i);
+        return true;
+      }
+    }
+    // the last few bytes of this block start the next one, so that a header
+    // straddling the two is seen whole
+    blockPos += scanLen;
+  }
+
+  reader.setCur(start);
+  return false;
+}
+
+// Sets up the seek table from the Xing toc or the VBRI table, whichever
+// the first frame has, with the reader at that frame.  Without either, the
+// audio is taken to be spread evenly over the song.
+void Mp3Info::SetSeekTable(ID3_Reader& reader, size_t mp3size, 
+                           const Mp3_FrameHeader& frame, const uchar* toc)
+{
+  const Mp3_Headerinfo& info = *_mp3_header_output;
+  const ID3_Reader::pos_type beg = reader.getCur();
+  const size_t bytes = 
+    (info.vbr_bytes != 0) ? dami::min<size_t>(info.vbr_bytes, mp3size) : mp3size;
+
+  _seek_offsets.clear();
+  _seek_end = beg + bytes;
+  _seek_exact = false;
+  if (info.milliseconds != 0)
+  {
+    _seek_duration = info.milliseconds;
+  }
+  else
+  {
+    const uint32 bitrate = info.vbr_bitrate ? info.vbr_bitrate : info.bitrate;
+    _seek_duration = (bitrate > 0) ? 
+      fto_nearest_i((float) (bytes * 8000.0 / bitrate)) : 0;
+  }
 
-        if (vbr_frames > 0)
+  if (toc != NULL)
+  {
+    _seek_offsets.resize(100);
+    for (size_t i = 0; i < 100; ++i)
+    {
+      _seek_offsets[i] = beg + (uint32) ((double) toc[i] * bytes / 256);
+    }
+    _seek_step = _seek_duration / 100.0;
+    return;
+  }
+
+  if (info.vbr_header == MP3VBRHEADER_VBRI)
+  {
+    // the table of the sizes of each run of frames follows the header
+    const size_t VBRI_TABLE_OFFSET = VBRI_OFFSET + 26;
+    uchar fields[8];
+    reader.setCur(beg + VBRI_OFFSET + 18);
+    if (reader.readChars(fields, 8) == 8)
+    {
+      const size_t entries = ExtractI2(fields);
+      const uint32 scale = ExtractI2(fields + 2);
+      const size_t entrySize = ExtractI2(fields + 4);
+      const uint32 framesPerEntry = ExtractI2(fields + 6);
+      BString table;
+      if (entries > 0 && entrySize >= 1 && entrySize <= 4 && 
+          framesPerEntry > 0 && 
+          VBRI_TABLE_OFFSET + entries * entrySize <= mp3size)
+      {
+        table.resize(entries * entrySize);
+        reader.setCur(beg + VBRI_TABLE_OFFSET);
+      }
+      if (!table.empty() && 
+          reader.readChars(&table[0], table.size()) == table.size())
+      {
+        // the runs start after the frame holding the header
+        uint32 offset = beg + frame.framesize;
+        _seek_offsets.resize(entries);
+        for (size_t i = 0; i < entries; ++i)
         {
-          _mp3_header_output->vbr_bitrate = (((vbr_filesize!=0) ? vbr_filesize : mp3size) / vbr_frames) * _mp3_header_output->frequency / 144;
-          _mp3_header_output->vbr_bitrate -= _mp3_header_output->vbr_bitrate%1000;   // round the bitrate:
+          _seek_offsets[i] = offset;
+          uint32 size = 0;
+          for (size_t j = 0; j < entrySize; ++j)
+          {
+            size = (size << 8) | table[i * entrySize + j];
+          }
+          offset += scale * size;
         }
+        _seek_step = 1000.0 * framesPerEntry * frame.samples / info.frequency;
+        return;
       }
     }
   }
 
-  if (_mp3_header_output->framesize > 0 && mp3size >= _mp3_header_output->framesize) // this means bitrate is not none too
+  _seek_offsets.push_back(beg);
+  _seek_step = _seek_duration;
+}
+
+// The offset in the file of the audio at milliseconds into the song.  With
+// the seek table from the frame walk that is the indexed frame at or before
+// the time; otherwise it's interpolated from the vbr header's table.
+bool Mp3Info::TimeToOffset(uint32 milliseconds, size_t& offset) const
+{
+  if (_seek_offsets.empty() || _seek_step <= 0)
   {
-    if (vbr_frames == 0)
-      _mp3_header_output->frames = fto_nearest_i((float)mp3size / _mp3_header_output->framesize);
-    else
-      _mp3_header_output->frames = vbr_frames;
+    return false;
+  }
+  const uint32 ms = dami::min<uint32>(milliseconds, _seek_duration);
+  if (_seek_exact)
+  {
+    // OffsetToTime() rounds to the nearest millisecond, so an indexed frame
+    // can start up to half a millisecond after the time it gives for it
+    const size_t i = (size_t) ((ms + 0.5) / _seek_step);
+    offset = _seek_offsets[dami::min<size_t>(i, _seek_offsets.size() - 1)];
+    return true;
+  }
+  const double pos = ms / _seek_step;
+  const size_t i = dami::min<size_t>((size_t) pos, _seek_offsets.size() - 1);
+  const double next = (i + 1 < _seek_offsets.size()) ? _seek_offsets[i + 1] : _seek_end;
+  const double fraction = dami::min<double>(pos - i, 1.0);
+  offset = _seek_offsets[i] + (size_t) ((next - _seek_offsets[i]) * fraction);
+  return true;
+}
 
-    // bitrate becomes byterate (per second) if divided by 8
-    if (_mp3_header_output->vbr_bitrate == 0)
-      _mp3_header_output->time = fto_nearest_i( (float)mp3size / (_mp3_header_output->bitrate / 8) );
-    else
-      _mp3_header_output->time = fto_nearest_i( (float)mp3size / (_mp3_header_output->vbr_bitrate / 8) );
+// The time into the song of the audio at offset in the file, the reverse
+// of TimeToOffset().
+bool Mp3Info::OffsetToTime(size_t offset, uint32& milliseconds) const
+{
+  if (_seek_offsets.empty() || _seek_step <= 0 || offset < _seek_offsets[0])
+  {
+    return false;
   }
-  else
+  // the last entry at or before offset
+  const size_t i = (std::upper_bound(_seek_offsets.begin(), _seek_offsets.end(), 
+                                     (uint32) offset) - _seek_offsets.begin()) - 1;
+  const double next = (i + 1 < _seek_offsets.size()) ? _seek_offsets[i + 1] : _seek_end;
+  double fraction = 0;
+  if (next > _seek_offsets[i])
   {
-    _mp3_header_output->frames = 0;
-    _mp3_header_output->time = 0;
+    fraction = dami::min<double>((offset - _seek_offsets[i]) / (next - _seek_offsets[i]), 1.0);
   }
-  //if we got to here it's okay
+  milliseconds = dami::min<uint32>(fto_nearest_i((float) ((i + fraction) * _seek_step)), 
+                                   _seek_duration);
   return true;
 }
 
+namespace
+{
+  const size_t CHUNK_SIZE = 1024 * 1024;
+  // read past the end of a chunk, for the frames that start in it and for
+  // FindSync() to follow a few frames on
+  const size_t MARGIN = 16 * 1024;
+
+  // Checks the frames that start in each chunk of the audio, the chunks
+  // read with a pread() of their own so that any number of them can be
+  // checked at once.  Each chunk starts from the first sync found in it;
+  // Mp3Info::Verify() walks it again from where the chunk before it left
+  // off if the two don't meet.
+  class FrameVerifier : public Tasks
+  {
+  public:
+    struct Result
+    {
+      uint32 frames;
+      uint32 checked;
+      // the first frame walked, and the frame past the chunk the walk
+      // stopped at; 0 if no frame was found or the frames broke off
+      size_t start, end;
+      std::vector<uint32> corrupt;
+      Result() : frames(0), checked(0), start(0), end(0) { ; }
+    };
 
+    FrameVerifier(int fd, size_t beg, size_t end)
+      : _fd(fd), _beg(beg), _end(end), 
+        _results((end - beg + CHUNK_SIZE - 1) / CHUNK_SIZE)
+    { ; }
+
+    size_t chunks() const { return _results.size(); }
+    const Result& result(size_t chunk) const { return _results[chunk]; }
+    size_t chunkEnd(size_t chunk) const
+    {
+      return dami::min(_beg + (chunk + 1) * CHUNK_SIZE, _end);
+    }
+
+    void run(size_t chunk, size_t)
+    {
+      this->walk(chunk, 0, _results[chunk]);
+    }
+
+    // Walks the frames that start in the chunk, from the offset from or,
+    // if it is 0, from the first sync found in the chunk.
+    void walk(size_t chunk, size_t from, Result& result) const
+    {
+      const size_t chunkBeg = _beg + chunk * CHUNK_SIZE;
+      const size_t chunkSize = dami::min(CHUNK_SIZE, _end - chunkBeg);
+      std::vector<uchar> buf(dami::min(chunkSize + MARGIN, _end - chunkBeg));
+      const size_t len = io::readAt(_fd, &buf[0], buf.size(), chunkBeg);
+      if (len == 0)
+      {
+        result.corrupt.push_back(chunkBeg);
+        return;
+      }
+
+      ID3_MemoryReader reader(&buf[0], len);
+      if (from != 0)
+      {
+        reader.setCur(from - chunkBeg);
+      }
+      else if (!Mp3Info::FindSync(reader, chunkSize))
+      {
+        result.corrupt.push_back(chunkBeg);
+        return;
+      }
+      size_t pos = reader.getCur();
+      result.start = chunkBeg + pos;
+      while (pos < chunkSize && pos + 4 <= len)
+      {
+        const uchar* data = &buf[pos];
+        Mp3_FrameHeader frame;
+        if (!ID3_DecodeMp3Header(headerAt(data), &frame) || frame.framesize == 0)
+        {
+          // the frames broke off here; carry on from where they pick up
+          result.corrupt.push_back(chunkBeg + pos);
+          reader.setCur(pos + 1);
+          if (!Mp3Info::FindSync(reader, chunkSize - pos - 1))
+          {
+            return;
+          }
+          pos = reader.getCur();
+          continue;
+        }
+        ++result.frames;
+
+        // the crc of a layer III frame covers the last two bytes of the
+        // header and the side information
+        const size_t CRCSIZE = 2;
+        if (frame.crc && frame.layer == MPEGLAYER_III && 
+            pos + 4 + CRCSIZE + frame.sideinfo <= len)
+        {
+          ++result.checked;
+          uint16 crc = crc16(0xffff, data + 2, 2);
+          crc = crc16(crc, data + 4 + CRCSIZE, frame.sideinfo);
+          if (crc != ExtractI2(data + 4))
+          {
+            result.corrupt.push_back(chunkBeg + pos);
+          }
+        }
+        pos += frame.framesize;
+      }
+      result.end = chunkBeg + pos;
+    }
+
+  private:
+    int _fd;
+    size_t _beg, _end;
+    std::vector<Result> _results;
+  };
+}
+
+// Walks every frame of the audio in the file fd, checking the crc of those
+// that have one, and counts the frames that fail along with the places the
+// frames break off.  The offsets of the first max of them go to corrupt,
+// in order.  The audio is split into chunks checked on the given number of
+// threads (0 for one per processor).  Only layer III crcs are checked: those
+// of layers I and II cover bit allocations that would have to be decoded.
+void Mp3Info::Verify(int fd, Mp3_Integrity& integrity, uint32* corrupt,
+                     size_t max, size_t threads) const
+{
+  integrity.frames = 0;
+  integrity.checked = 0;
+  integrity.corrupt = 0;
+  if (_audio_end <= _audio_beg)
+  {
+    return;
+  }
+
+  FrameVerifier verifier(fd, _audio_beg, _audio_end);
+  dami::runTasks(verifier, verifier.chunks(), threads);
+
+  // where the frames of the chunk before carry on, if they didn't break off
+  size_t next = 0;
+  for (size_t i = 0; i < verifier.chunks(); ++i)
+  {
+    if (next >= verifier.chunkEnd(i))
+    {
+      // the chunk lies inside the last frame of the chunk before
+      continue;
+    }
+    FrameVerifier::Result rewalked;
+    const FrameVerifier::Result* result = &verifier.result(i);
+    if (next != 0 && result->start != next)
+    {
+      verifier.walk(i, next, rewalked);
+      result = &rewalked;
+    }
+    next = result->end;
+
+    integrity.frames += result->frames;
+    integrity.checked += result->checked;
+    for (size_t j = 0; j < result->corrupt.size(); ++j)
+    {
+      if (corrupt != NULL && integrity.corrupt < max)
+      {
+        corrupt[integrity.corrupt] = result->corrupt[j];
+      }
+      ++integrity.corrupt;
+    }
+  }
+}
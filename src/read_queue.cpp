@@ -0,0 +1,410 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <deque>
+
+#include "read_queue.h"
+#include "io_helpers.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#if defined HAVE_LINUX_IO_URING_H
+#  include <linux/io_uring.h>
+#  include <sys/syscall.h>
+#  include <sys/mman.h>
+#  if defined __NR_io_uring_setup && defined __NR_io_uring_enter
+#    define ID3_IO_URING 1
+#  endif
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // Makes each read as it is submitted
+  class SyncQueue : public ReadQueue
+  {
+  public:
+    SyncQueue(size_t depth) : _depth(depth) { ; }
+
+    bool submit(int fd, void* buf, size_t size, size_t offset, void* tag)
+    {
+      if (_done.size() >= _depth)
+      {
+        return false;
+      }
+      Done done;
+      done.tag = tag;
+      done.result = io::readAt(fd, buf, size, offset);
+      _done.push_back(done);
+      return true;
+    }
+
+    bool wait(void*& tag, long& result)
+    {
+      if (_done.empty())
+      {
+        return false;
+      }
+      tag = _done.front().tag;
+      result = _done.front().result;
+      _done.pop_front();
+      return true;
+    }
+
+    size_t depth() const { return _depth; }
+    bool async() const { return false; }
+
+  private:
+    struct Done
+    {
+      void* tag;
+      long result;
+    };
+
+    size_t _depth;
+    std::deque<Done> _done;
+  };
+
+#if defined ID3_IO_URING
+  // Talks to io_uring with the bare system calls.  Reads are gathered in
+  // the submission ring and handed to the kernel together, the next time
+  // wait() is called.
+  class UringQueue : public ReadQueue
+  {
+  public:
+    UringQueue() : _ring(-1), _sqMap(NULL), _cqMap(NULL), _sqes(NULL),
+                   _sqMapSize(0), _cqMapSize(0), _sqesSize(0),
+                   _unsubmitted(0), _outstanding(0)
+    { ; }
+
+    ~UringQueue()
+    {
+      if (_sqes)
+      {
+        ::munmap(_sqes, _sqesSize);
+      }
+      if (_cqMap && _cqMap != _sqMap)
+      {
+        ::munmap(_cqMap, _cqMapSize);
+      }
+      if (_sqMap)
+      {
+        ::munmap(_sqMap, _sqMapSize);
+      }
+      if (_ring >= 0)
+      {
+        ::close(_ring);
+      }
+    }
+
+    bool init(size_t depth)
+    {
+      struct io_uring_params params;
+      ::memset(&params, 0, sizeof(params));
+      _ring = ::syscall(__NR_io_uring_setup, depth, &params);
+      if (_ring < 0)
+      {
+        return false;
+      }
+
+      _sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      _cqMapSize = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+      const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+      if (single)
+      {
+        _sqMapSize = _cqMapSize = dami::max(_sqMapSize, _cqMapSize);
+      }
+      _sqMap = map(_sqMapSize, IORING_OFF_SQ_RING);
+      if (!_sqMap)
+      {
+        return false;
+      }
+      _cqMap = single ? _sqMap : map(_cqMapSize, IORING_OFF_CQ_RING);
+      _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+      _sqes = static_cast<struct io_uring_sqe*>(map(_sqesSize, IORING_OFF_SQES));
+      if (!_cqMap || !_sqes)
+      {
+        return false;
+      }
+
+      char* sq = static_cast<char*>(_sqMap);
+      _sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+      _sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+      _sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+      char* cq = static_cast<char*>(_cqMap);
+      _cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+      _cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+      _cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+      _cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+      _reads.resize(params.sq_entries);
+      for (size_t i = 0; i < _reads.size(); ++i)
+      {
+        _free.push_back(i);
+      }
+      return true;
+    }
+
+    bool submit(int fd, void* buf, size_t size, size_t offset, void* tag)
+    {
+      if (_free.empty())
+      {
+        return false;
+      }
+      const size_t slot = _free.back();
+      _free.pop_back();
+      Read& read = _reads[slot];
+      read.fd = fd;
+      read.buf = buf;
+      read.size = size;
+      read.offset = offset;
+      read.tag = tag;
+
+      // only this thread moves the tail, so it can be read as it is
+      const unsigned tail = *_sqTail;
+      const unsigned index = tail & _sqMask;
+      struct io_uring_sqe* sqe = &_sqes[index];
+      ::memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_READ;
+      sqe->fd = fd;
+      sqe->addr = reinterpret_cast<unsigned long>(buf);
+      sqe->len = size;
+      sqe->off = offset;
+      sqe->user_data = slot;
+      _sqArray[index] = index;
+      // the entry has to be seen before the tail that takes it in
+      __sync_synchronize();
+      *_sqTail = tail + 1;
+      ++_unsubmitted;
+      ++_outstanding;
+      return true;
+    }
+
+    bool wait(void*& tag, long& result)
+    {
+      if (_outstanding == 0)
+      {
+        return false;
+      }
+      unsigned head = *_cqHead;
+      __sync_synchronize();
+      while (head == *const_cast<volatile unsigned*>(_cqTail))
+      {
+        const int entered = ::syscall(__NR_io_uring_enter, _ring, _unsubmitted,
+                                      1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (entered >= 0)
+        {
+          _unsubmitted -= dami::min<size_t>(entered, _unsubmitted);
+        }
+        else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+          // the ring is no good: make the rest of the reads the slow way
+          return this->drain(tag, result);
+        }
+        __sync_synchronize();
+      }
+
+      const struct io_uring_cqe& cqe = _cqes[head & _cqMask];
+      const size_t slot = cqe.user_data;
+      result = cqe.res;
+      __sync_synchronize();
+      *_cqHead = head + 1;
+
+      Read& read = _reads[slot];
+      if (result < 0)
+      {
+        // a kernel without IORING_OP_READ, say; the read is made here instead
+        result = ::pread(read.fd, read.buf, read.size, read.offset);
+      }
+      tag = read.tag;
+      _free.push_back(slot);
+      --_outstanding;
+      return true;
+    }
+
+    size_t depth() const { return _reads.size(); }
+    bool async() const { return true; }
+
+  private:
+    struct Read
+    {
+      int fd;
+      void* buf;
+      size_t size;
+      size_t offset;
+      void* tag;
+    };
+
+    void* map(size_t size, off_t offset)
+    {
+      void* ptr = ::mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, _ring, offset);
+      return ptr == MAP_FAILED ? NULL : ptr;
+    }
+
+    // Hands back one of the reads that never got to the kernel, having made
+    // it with pread()
+    bool drain(void*& tag, long& result)
+    {
+      std::vector<bool> free(_reads.size(), false);
+      for (size_t i = 0; i < _free.size(); ++i)
+      {
+        free[_free[i]] = true;
+      }
+      for (size_t slot = 0; slot < _reads.size(); ++slot)
+      {
+        if (!free[slot])
+        {
+          Read& read = _reads[slot];
+          result = ::pread(read.fd, read.buf, read.size, read.offset);
+          tag = read.tag;
+          _free.push_back(slot);
+          --_outstanding;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    int _ring;
+    void* _sqMap;
+    void* _cqMap;
+    struct io_uring_sqe* _sqes;
+    size_t _sqMapSize, _cqMapSize, _sqesSize;
+    unsigned* _sqTail;
+    unsigned* _sqArray;
+    unsigned _sqMask;
+    unsigned* _cqHead;
+    unsigned* _cqTail;
+    unsigned _cqMask;
+    struct io_uring_cqe* _cqes;
+    std::vector<Read> _reads;
+    std::vector<size_t> _free;
+    size_t _unsubmitted;
+    size_t _outstanding;
+  };
+#endif
+}
+
+ReadQueue* dami::newReadQueue(size_t depth)
+{
+#if defined ID3_IO_URING
+  UringQueue* queue = new UringQueue;
+  if (queue->init(depth))
+  {
+    return queue;
+  }
+  delete queue;
+#endif
+  return new SyncQueue(depth);
+}
+
+bool dami::haveAsyncReads()
+{
+  ReadQueue* queue = newReadQueue(1);
+  const bool async = queue->async();
+  delete queue;
+  return async;
+}
+
+void io::PrefetchedReader::addExtent(pos_type offset, const char_type* data,
+                                     size_type size)
+{
+  if (size > 0)
+  {
+    Extent extent;
+    extent.beg = offset;
+    extent.end = offset + size;
+    extent.data = data;
+    _extents.push_back(extent);
+  }
+}
+
+ID3_Reader::int_type io::PrefetchedReader::peekChar()
+{
+  const pos_type cur = _cur;
+  char_type ch;
+  if (this->readChars(&ch, 1) != 1)
+  {
+    return END_OF_READER;
+  }
+  _cur = cur;
+  return ch;
+}
+
+ID3_Reader::size_type io::PrefetchedReader::readChars(char_type buf[],
+                                                      size_type len)
+{
+  size_type numChars = 0;
+  len = dami::min<size_type>(len, _end - _cur);
+  while (numChars < len)
+  {
+    // what is in hand is copied, and only what isn't is read
+    pos_type next = _end;
+    const Extent* extent = NULL;
+    for (size_t i = 0; i < _extents.size(); ++i)
+    {
+      if (_extents[i].beg <= _cur && _cur < _extents[i].end)
+      {
+        extent = &_extents[i];
+        break;
+      }
+      if (_extents[i].beg > _cur)
+      {
+        next = dami::min(next, _extents[i].beg);
+      }
+    }
+
+    size_type size = 0;
+    if (extent)
+    {
+      size = dami::min<size_type>(len - numChars, extent->end - _cur);
+      ::memcpy(buf + numChars, extent->data + (_cur - extent->beg), size);
+    }
+    else
+    {
+      size = dami::min<size_type>(len - numChars, next - _cur);
+      size = io::readAt(_fd, buf + numChars, size, _cur);
+      if (size == 0)
+      {
+        break;
+      }
+    }
+    numChars += size;
+    _cur += size;
+  }
+  return numChars;
+}
@@ -0,0 +1,115 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_READ_QUEUE_H_
+#define _ID3LIB_READ_QUEUE_H_
+
+#include <vector>
+#include "id3/reader.h"
+
+namespace dami
+{
+  // Positional reads that are started together and finish in any order.
+  // Each read is given a tag, which comes back with its result: the number
+  // of bytes read, or -1 if the read failed.
+  class ReadQueue
+  {
+  public:
+    virtual ~ReadQueue() { ; }
+
+    // Queues a read of size bytes at offset in fd into buf, which has to
+    // stay put until the read is done.  At most depth() reads can be
+    // outstanding; returns false if there's no room for another.
+    virtual bool submit(int fd, void* buf, size_t size, size_t offset,
+                        void* tag) = 0;
+
+    // Waits for a read to finish.  Returns false if none are outstanding.
+    virtual bool wait(void*& tag, long& result) = 0;
+
+    virtual size_t depth() const = 0;
+
+    // Whether the reads go to the kernel together, or are just made in turn
+    virtual bool async() const = 0;
+  };
+
+  // A queue for up to depth reads at once: on io_uring where the system has
+  // it, and otherwise one that makes each read with pread() as it is
+  // submitted, leaving it to the threads to read files side by side.
+  ReadQueue* newReadQueue(size_t depth);
+
+  // Whether newReadQueue() gets io_uring on this system
+  bool haveAsyncReads();
+
+  namespace io
+  {
+    // Reads a file through a descriptor, serving whatever it can from
+    // pieces of the file read beforehand, and the rest with pread().
+    // Positions are those in the file.
+    class PrefetchedReader : public ID3_Reader
+    {
+    public:
+      PrefetchedReader(int fd, pos_type size) : _fd(fd), _cur(0), _end(size)
+      { ; }
+
+      // The size bytes at offset are at data, which has to outlive the
+      // reader
+      void addExtent(pos_type offset, const char_type* data, size_type size);
+
+      void close() { ; }
+      pos_type getCur() { return _cur; }
+      pos_type getEnd() { return _end; }
+      pos_type setCur(pos_type pos) { return _cur = pos < _end ? pos : _end; }
+
+      int_type peekChar();
+      size_type readChars(char_type buf[], size_type len);
+      size_type readChars(char buf[], size_type len)
+      {
+        return this->readChars(reinterpret_cast<char_type*>(buf), len);
+      }
+      size_type skipChars(size_type len)
+      {
+        pos_type cur = _cur;
+        return this->setCur(cur + (len < _end - cur ? len : _end - cur)) - cur;
+      }
+
+    private:
+      struct Extent
+      {
+        pos_type beg;
+        pos_type end;
+        const char_type* data;
+      };
+
+      int _fd;
+      pos_type _cur;
+      pos_type _end;
+      std::vector<Extent> _extents;
+    };
+  }
+}
+
+#endif /* _ID3LIB_READ_QUEUE_H_ */
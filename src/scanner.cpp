@@ -0,0 +1,658 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+
+#include "scanner.h"
+#include "thread_pool.h"
+#include "read_queue.h"
+#include "tag_impl.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+
+#if defined HAVE_DIRENT_H && defined HAVE_SYS_STAT_H
+#  include <dirent.h>
+#endif
+#ifndef WIN32
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+#if defined HAVE_PTHREAD_H
+#  include <pthread.h>
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // Does name end in suffix, ignoring case?  An empty suffix matches all.
+  bool hasSuffix(const String& name, const char* suffix)
+  {
+    const size_t len = suffix ? strlen(suffix) : 0;
+    if (len > name.size())
+    {
+      return false;
+    }
+    for (size_t i = 0, off = name.size() - len; i < len; ++i)
+    {
+      if (tolower(name[off + i]) != tolower(suffix[i]))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+#if defined HAVE_DIRENT_H && defined HAVE_SYS_STAT_H
+  // Adds the files under dir whose names end in suffix, directory by
+  // directory, in the order readdir() gives them.  Symbolic links to
+  // directories aren't followed, so a link back up the tree can't loop.
+  size_t addTree(const String& dir, const char* suffix,
+                 std::vector<String>& paths)
+  {
+    DIR* dp = ::opendir(dir.c_str());
+    if (NULL == dp)
+    {
+      return 0;
+    }
+    size_t added = 0;
+    std::vector<String> subdirs;
+    for (struct dirent* entry; (entry = ::readdir(dp)) != NULL; )
+    {
+      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+      {
+        continue;
+      }
+      String path = dir;
+      if (path.empty() || path[path.size() - 1] != '/')
+      {
+        path += '/';
+      }
+      path += entry->d_name;
+
+      struct stat st;
+      if (::lstat(path.c_str(), &st) != 0)
+      {
+        continue;
+      }
+      if (S_ISDIR(st.st_mode))
+      {
+        subdirs.push_back(path);
+      }
+      else if (hasSuffix(path, suffix) &&
+               (S_ISREG(st.st_mode) ||
+                (S_ISLNK(st.st_mode) && ::stat(path.c_str(), &st) == 0 &&
+                 S_ISREG(st.st_mode))))
+      {
+        paths.push_back(path);
+        ++added;
+      }
+    }
+    ::closedir(dp);
+
+    // the files of a directory are added together, so they tend to end up
+    // on the same thread
+    for (size_t i = 0; i < subdirs.size(); ++i)
+    {
+      added += addTree(subdirs[i], suffix, paths);
+    }
+    return added;
+  }
+#endif
+
+  // Keeps the handler to one call at a time
+  class HandlerLock
+  {
+  public:
+#if defined HAVE_PTHREAD_H
+    HandlerLock()  { pthread_mutex_init(&_lock, NULL); }
+    ~HandlerLock() { pthread_mutex_destroy(&_lock); }
+    void lock()    { pthread_mutex_lock(&_lock); }
+    void unlock()  { pthread_mutex_unlock(&_lock); }
+  private:
+    pthread_mutex_t _lock;
+#else
+    void lock()    { ; }
+    void unlock()  { ; }
+#endif
+  };
+
+#ifndef WIN32
+  // how much of the start and end of a file is read to begin with; the
+  // tail is as much as the appended tags are parsed from
+  const size_t HEAD_BLOCK_SIZE = 16 * 1024;
+  const size_t TAIL_BLOCK_SIZE = 64 * 1024;
+  // how much past the id3v2 tag is read when the audio is looked at too,
+  // for the sync search and the first frame
+  const size_t AUDIO_MARGIN = 4 * 1024;
+
+  // One of the reads of a file in a batch
+  struct PendingFile;
+  struct PendingRead
+  {
+    PendingFile* file;
+    BString* buffer;
+    size_t at;      // where in the buffer it reads to
+    size_t size;    // how much it reads
+  };
+
+  // A file in a batch, from when its reads are submitted to when it's parsed
+  struct PendingFile
+  {
+    size_t index;
+    int fd;
+    size_t size;
+    const char* error;
+    size_t reads;
+    BString head;
+    BString tail;
+    size_t tailBeg;
+    bool followedUp;
+    PendingRead headRead;
+    PendingRead tailRead;
+  };
+
+  // Where the id3v2 tag that starts the file ends, from its header, or 0 if
+  // it doesn't start with one.  dataSize is the size its header gives.
+  size_t v2TagEnd(const BString& head, size_t& dataSize)
+  {
+    const size_t HEADER_SIZE = 10;
+    dataSize = 0;
+    if (head.size() < HEADER_SIZE || ::memcmp(head.data(), "ID3", 3) != 0)
+    {
+      return 0;
+    }
+    for (size_t i = 6; i < HEADER_SIZE; ++i)
+    {
+      dataSize = (dataSize << 7) | (head[i] & 0x7F);
+    }
+    const bool footer = (head[5] & 0x10) != 0;
+    return HEADER_SIZE + dataSize + (footer ? HEADER_SIZE : 0);
+  }
+#endif
+
+  // What each thread keeps from one file to the next
+  struct ParseState
+  {
+    ID3_Tag tag;
+    std::vector<const ID3_Frame*> frames;
+#ifndef WIN32
+    ReadQueue* queue;
+    std::vector<PendingFile> batch;
+    ParseState() : queue(NULL) { ; }
+    ~ParseState() { delete queue; }
+#endif
+  };
+
+  class ScanTasks : public Tasks
+  {
+  public:
+    ScanTasks(const std::vector<String>& paths,
+              const std::vector<ID3_FrameID>& frames, flags_t tagTypes,
+              flags_t options, size_t threads, size_t batch,
+              ID3_Scanner::Handler& handler)
+      : _paths(paths), _frames(frames), _tag_types(tagTypes),
+        _options(options), _batch(batch), _states(threads, (ParseState*) NULL),
+        _handler(handler), _scanned(0)
+    {
+#ifdef WIN32
+      _batch = 0;
+#endif
+    }
+
+    ~ScanTasks()
+    {
+      for (size_t i = 0; i < _states.size(); ++i)
+      {
+        delete _states[i];
+      }
+    }
+
+    // one task per file, or per batch of files
+    size_t count() const
+    {
+      return _batch ? (_paths.size() + _batch - 1) / _batch : _paths.size();
+    }
+
+    size_t scanned() const { return _scanned; }
+
+    void run(size_t task, size_t worker)
+    {
+      // the state is only ever touched by its own worker
+      if (NULL == _states[worker])
+      {
+        _states[worker] = new ParseState;
+        _states[worker]->frames.resize(_frames.size());
+      }
+      ParseState& state = *_states[worker];
+#ifndef WIN32
+      if (_batch > 0)
+      {
+        const size_t first = task * _batch;
+        this->scanBatch(state, first, dami::min(first + _batch, _paths.size()));
+        return;
+      }
+#endif
+      this->scan(state, task, NULL, NULL);
+    }
+
+  private:
+#ifndef WIN32
+    // Reads the start and the end of each file in [first, last) all at
+    // once, and then whatever more of a prepended tag there is, and parses
+    // each file as soon as its reads are in, while the others' are still
+    // going on.
+    void scanBatch(ParseState& state, size_t first, size_t last)
+    {
+      if (NULL == state.queue)
+      {
+        // a head and a tail read per file, at most
+        state.queue = newReadQueue(2 * _batch);
+      }
+      ReadQueue& queue = *state.queue;
+      std::vector<PendingFile>& batch = state.batch;
+      batch.resize(last - first);
+
+      for (size_t i = 0; i < batch.size(); ++i)
+      {
+        PendingFile& file = batch[i];
+        file.index = first + i;
+        file.size = 0;
+        file.error = NULL;
+        file.reads = 0;
+        file.head.clear();
+        file.tail.clear();
+        file.tailBeg = 0;
+        file.followedUp = false;
+        file.headRead.file = file.tailRead.file = &file;
+        file.headRead.buffer = &file.head;
+        file.tailRead.buffer = &file.tail;
+        file.headRead.at = file.tailRead.at = 0;
+
+        struct stat st;
+        file.fd = ::open(_paths[file.index].c_str(), O_RDONLY);
+        if (file.fd < 0 || ::fstat(file.fd, &st) != 0)
+        {
+          file.error = "can't be opened";
+          continue;
+        }
+        file.size = st.st_size;
+#if defined POSIX_FADV_RANDOM
+        // every read here is asked for, and readahead past the tag would
+        // only pull in audio that is never looked at
+        ::posix_fadvise(file.fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+        file.head.resize(dami::min(file.size, HEAD_BLOCK_SIZE));
+        file.tailBeg = dami::max(file.head.size(),
+                                 file.size - dami::min(file.size, TAIL_BLOCK_SIZE));
+        file.tail.resize(file.size - file.tailBeg);
+        file.headRead.size = file.head.size();
+        file.tailRead.size = file.tail.size();
+        // a buffer that couldn't be queued is left empty, so that the
+        // reader reads that part of the file itself
+        if (!file.head.empty())
+        {
+          if (queue.submit(file.fd, &file.head[0], file.head.size(), 0,
+                           &file.headRead))
+          {
+            ++file.reads;
+          }
+          else
+          {
+            file.head.clear();
+          }
+        }
+        if (!file.tail.empty())
+        {
+          if (queue.submit(file.fd, &file.tail[0], file.tail.size(),
+                           file.tailBeg, &file.tailRead))
+          {
+            ++file.reads;
+          }
+          else
+          {
+            file.tail.clear();
+          }
+        }
+      }
+
+      // the files with nothing to read first, then the rest as they come
+      for (size_t i = 0; i < batch.size(); ++i)
+      {
+        if (batch[i].reads == 0)
+        {
+          this->scanPending(state, batch[i]);
+        }
+      }
+      void* tag = NULL;
+      long result = 0;
+      while (queue.wait(tag, result))
+      {
+        PendingRead& read = *static_cast<PendingRead*>(tag);
+        PendingFile& file = *read.file;
+        BString& buffer = *read.buffer;
+        if (result < 0 || size_t(result) < read.size)
+        {
+          // the reader reads what's missing itself
+          buffer.resize(read.at + dami::max(result, 0L));
+        }
+        --file.reads;
+        if (&buffer == &file.head && !file.followedUp)
+        {
+          this->followUp(queue, file);
+        }
+        if (file.reads == 0)
+        {
+          this->scanPending(state, file);
+        }
+      }
+    }
+
+    // Reads the rest of a prepended tag larger than the first read, and
+    // the start of the audio if that's wanted too, into the head.  A tag
+    // that id3::v2::parse() would parse from the file, to leave its
+    // pictures there, is read no further than its first TAG_BLOCK_SIZE
+    // bytes; the reader reads whatever else is wanted of it.
+    void followUp(ReadQueue& queue, PendingFile& file)
+    {
+      file.followedUp = true;
+      size_t dataSize = 0;
+      size_t end = v2TagEnd(file.head, dataSize);
+      if ((_options & ID3LO_PICTUREOFFSETS) && 
+          dataSize > id3::v2::TAG_BLOCK_SIZE)
+      {
+        end = id3::v2::TAG_BLOCK_SIZE;
+      }
+      else if (end > 0 && (_options & (ID3LO_MP3HEADER | ID3LO_MP3DURATION)))
+      {
+        end += AUDIO_MARGIN;
+      }
+      const size_t have = file.head.size();
+      end = dami::min(end, file.tail.empty() ? file.size : file.tailBeg);
+      if (have < HEAD_BLOCK_SIZE || end <= have)
+      {
+        return;
+      }
+      file.head.resize(end);
+      file.headRead.at = have;
+      file.headRead.size = end - have;
+      if (queue.submit(file.fd, &file.head[have], end - have, have,
+                       &file.headRead))
+      {
+        ++file.reads;
+      }
+      else
+      {
+        file.head.resize(have);
+      }
+    }
+
+    void scanPending(ParseState& state, PendingFile& file)
+    {
+      if (file.fd < 0)
+      {
+        this->scan(state, file.index, NULL, file.error);
+        return;
+      }
+      io::PrefetchedReader reader(file.fd, file.size);
+      reader.addExtent(0, file.head.data(), file.head.size());
+      reader.addExtent(file.tailBeg, file.tail.data(), file.tail.size());
+      this->scan(state, file.index, &reader, file.error);
+      ::close(file.fd);
+      file.fd = -1;
+    }
+#endif
+
+    // Links the file, through the reader if there is one, and hands the
+    // result over
+    void scan(ParseState& state, size_t index, ID3_Reader* reader,
+              const char* error)
+    {
+      const String& path = _paths[index];
+
+      ID3_ScanResult result;
+      result.path = path.c_str();
+      result.index = index;
+      result.tag = NULL;
+      result.frames = state.frames.empty() ? NULL : &state.frames[0];
+      result.numFrames = state.frames.size();
+      result.mp3 = NULL;
+      result.error = error;
+      std::fill(state.frames.begin(), state.frames.end(),
+                (const ID3_Frame*) NULL);
+
+      try
+      {
+        state.tag.Clear();
+        if (error)
+        {
+          // nothing to link with
+        }
+#ifndef WIN32
+        else if (reader)
+        {
+          state.tag.Link(path.c_str(), *reader, _tag_types, _options);
+        }
+#endif
+        else
+        {
+          link(state.tag, path);
+          if (0 == state.tag.GetFileSize() && !readable(path))
+          {
+            result.error = "can't be opened";
+          }
+        }
+        if (NULL == result.error)
+        {
+          result.tag = &state.tag;
+          result.mp3 = state.tag.GetMp3HeaderInfo();
+          for (size_t i = 0; i < _frames.size(); ++i)
+          {
+            state.frames[i] = state.tag.FindFirst(_frames[i]);
+          }
+        }
+      }
+      catch (...)
+      {
+        result.error = "couldn't be parsed";
+        result.tag = NULL;
+        result.mp3 = NULL;
+        std::fill(state.frames.begin(), state.frames.end(),
+                  (const ID3_Frame*) NULL);
+      }
+
+      _lock.lock();
+      if (NULL == result.error)
+      {
+        ++_scanned;
+      }
+      try
+      {
+        _handler.Scanned(result);
+      }
+      catch (...)
+      {
+        // an exception can't be let out onto a worker thread
+      }
+      _lock.unlock();
+    }
+
+    void link(ID3_Tag& tag, const String& path)
+    {
+#ifdef WIN32
+      std::wstring name(path.size(), L'\0');
+      name.resize(::mbstowcs(&name[0], path.c_str(), path.size()));
+      tag.Link(name.c_str(), _tag_types, _options);
+#else
+      tag.Link(path.c_str(), _tag_types, _options);
+#endif
+    }
+
+    // Only asked when nothing was read, to tell an empty file from one
+    // that couldn't be opened
+    static bool readable(const String& path)
+    {
+      ifstream file;
+      return ID3E_NoError == openReadableFile(path, file);
+    }
+
+    const std::vector<String>& _paths;
+    const std::vector<ID3_FrameID>& _frames;
+    const flags_t _tag_types;
+    const flags_t _options;
+    size_t _batch;
+    std::vector<ParseState*> _states;
+    ID3_Scanner::Handler& _handler;
+    HandlerLock _lock;
+    size_t _scanned;
+  };
+}
+
+/** \class ID3_Scanner scanner.h id3/scanner.h
+ **/
+
+/** Makes a scanner with no files, that links with all the tag types and
+ ** the default link options, on one thread per processor.
+ **/
+ID3_Scanner::ID3_Scanner()
+  : _tag_types(ID3TT_ALL), _options(ID3LO_DEFAULT), _threads(0), _batch(32)
+{
+}
+
+/** Adds a file to be scanned.
+ **/
+void ID3_Scanner::AddFile(const char* path)
+{
+  if (path)
+  {
+    _paths.push_back(path);
+  }
+}
+
+/** Adds every file in the tree under root whose name ends in suffix,
+ ** ignoring case; an empty or NULL suffix adds every file.  Symbolic links
+ ** to files are added, but links to directories aren't followed.
+ **
+ ** On systems without dirent.h nothing is added.
+ **
+ ** @param root The directory to start from
+ ** @param suffix The ending of the names of the files to add
+ ** @return The number of files added
+ **/
+size_t ID3_Scanner::AddDirectory(const char* root, const char* suffix)
+{
+#if defined HAVE_DIRENT_H && defined HAVE_SYS_STAT_H
+  if (root)
+  {
+    return addTree(root, suffix, _paths);
+  }
+#endif
+  return 0;
+}
+
+/** Asks for the first frame with the given id to be passed to the handler,
+ ** in ID3_ScanResult::frames.  The frames are passed in the order they are
+ ** selected.
+ **/
+void ID3_Scanner::SelectFrame(ID3_FrameID id)
+{
+  _frames.push_back(id);
+}
+
+/** Sets the tag types to link with; ID3TT_ALL by default.
+ **
+ ** \sa ID3_Tag::Link
+ **/
+void ID3_Scanner::SetTagTypes(flags_t types)
+{
+  _tag_types = types;
+}
+
+/** Sets the link options; ID3LO_DEFAULT by default.  Scanning a library
+ ** for its tags is quickest with ID3LO_TAGSONLY, with
+ ** ID3LO_PICTUREOFFSETS added so that pictures aren't read in.
+ **
+ ** \sa ID3_Tag::Link
+ **/
+void ID3_Scanner::SetLinkOptions(flags_t options)
+{
+  _options = options;
+}
+
+/** Sets the number of threads to scan on; 0, the default, means one per
+ ** processor.
+ **/
+void ID3_Scanner::SetThreads(size_t threads)
+{
+  _threads = threads;
+}
+
+/** Sets how many files each thread reads at once; 32 by default.  The
+ ** start and the end of every file in a batch are read together, on
+ ** io_uring where the system has it, then the rest of any prepended tag
+ ** that didn't fit, and each file is parsed as soon as its reads are in.
+ ** 0 links each file in turn through an ID3_IFStreamReader instead.
+ **
+ ** \sa HasAsyncReads
+ **/
+void ID3_Scanner::SetBatchSize(size_t files)
+{
+  _batch = files;
+}
+
+/** Whether the reads of a batch go to the kernel together, through
+ ** io_uring.  If not, they are made one after another with pread(), and
+ ** it's only the threads that read files side by side.
+ **/
+bool ID3_Scanner::HasAsyncReads()
+{
+#ifndef WIN32
+  return haveAsyncReads();
+#else
+  return false;
+#endif
+}
+
+/** Links every file that was added and hands what was found to the
+ ** handler.  Returns when all the files are done.
+ **
+ ** @param handler Gets the result for each file
+ ** @return The number of files that could be read
+ **/
+size_t ID3_Scanner::Scan(Handler& handler) const
+{
+  const size_t threads = _threads ? _threads : processors();
+  ScanTasks tasks(_paths, _frames, _tag_types, _options, threads, _batch,
+                  handler);
+  runTasks(tasks, tasks.count(), threads);
+  return tasks.scanned();
+}
@@ -349,8 +349,12 @@ bool ID3_Tag::HasChanged() const
   return _impl->HasChanged();
 }
 
-/** Returns an over estimate of the number of bytes required to store a
- ** binary version of a tag.
+/** Returns the number of bytes required to store a binary version of a tag.
+ **
+ ** The size is exact: the frames are sized by rendering them without storing
+ ** the result, so unsynchronisation and compression are fully accounted for.
+ ** If the tag is linked to a file, padding is computed as it would be by
+ ** Update().
  **
  ** When using Render() to render a binary tag to a
  ** memory buffer, first use the result of this call to allocate a buffer of
@@ -376,8 +380,7 @@ bool ID3_Tag::HasChanged() const
  ** \endcode
  **
  ** @see #Render
- ** @return The (overestimated) number of bytes required to store a binary
- **         version of a tag
+ ** @return The number of bytes required to store a binary version of a tag
  **/
 size_t ID3_Tag::Size() const
 {
@@ -425,6 +428,26 @@ bool ID3_Tag::SetExtendedHeader(bool ext)
   return _impl->SetExtended(ext);
 }
 
+/** Turns the crc in the extended header on or off, dependant on the value
+ ** of the boolean parameter.
+ **
+ ** A crc-32 of the tag's data is written in its extended header, which is
+ ** turned on as well.  The crc is worked out while the tag is sized, so
+ ** rendering it takes no extra pass over the frames.  A tag parsed with a
+ ** crc keeps it.
+ **
+ ** \code
+ **   myTag.SetCrc(true);
+ ** \endcode
+ **
+ ** \param crc Whether to render a crc
+ ** \sa GetCrcStatus()
+ **/
+bool ID3_Tag::SetCrc(bool crc)
+{
+  return _impl->SetCrc(crc);
+}
+
 /** Turns padding on or off, dependant on the value of the boolean
  ** parameter.
  **
@@ -459,6 +482,38 @@ bool ID3_Tag::SetPadding(bool pad)
   return _impl->SetPadding(pad);
 }
 
+/** Selects where Update() writes the id3v2 tag.
+ **
+ ** By default the id3v2 tag is prepended to the file.  When the tag grows
+ ** beyond its padding, everything after it has to be rewritten, which for a
+ ** large file means copying all of its audio.  An appended tag (an id3v2.4
+ ** feature) is written at the end of the file instead, ahead of any id3v1
+ ** tag, and is located by its footer.  Growing or shrinking it only moves
+ ** the few bytes that follow it; the audio never moves.  Appended tags carry
+ ** no padding, since the spec doesn't allow padding alongside a footer.
+ **
+ ** If the file has a prepended tag, Update() leaves it in place but empties
+ ** it, so that the appended tag is the only one holding any frames.  When a
+ ** file whose only id3v2 tag is appended is linked, appending is switched on
+ ** so that updates keep the tag where it is.
+ **
+ ** \code
+ **   myTag.SetAppended(true);
+ **   myTag.Update();
+ ** \endcode
+ **
+ ** \param append Whether or not to write the id3v2 tag at the end of the file.
+ **/
+bool ID3_Tag::SetAppended(bool append)
+{
+  return _impl->SetAppended(append);
+}
+
+bool ID3_Tag::GetAppended() const
+{
+  return _impl->GetAppended();
+}
+
 bool ID3_Tag::SetExperimental(bool exp)
 {
   return _impl->SetExperimental(exp);
@@ -474,6 +529,22 @@ bool ID3_Tag::GetExtendedHeader() const
   return _impl->GetExtended();
 }
 
+bool ID3_Tag::GetCrc() const
+{
+  return _impl->GetCrc();
+}
+
+/** Whether the data of the parsed id3v2 tag matched the crc in its extended
+ ** header.
+ **
+ ** \return ID3CRC_NONE if the tag had no crc, otherwise ID3CRC_OK or
+ **         ID3CRC_MISMATCH
+ **/
+ID3_TagCrc ID3_Tag::GetCrcStatus() const
+{
+  return _impl->GetCrcStatus();
+}
+
 bool ID3_Tag::GetExperimental() const
 {
   return _impl->GetExperimental();
@@ -553,6 +624,39 @@ ID3_Frame* ID3_Tag::RemoveFrame(const ID3_Frame *frame)
   return _impl->RemoveFrame(frame);
 }
 
+/** Removes and deletes every frame with the given id, in a single pass.
+ **
+ ** \code
+ **   myTag.RemoveFrames(ID3FID_COMMENT);
+ ** \endcode
+ **
+ ** \return The number of frames removed.
+ **/
+size_t ID3_Tag::RemoveFrames(ID3_FrameID id)
+{
+  return _impl->RemoveFrames(id);
+}
+
+/** Removes and deletes every frame that matches() says to, in a single pass
+ ** over the tag.  matches() is given each frame in turn, along with data.
+ **
+ ** \code
+ **   bool isOther(const ID3_Frame* frame, void*)
+ **   {
+ **     return frame->GetID() == ID3FID_PICTURE &&
+ **            frame->GetField(ID3FN_PICTURETYPE)->Get() == ID3PT_OTHER;
+ **   }
+ **   ...
+ **   myTag.RemoveFrames(isOther);
+ ** \endcode
+ **
+ ** \return The number of frames removed.
+ **/
+size_t ID3_Tag::RemoveFrames(bool (*matches)(const ID3_Frame*, void*), void* data)
+{
+  return _impl->RemoveFrames(matches, data);
+}
+
 bool ID3_Tag::Parse(ID3_Reader& reader)
 {
   return id3::v2::parse(*_impl, reader);
@@ -635,9 +739,9 @@ size_t ID3_Tag::Parse(const uchar header[ID3_TAGHEADERSIZE], const uchar *buffer
 /** Renders a binary image of the tag into the supplied buffer.
  **
  ** See Size() for an example.  This method returns the actual number of the
- ** bytes of the buffer used to store the tag.  This will be no more than the
- ** size of the buffer itself, because Size() over estimates the required
- ** buffer size when padding is enabled.
+ ** bytes of the buffer used to store the tag, which is the value returned by
+ ** Size() as long as the tag isn't altered in between.  The tag is rendered
+ ** straight into the buffer; no intermediate copy is made.
  **
  ** Before calling this method, it is advisable to call HasChanged() first as
  ** this will let you know whether you should bother rendering the tag.
@@ -659,11 +763,11 @@ size_t ID3_Tag::Render(ID3_Writer& writer, ID3_TagType tt) const
   ID3_Writer::pos_type beg = writer.getCur();
   if (ID3TT_ID3V2 & tt)
   {
-    id3::v2::render(writer, *this);
+    id3::v2::render(writer, *_impl);
   }
   else if (ID3TT_ID3V1 & tt)
   {
-    id3::v1::render(writer, *this);
+    id3::v1::render(writer, *_impl);
   }
   return writer.getCur() - beg;
 }
@@ -702,31 +806,140 @@ size_t ID3_Tag::Render(ID3_Writer& writer, ID3_TagType tt) const
  **
  ** \endcode
  **
+ ** The third parameter selects how much of the audio is looked at, which
+ ** is what GetMp3HeaderInfo() reports on.  By default the first mpeg frame
+ ** is found and decoded, and the duration estimated from it (or from a Xing
+ ** header).  A caller that only needs the tags can skip the search for the
+ ** audio altogether, and one that needs the duration to be exact can have
+ ** every frame walked.  Walking the frames is the only way to get the
+ ** length of a VBR file without a Xing header right; it also fills in the
+ ** average bitrate and where the audio starts and ends.
+ **
+ ** \code
+ **   myTag.Link("mysong.mp3", ID3TT_ALL, ID3LO_TAGSONLY);    // fastest
+ **   myTag.Link("mysong.mp3", ID3TT_ALL, ID3LO_MP3DURATION); // reads it all
+ ** \endcode
+ **
  ** @see IsV2Tag
  ** @param fileInfo The filename of the file to link to.
+ ** @param flags The tag types to parse.
+ ** @param options The ID3_LinkOption flags describing what to do with the audio.
  **/
 #ifdef WIN32
-size_t ID3_Tag::Link(const wchar_t *fileInfo, flags_t flags)
+size_t ID3_Tag::Link(const wchar_t *fileInfo, flags_t flags, flags_t options)
 #else
-size_t ID3_Tag::Link(const char *fileInfo, flags_t flags)
+size_t ID3_Tag::Link(const char *fileInfo, flags_t flags, flags_t options)
 #endif
 {
-  return _impl->Link(fileInfo, flags);
+  return _impl->Link(fileInfo, flags, options);
+}
+
+/**
+ ** Same as above.  A single ID3_LinkOption would otherwise match the
+ ** deprecated Link(fileInfo, bool, bool) just as well, so it gets an
+ ** overload of its own.
+ */
+#ifdef WIN32
+size_t ID3_Tag::Link(const wchar_t *fileInfo, flags_t flags, ID3_LinkOption option)
+#else
+size_t ID3_Tag::Link(const char *fileInfo, flags_t flags, ID3_LinkOption option)
+#endif
+{
+  return _impl->Link(fileInfo, flags, (flags_t) option);
 }
 
 /**
  ** Same as above, but takes a ID3_Reader as argument.
  */
-size_t ID3_Tag::Link(ID3_Reader &reader, flags_t flags)
+size_t ID3_Tag::Link(ID3_Reader &reader, flags_t flags, flags_t options)
+{
+  return _impl->Link(reader, flags, options);
+}
+
+#ifndef WIN32
+/** Links the tag with the named file, as above, but reads the file through
+ ** the given reader, which has to read that file as it is stored: from its
+ ** first byte to its last, at the same positions.  This lets the caller
+ ** decide how the file is read (from blocks it has read already, say)
+ ** while the tag stays linked to the file for Update() and for any picture
+ ** data left there with ID3LO_PICTUREOFFSETS.
+ **
+ ** @param fileInfo The filename of the file to link to
+ ** @param reader Reads the file's contents
+ ** @param flags The tag types to parse.
+ ** @param options The ID3_LinkOption flags describing what to do with the audio.
+ **/
+size_t ID3_Tag::Link(const char *fileInfo, ID3_Reader &reader, flags_t flags,
+                     flags_t options)
 {
-  return _impl->Link(reader, flags);
+  return _impl->Link(fileInfo, reader, flags, options);
 }
+#endif
 
 flags_t ID3_Tag::Update(flags_t flags)
 {
   return _impl->Update(flags);
 }
 
+/** Starts an edit session on the attached file.
+ **
+ ** Until the session is committed, calls to Update() write nothing; they
+ ** only note which tag types were asked for and return ID3TT_NONE.  Any
+ ** number of changes can be made to the tag in between, including through
+ ** the misc_support helpers, and CommitEdit() then writes the result with a
+ ** single Update(): the tag is sized once, the choice between rewriting the
+ ** tag in place and rewriting the file is made once, and each tag type is
+ ** written to the file once.
+ **
+ ** \code
+ **   myTag.BeginEdit();
+ **   ID3_AddArtist(&myTag, "Artist", true);
+ **   myTag.Update();           // deferred
+ **   ID3_AddTitle(&myTag, "Title", true);
+ **   myTag.Update();           // deferred
+ **   myTag.CommitEdit();       // one write
+ ** \endcode
+ **
+ ** Calling BeginEdit() while a session is already open has no effect.
+ **
+ ** @see CommitEdit
+ ** @see AbortEdit
+ **/
+void ID3_Tag::BeginEdit()
+{
+  _impl->BeginEdit();
+}
+
+/** Ends the edit session and writes the changes made during it.  The tag
+ ** types written are those passed in, along with any requested by Update()
+ ** calls made during the session.  Without an open session this is the same
+ ** as Update().
+ **
+ ** \param tt The type of tag to update.
+ ** \return The tag types written to the file.
+ **/
+flags_t ID3_Tag::CommitEdit(flags_t flags)
+{
+  return _impl->CommitEdit(flags);
+}
+
+/** Ends the edit session without writing anything.  Since the file hasn't
+ ** been touched since BeginEdit(), the tag is cleared and parsed from the
+ ** file again, discarding the changes made during the session (along with
+ ** any rendering options set on the tag).  A tag that isn't linked to a file
+ ** keeps its changes.
+ **/
+void ID3_Tag::AbortEdit()
+{
+  _impl->AbortEdit();
+}
+
+/** Indicates whether an edit session is open. **/
+bool ID3_Tag::InEdit() const
+{
+  return _impl->InEdit();
+}
+
 /**
  ** Get's the mp3 Info like bitrate, mpeg version, etc.
  ** Can be run after Link(<filename>)
@@ -737,6 +950,81 @@ const Mp3_Headerinfo* ID3_Tag::GetMp3HeaderInfo() const
   return _impl->GetMp3HeaderInfo();
 }
 
+/** Finds where in the file to seek to for the audio at a given time.
+ ** 
+ ** Without a table of its own, a VBR file is seeked into through the table
+ ** in its Xing or VBRI header, interpolating between its entries; a CBR
+ ** file is taken to be evenly spread.  Linking with ID3LO_MP3DURATION
+ ** builds a sparse index of the frames themselves, every 32nd frame, and
+ ** the offset found is then that of the last indexed frame at or before
+ ** the given time.  Either way the lookup is done in constant time.
+ **
+ ** \code
+ **   ID3_Tag myTag;
+ **   myTag.Link("mysong.mp3", ID3TT_ALL, ID3LO_MP3DURATION);
+ **   size_t offset;
+ **   if (myTag.GetMp3Offset(90 * 1000, offset))
+ **   {
+ **     // stream the file from offset for the song from 1:30 on
+ **   }
+ ** \endcode
+ **
+ ** @see GetMp3Time
+ ** @param milliseconds The time into the song.
+ ** @param offset Set to the offset in the file.
+ ** @return Whether the file had audio to seek in.
+ **/
+bool ID3_Tag::GetMp3Offset(uint32 milliseconds, size_t& offset) const
+{
+  return _impl->GetMp3Offset(milliseconds, offset);
+}
+
+/** Finds the time in the song of the audio at an offset in the file; the
+ ** reverse of GetMp3Offset().
+ **
+ ** @param offset The offset in the file.
+ ** @param milliseconds Set to the time into the song.
+ ** @return Whether the file had audio to seek in, at or before offset.
+ **/
+bool ID3_Tag::GetMp3Time(size_t offset, uint32& milliseconds) const
+{
+  return _impl->GetMp3Time(offset, milliseconds);
+}
+
+/** Checks the audio of the linked file for damage.
+ **
+ ** Every mpeg frame is walked, and those protected by a crc are checked
+ ** against it; only layer III crcs can be checked without decoding the
+ ** audio.  A frame whose crc doesn't match is corrupt, and so is each place
+ ** where the frames break off before the end of the audio.  Long files are
+ ** split into chunks that are checked in parallel.
+ **
+ ** \code
+ **   ID3_Tag myTag("mysong.mp3");
+ **   Mp3_Integrity integrity;
+ **   uint32 offsets[10];
+ **   if (myTag.VerifyMp3(integrity, offsets, 10) && integrity.corrupt > 0)
+ **   {
+ **     // the first frame found to be damaged starts at offsets[0]
+ **   }
+ ** \endcode
+ **
+ ** @param integrity Set to the numbers of frames walked, checked and found
+ **                  to be corrupt.
+ ** @param corrupt If not NULL, filled in with the offsets in the file of
+ **                the first max corrupt frames, in order.
+ ** @param max The size of corrupt.
+ ** @param threads How many threads to check the audio on; 0 for as many
+ **                as there are processors.
+ ** @return false if no audio was found when the file was linked, or it
+ **         couldn't be read.
+ **/
+bool ID3_Tag::VerifyMp3(Mp3_Integrity& integrity, uint32* corrupt, 
+                        size_t max, size_t threads) const
+{
+  return _impl->VerifyMp3(integrity, corrupt, max, threads);
+}
+
 /** Strips the tag(s) from the attached file. The type of tag stripped
  ** can be specified as a parameter.  The default is to strip all tag types.
  **
@@ -870,6 +1158,79 @@ ID3_Frame* ID3_Tag::Find(ID3_FrameID id, ID3_FieldID fld, const unicode_t* data)
   return _impl->Find(id, fld, (const char*) data, ID3TE_UTF16);
 }
 
+/** Returns the first frame with the given frame id, or NULL if there is none.
+ **
+ ** Unlike Find(), which picks up each search where the last one left off,
+ ** FindFirst() and FindAll() keep no state in the tag: they always search
+ ** the whole tag from the start, and only read it.  Any number of threads
+ ** may make these lookups on one tag at the same time, iterate over it with
+ ** a ConstIterator, and read the frames and fields they find, as long as
+ ** nothing changes the tag meanwhile.  That takes in more than the non-const
+ ** methods: Find() moves the cursor it keeps, Render() clears the tag's and
+ ** frames' changed flags, and binary data that was left in the file
+ ** (ID3LO_PICTUREOFFSETS) or attached is read in when it is first asked
+ ** for.  Read such data in before sharing the tag.
+ **
+ ** \code
+ **   // any number of threads, one shared tag
+ **   const ID3_Frame* title = sharedTag.FindFirst(ID3FID_TITLE);
+ ** \endcode
+ **
+ ** @param  id The ID of the frame that is to be located
+ ** @return The first frame with that ID, or NULL if no such frame.
+ **/
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id) const
+{
+  return _impl->FindFirst(id);
+}
+
+/// Finds the first frame with given frame id, fld id, and integer data
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id, ID3_FieldID fld, uint32 data) const
+{
+  return _impl->FindFirst(id, fld, data);
+}
+
+/// Finds the first frame with given frame id, fld id, and ISO8859-1 data
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id, ID3_FieldID fld, const char* data) const
+{
+  return _impl->FindFirst(id, fld, data, ID3TE_ISO8859_1);
+}
+
+/// Finds the first frame with given frame id, fld id, and utf16 data
+ID3_Frame* ID3_Tag::FindFirst(ID3_FrameID id, ID3_FieldID fld, const unicode_t* data) const
+{
+  return _impl->FindFirst(id, fld, (const char*) data, ID3TE_UTF16);
+}
+
+/** Adds every frame with the given frame id to frames, in the order they are
+ ** in the tag, in a single pass; like FindFirst(), it keeps no state in the
+ ** tag and is safe for concurrent readers.
+ **
+ ** @return The number of frames added.
+ **/
+size_t ID3_Tag::FindAll(ID3_FrameID id, std::vector<ID3_Frame*>& frames) const
+{
+  return _impl->FindAll(id, frames);
+}
+
+/// Adds every frame with given frame id, fld id, and integer data
+size_t ID3_Tag::FindAll(ID3_FrameID id, ID3_FieldID fld, uint32 data, std::vector<ID3_Frame*>& frames) const
+{
+  return _impl->FindAll(id, fld, data, frames);
+}
+
+/// Adds every frame with given frame id, fld id, and ISO8859-1 data
+size_t ID3_Tag::FindAll(ID3_FrameID id, ID3_FieldID fld, const char* data, std::vector<ID3_Frame*>& frames) const
+{
+  return _impl->FindAll(id, fld, data, ID3TE_ISO8859_1, frames);
+}
+
+/// Adds every frame with given frame id, fld id, and utf16 data
+size_t ID3_Tag::FindAll(ID3_FrameID id, ID3_FieldID fld, const unicode_t* data, std::vector<ID3_Frame*>& frames) const
+{
+  return _impl->FindAll(id, fld, (const char*) data, ID3TE_UTF16, frames);
+}
+
 /** Returns the number of frames present in the tag object.
  **
  ** This includes only those frames that id3lib recognises.  This is used as
@@ -1110,7 +1471,7 @@ namespace
     ID3_TagImpl::const_iterator _cur;
     ID3_TagImpl::const_iterator _end;
   public:
-    ConstIteratorImpl(ID3_TagImpl& tag)
+    ConstIteratorImpl(const ID3_TagImpl& tag)
       : _cur(tag.begin()), _end(tag.end())
     {
     }
@@ -26,9 +26,12 @@
 // http://download.sourceforge.net/id3lib/
 
 #include <stdio.h>  //for BUFSIZ and functions remove & rename
+#include <errno.h>
 #include "writers.h"
 #include "io_strings.h"
+#include "io_helpers.h"
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "field_impl.h"
 
 using namespace dami;
 
@@ -44,6 +47,10 @@ using namespace dami;
 #  include <sys/stat.h>
 #endif
 
+#if defined HAVE_FCNTL_H
+#  include <fcntl.h>
+#endif
+
 #if defined WIN32 //Klenotic
 #  include <io.h>
 #endif
@@ -136,12 +143,15 @@ size_t ID3_TagImpl::Link(const char *fileInfo, bool parseID3v1, bool parseLyrics
 }
 
 #ifdef WIN32
-size_t ID3_TagImpl::Link(const wchar_t *fileInfo, flags_t tag_types)
+size_t ID3_TagImpl::Link(const wchar_t *fileInfo, flags_t tag_types, 
+                         flags_t options)
 #else
-size_t ID3_TagImpl::Link(const char *fileInfo, flags_t tag_types)
+size_t ID3_TagImpl::Link(const char *fileInfo, flags_t tag_types, 
+                         flags_t options)
 #endif
 {
   _tags_to_parse.set(tag_types);
+  _link_options.set(options);
 
   if (NULL == fileInfo)
   {
@@ -157,9 +167,11 @@ size_t ID3_TagImpl::Link(const char *fileInfo, flags_t tag_types)
 }
 
 // used for streaming:
-size_t ID3_TagImpl::Link(ID3_Reader &reader, flags_t tag_types)
+size_t ID3_TagImpl::Link(ID3_Reader &reader, flags_t tag_types, 
+                         flags_t options)
 {
   _tags_to_parse.set(tag_types);
+  _link_options.set(options);
 
 #ifdef WIN32
   _file_name = L"";
@@ -173,64 +185,103 @@ size_t ID3_TagImpl::Link(ID3_Reader &reader, flags_t tag_types)
   return this->GetPrependedBytes();
 }
 
-size_t RenderV1ToFile(ID3_TagImpl& tag, fstream& file)
+#ifndef WIN32
+// a file read through a reader of the caller's
+size_t ID3_TagImpl::Link(const char *fileInfo, ID3_Reader &reader,
+                         flags_t tag_types, flags_t options)
 {
-  if (!file)
+  _tags_to_parse.set(tag_types);
+  _link_options.set(options);
+
+  if (NULL == fileInfo)
   {
     return 0;
   }
 
-  // Heck no, this is stupid.  If we do not read in an initial V1(.1)
-  // header then we are constantly appending new V1(.1) headers. Files
-  // can get very big that way if we never overwrite the old ones.
-  //  if (ID3_V1_LEN > tag.GetAppendedBytes())   - Daniel Hazelbaker
-  if (ID3_V1_LEN > tag.GetFileSize())
+  _file_name = fileInfo;
+  _changed = true;
+
+  this->ParseReader(reader);
+
+  return this->GetPrependedBytes();
+}
+#endif
+
+namespace
+{
+  // Reads in any picture data that was left in the file, before the tag it
+  // is in is taken out of the file or written over.
+  void loadPictures(const ID3_TagImpl& tag)
   {
-    file.seekp(0, ios::end);
+    for (ID3_TagImpl::const_iterator iter = tag.begin(); iter != tag.end(); ++iter)
+    {
+      const ID3_Frame* frame = *iter;
+      if (frame && frame->GetID() == ID3FID_PICTURE)
+      {
+        const ID3_FieldImpl* fld = (const ID3_FieldImpl*) frame->GetField(ID3FN_DATA);
+        if (fld)
+        {
+          fld->LoadBinary();
+        }
+      }
+    }
   }
-  else
+
+  // Checks for an id3v1 tag at offset with a single positional read.
+  bool hasV1TagAt(int fd, size_t offset)
   {
-    // We want to check if there is already an id3v1 tag, so we can write over
-    // it.  First, seek to the beginning of any possible id3v1 tag
-    file.seekg(0-ID3_V1_LEN, ios::end);
     char sID[ID3_V1_LEN_ID];
+    return io::readAt(fd, sID, ID3_V1_LEN_ID, offset) == ID3_V1_LEN_ID &&
+           memcmp(sID, "TAG", ID3_V1_LEN_ID) == 0;
+  }
 
-    // Read in the TAG characters
-    file.read(sID, ID3_V1_LEN_ID);
-
-    // If those three characters are TAG, then there's a preexisting id3v1 tag,
-    // so we should set the file cursor so we can overwrite it with a new tag.
-    if (memcmp(sID, "TAG", ID3_V1_LEN_ID) == 0)
-    {
-      file.seekp(0-ID3_V1_LEN, ios::end);
-    }
-    // Otherwise, set the cursor to the end of the file so we can append on
-    // the new tag.
-    else
+  // Copies everything in src from srcOff onwards to dst at dstOff, using
+  // positional reads and writes so neither descriptor's file position is
+  // disturbed.
+  bool copyData(int src, size_t srcOff, int dst, size_t dstOff)
+  {
+    char buffer[BUFSIZ * 8];
+    size_t nBytes;
+    while ((nBytes = io::readAt(src, buffer, sizeof(buffer), srcOff)) > 0)
     {
-      file.seekp(0, ios::end);
+      if (!io::writeAt(dst, buffer, nBytes, dstOff))
+      {
+        return false;
+      }
+      srcOff += nBytes;
+      dstOff += nBytes;
     }
+    return true;
   }
+}
 
-  ID3_IOStreamWriter out(file);
-
+// The v1 tag is a fixed 128 byte block, so it is rendered on the stack and
+// written with a single positional write at the offset worked out by the
+// caller.
+size_t RenderV1ToFile(ID3_TagImpl& tag, int fd, size_t offset)
+{
+  uchar buffer[ID3_V1_LEN];
+  ID3_MemoryWriter out(buffer, ID3_V1_LEN);
   id3::v1::render(out, tag);
 
-  return ID3_V1_LEN;
+  return io::writeAt(fd, buffer, ID3_V1_LEN, offset) ? ID3_V1_LEN : 0;
 }
 
-//Klenotic: The RewriteFile() function assists RenderV2ToFile() and ID3_TagImpl::Strip().  It uses
-//          C File IO for fast performance and adds code to properly copy file permissions on 
-//          Windows systems.  
-size_t RewriteFile(const ID3_TagImpl& tag, const char* tagData, const size_t tagSize)
+//Klenotic: The RewriteFile() function assists RenderV2ToFile() and ID3_TagImpl::Strip().  It
+//          builds the new file next to the original and renames it into place, preserving
+//          the original's permissions.
+//          The v2 tag is rendered directly into the new file through an ID3_FDWriter,
+//          following the layout worked out by ID3_TagImpl::Size(); a layout with a total
+//          of 0 leaves the tag out.  The rest of the file is copied from fd, starting after
+//          the old prepended tag.  On success the descriptor of the new file is returned
+//          (it is open for reading and writing), otherwise -1.
+int RewriteFile(const ID3_TagImpl& tag, int fd, const id3::v2::Layout& layout)
 {
 	ID3D_NOTICE( "RewriteFile: starting" );
 
-	bool bSuccess = false;
-
 #ifdef WIN32
 	_ASSERT(false);
-	return false;
+	return -1;
 #else
 	String filename = tag.GetFileName();
 	String sTmpSuffix = ".XXXXXX";
@@ -239,134 +290,184 @@ size_t RewriteFile(const ID3_TagImpl& tag, const char* tagData, const size_t tag
 	strcpy(sTempFile, filename.c_str());
 	strcat(sTempFile, sTmpSuffix.c_str());
 
-#if defined(WIN32)
-	_mktemp(sTempFile);	
-#elif defined(HAVE_MKTEMP)
+#if defined(HAVE_MKSTEMP)
+	int tmpFd = mkstemp(sTempFile);
+#else
 	mktemp(sTempFile);
+	int tmpFd = ::open(sTempFile, O_RDWR | O_CREAT | O_EXCL, 0600);
 #endif
 
-	FILE* fileIn = fopen(filename.c_str(), "r+b"); // Technically, we don't need to open this with write access.  However, to the user, this is supposed to be an in-place update.  To be consistent with that model, we'll open the source file with write access.
-	if (fileIn)
+	bool bSuccess = false;
+	if (tmpFd >= 0)
 	{
-		FILE* tmpOut = fopen(sTempFile, "w+b");
-		if (tmpOut)
+		// Begin Write Tag //
+		const size_t tagSize = layout.total;
+		size_t ioResult = 0;
+		if (tagSize > 0)
 		{
-			// Begin Write Tag //
-			size_t ioResult = 0;
-			if ( (tagData) && (tagSize > 0) )
-				ioResult = fwrite(tagData, sizeof(char), tagSize, tmpOut);
-			// End Write Tag //
-
-			// Begin Write File Data //
-			if (ioResult == tagSize) // The tag was written correctly
-			{
-				unsigned char tmpBuffer[BUFSIZ] = {0};
-				fseek(fileIn, tag.GetPrependedBytes(), SEEK_SET);
-				while (!feof(fileIn))
-				{
-					size_t nBytes = fread(tmpBuffer, sizeof(unsigned char), BUFSIZ, fileIn);
-					fwrite(tmpBuffer, sizeof(unsigned char), nBytes, tmpOut);
-				}
-
-				if (!ferror(fileIn) && !ferror(tmpOut))
-					bSuccess = true;
-			}
-			// End Write File Data //
-
-			fclose(tmpOut);
+			ID3_FDWriter out(tmpFd);
+			id3::v2::render(out, tag, layout);
+			out.flush();
+			if (out.good())
+				ioResult = out.getCur();
 		}
+		// End Write Tag //
 
-		fclose(fileIn);
+		// Begin Write File Data //
+		if (ioResult == tagSize) // The tag was written correctly
+			bSuccess = copyData(fd, tag.GetPrependedBytes(), tmpFd, tagSize);
+		// End Write File Data //
 	}
 
 	if (bSuccess)
 	{
-		bSuccess = false;
-
 		// the following sets the permissions of the new file
 		// to be the same as the original
-#if defined(WIN32)
-		DWORD dwLength = 0;
-		GetFileSecurityA(filename.c_str(), DACL_SECURITY_INFORMATION | GROUP_SECURITY_INFORMATION | OWNER_SECURITY_INFORMATION, NULL, 0, &dwLength);
-		SECURITY_DESCRIPTOR* pSecurityDescriptor = reinterpret_cast<SECURITY_DESCRIPTOR*>(new char[dwLength + 1]);
-		if (GetFileSecurityA(filename.c_str(), DACL_SECURITY_INFORMATION | GROUP_SECURITY_INFORMATION | OWNER_SECURITY_INFORMATION, pSecurityDescriptor, dwLength, &dwLength))
-			SetFileSecurityA(sTempFile, DACL_SECURITY_INFORMATION | GROUP_SECURITY_INFORMATION | OWNER_SECURITY_INFORMATION, pSecurityDescriptor);
-		delete[] pSecurityDescriptor;
-#elif defined(HAVE_SYS_STAT_H)
+#if defined(HAVE_SYS_STAT_H)
 		struct stat fileStat;
-		if(stat(filename.c_str(), &fileStat) == 0)
-		{
+		if (fstat(fd, &fileStat) == 0)
+			fchmod(tmpFd, fileStat.st_mode);
 #endif //defined(HAVE_SYS_STAT_H)
 
-			// Begin File Replacement //
-			if (remove(filename.c_str()) == 0)
-			{
-				rename(sTempFile, filename.c_str());
-				bSuccess = true; // This must set this to true even if the rename fails.  The source file has already been deleted.  If the success flag is not set, the temp file will be removed as well.
-			}
-			// End File Replacement //
-
-#if defined(HAVE_SYS_STAT_H)
-	#if !defined(WIN32)
-			chmod(filename.c_str(), fileStat.st_mode);
-		}
-	#endif
-#endif //defined(HAVE_SYS_STAT_H)
+		// Begin File Replacement //
+		bSuccess = (rename(sTempFile, filename.c_str()) == 0);
+		// End File Replacement //
 	}
 	
-	if (!bSuccess)
+	if (!bSuccess && tmpFd >= 0)
+	{
+		::close(tmpFd);
+		tmpFd = -1;
 		remove(sTempFile);
+	}
 
 	delete[] sTempFile;
 
-	return bSuccess ? tagSize : -1;
+	return tmpFd;
 #endif // WIN32
 }
 
 //Klenotic: This is the modified version of the RenderV2ToFile function.
-size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
+// Returns the size of the new tag, or -1 on failure.  If the file had to be
+// rewritten, fd is replaced by a descriptor for the new file.
+size_t RenderV2ToFile(const ID3_TagImpl& tag, int& fd)
 {
 #ifdef WIN32
 	_ASSERT(false);
-	return false;
+	return -1;
 #else
 	ID3D_NOTICE( "RenderV2ToFile: starting" );
-	if (!file)
-	{
-		ID3D_WARNING( "RenderV2ToFile: error in file" );
-		return 0;
-	}
 
-	String tagString;
-	io::StringWriter writer(tagString);
-	id3::v2::render(writer, tag);
-	ID3D_NOTICE( "RenderV2ToFile: rendered v2" );
+	// the tag is sized once, here, and rendered from that layout
+	id3::v2::Layout layout;
+	size_t tagSize = tag.Size(layout);
+	ID3D_NOTICE( "RenderV2ToFile: v2 size = " << tagSize );
 
-	const char* tagData = tagString.data();
-	size_t tagSize = tagString.size();
 	// if the new tag fits perfectly within the old and the old one
 	// actually existed (ie this isn't the first tag this file has had)
 	if ((!tag.GetPrependedBytes() && !ID3_GetDataSize(tag)) ||
 		(tagSize == tag.GetPrependedBytes()))
 	{
-		file.seekp(0, ios::beg);
-		file.write(tagData, tagSize);
+		// frames written ahead of a picture left in the file may overwrite it
+		loadPictures(tag);
+		ID3_FDWriter out(fd);
+		id3::v2::render(out, tag, layout);
+		out.flush();
+		if (!out.good())
+		{
+			ID3D_WARNING( "RenderV2ToFile: error writing tag" );
+			return -1;
+		}
 	}
 	else
 	{
-		file.close(); // We need to close the fstream file to gain access to the file.
-		tagSize = RewriteFile(tag, tagData, tagSize);
-		if (tagSize == -1)
-			tagSize = 0;
-
-		file.clear();//to clear the eof mark
-		openWritableFile(tag.GetFileName(), file); // The code we're returning to expects the file to be open.
+		int newFd = RewriteFile(tag, fd, layout);
+		if (newFd < 0)
+		{
+			return -1;
+		}
+		::close(fd);
+		fd = newFd;
 	}
 
 	return tagSize;
 #endif
 }
 
+// Writes an appended v2 tag, following the layout given, over the oldSize
+// bytes at offset pos; a layout with a total of 0 just removes the old tag.
+// Whatever followed the old tag (an id3v1 tag, say) is moved up behind the
+// new one and the file is truncated to fit.  Nothing before pos is touched,
+// so the audio stays where it is.  Returns the new size of the file, or -1 on
+// failure.
+size_t RenderAppendedV2ToFile(const ID3_TagImpl& tag, int fd,
+                              const id3::v2::Layout& layout,
+                              size_t pos, size_t oldSize)
+{
+#ifdef WIN32
+	_ASSERT(false);
+	return -1;
+#else
+  const size_t fileSize = tag.GetFileSize();
+  const size_t tailSize = fileSize - (pos + oldSize);
+
+  // the tail only has to be rewritten if the tag changes size
+  BString tail;
+  if (layout.total != oldSize && tailSize > 0)
+  {
+    tail.resize(tailSize);
+    if (io::readAt(fd, &tail[0], tailSize, pos + oldSize) != tailSize)
+    {
+      return -1;
+    }
+  }
+
+  ID3_FDWriter out(fd, pos);
+  if (layout.total > 0)
+  {
+    id3::v2::render(out, tag, layout);
+  }
+  out.writeChars(tail.data(), tail.size());
+  out.flush();
+  if (!out.good())
+  {
+    ID3D_WARNING( "RenderAppendedV2ToFile: error writing tag" );
+    return -1;
+  }
+
+  const size_t newSize = pos + layout.total + tailSize;
+  if (newSize < fileSize && ::ftruncate(fd, newSize) != 0)
+  {
+    return -1;
+  }
+  return newSize;
+#endif
+}
+
+// Empties the prepended tag in place, keeping its size so that nothing after
+// it moves.  A tag whose frame data already starts with padding is left be.
+bool BlankV2InFile(int fd, size_t tagSize)
+{
+  uchar first = 0;
+  if (io::readAt(fd, &first, 1, ID3_TagHeader::SIZE) == 1 && first == '\0')
+  {
+    return true;
+  }
+
+  ID3_TagHeader hdr;
+  hdr.SetSpec(ID3V2_LATEST);
+  hdr.SetDataSize(tagSize - ID3_TagHeader::SIZE);
+  ID3_FDWriter out(fd);
+  hdr.Render(out);
+  out.writeZeros(tagSize - ID3_TagHeader::SIZE);
+  out.flush();
+  return out.good();
+}
+
+// The update works on a single descriptor using positional I/O.  The layout
+// of the file (its size, and the size of the prepended and appended tags) is
+// taken from the last Link() or Update() rather than probed again, so an
+// in-place update costs one open, one gathered write per tag and one close.
 flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 {
 #ifdef WIN32
@@ -375,51 +476,187 @@ flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 #else
   flags_t tags = ID3TT_NONE;
 
-  fstream file;
-  String filename = this->GetFileName();
-  ID3_Err err = openWritableFile(filename, file);
-  _file_size = getFileSize(file);
+  // Within an edit session the write is left to CommitEdit()
+  if (_in_edit)
+  {
+    _deferred_tags.add(ulTagFlag);
+    return tags;
+  }
 
-  if (err == ID3E_NoFile)
+  // Decide what needs writing before touching the file, so that a v1-only
+  // update (or one with nothing to do) skips the v2 machinery entirely.
+  const bool changed = this->HasChanged();
+  const bool updateV2 = (ulTagFlag & ID3TT_ID3V2) && changed;
+  const bool updateV1 = (ulTagFlag & ID3TT_ID3V1) &&
+                        (!this->HasTagType(ID3TT_ID3V1) || changed);
+  if (!updateV2 && !updateV1)
   {
-    err = createFile(filename, file);
+    _changed = false;
+    return tags;
   }
-  if (err == ID3E_ReadOnly)
+
+  String filename = this->GetFileName();
+  int fd = ::open(filename.c_str(), O_RDWR);
+  if (fd < 0 && errno == ENOENT)
+  {
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT, 0666);
+    _file_size = 0;
+  }
+  if (fd < 0)
   {
     return tags;
   }
 
-  if ((ulTagFlag & ID3TT_ID3V2) && this->HasChanged())
+  // Only consult the file if the last parse didn't find an id3v1 tag; v1
+  // always comes last, so it survives a rewrite of the prepended tag.
+  bool hasV1 = _file_tags.test(ID3TT_ID3V1);
+  if (updateV1 && !hasV1 && _file_size >= ID3_V1_LEN)
   {
-    _prepended_bytes = RenderV2ToFile(*this, file);
-    if (_prepended_bytes)
+    hasV1 = hasV1TagAt(fd, _file_size - ID3_V1_LEN);
+  }
+
+  if (updateV2 && _is_appended)
+  {
+    // the tag goes where the old appended tag was, or else ahead of any other
+    // appended tags; only what follows it can move
+    id3::v2::Layout layout;
+    this->Size(layout);
+    size_t pos = _appended_v2_bytes ? _appended_v2_pos 
+                                    : _file_size - _appended_bytes;
+    size_t fileSize = 
+      RenderAppendedV2ToFile(*this, fd, layout, pos, _appended_v2_bytes);
+    if (fileSize != static_cast<size_t>(-1))
     {
-      tags |= ID3TT_ID3V2;
+      _appended_bytes = _appended_bytes - _appended_v2_bytes + layout.total;
+      _appended_v2_pos = pos;
+      _appended_v2_bytes = layout.total;
+      _file_size = fileSize;
+      if (_appended_v2_bytes)
+      {
+        tags |= ID3TT_ID3V2;
+      }
+      // the frames now live in the appended tag alone
+      if (_prepended_bytes > ID3_TagHeader::SIZE)
+      {
+        BlankV2InFile(fd, _prepended_bytes);
+      }
+    }
+  }
+  else if (updateV2)
+  {
+    // the frames of an appended tag were merged in when parsing, so it goes
+    if (_appended_v2_bytes)
+    {
+      const id3::v2::Layout noTag = id3::v2::Layout();
+      size_t fileSize = RenderAppendedV2ToFile(*this, fd, noTag, 
+                                               _appended_v2_pos,
+                                               _appended_v2_bytes);
+      if (fileSize != static_cast<size_t>(-1))
+      {
+        _appended_bytes -= _appended_v2_bytes;
+        _appended_v2_pos = 0;
+        _appended_v2_bytes = 0;
+        _file_size = fileSize;
+      }
+    }
+
+    size_t tagSize = RenderV2ToFile(*this, fd);
+    if (tagSize != static_cast<size_t>(-1))
+    {
+      _file_size = _file_size - _prepended_bytes + tagSize;
+      _prepended_bytes = tagSize;
+      if (_prepended_bytes)
+      {
+        tags |= ID3TT_ID3V2;
+      }
     }
   }
 
-  if ((ulTagFlag & ID3TT_ID3V1) &&
-      (!this->HasTagType(ID3TT_ID3V1) || this->HasChanged()))
+  if (updateV1)
   {
-    size_t tag_bytes = RenderV1ToFile(*this, file);
+    size_t offset = hasV1 ? _file_size - ID3_V1_LEN : _file_size;
+    size_t tag_bytes = RenderV1ToFile(*this, fd, offset);
     if (tag_bytes)
     {
       // only add the tag_bytes if there wasn't an id3v1 tag before
-      if (! _file_tags.test(ID3TT_ID3V1))
+      if (!hasV1)
       {
         _appended_bytes += tag_bytes;
+        _file_size += tag_bytes;
       }
       tags |= ID3TT_ID3V1;
     }
   }
   _changed = false;
   _file_tags.add(tags);
-  _file_size = getFileSize(file);
-  file.close();
+  ::close(fd);
   return tags;
 #endif
 }
 
+void ID3_TagImpl::BeginEdit()
+{
+  if (!_in_edit)
+  {
+    _in_edit = true;
+    _deferred_tags.clear();
+  }
+}
+
+flags_t ID3_TagImpl::CommitEdit(flags_t ulTagFlag)
+{
+  if (!_in_edit)
+  {
+    return this->Update(ulTagFlag);
+  }
+  _in_edit = false;
+  flags_t tags = ulTagFlag | _deferred_tags.get();
+  _deferred_tags.clear();
+  return this->Update(tags);
+}
+
+void ID3_TagImpl::AbortEdit()
+{
+  if (!_in_edit)
+  {
+    return;
+  }
+  _in_edit = false;
+  _deferred_tags.clear();
+
+  // nothing has been written since the session began, so the file still
+  // holds the tag as it was; throw the edits away and parse it again
+  if (!_file_name.empty() && this->HasChanged())
+  {
+    flags_t tags = _tags_to_parse.get();
+    flags_t options = _link_options.get();
+#ifdef WIN32
+    std::wstring name = _file_name;
+#else
+    String name = _file_name;
+#endif
+    this->Clear();
+    this->Link(name.c_str(), tags, options);
+  }
+}
+
+bool ID3_TagImpl::VerifyMp3(Mp3_Integrity& integrity, uint32* corrupt, 
+                            size_t max, size_t threads) const
+{
+  if (!_mp3_info || _file_name.empty())
+  {
+    return false;
+  }
+  int fd = ::open(_file_name.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+  _mp3_info->Verify(fd, integrity, corrupt, max, threads);
+  ::close(fd);
+  return true;
+}
+
 //Klenotic: this is the modified version of ID3_TagImpl::Strip.
 // returns 0 on failure or ulTagFlag on success.
 flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
@@ -431,24 +668,53 @@ flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
 	flags_t ulTags = ID3TT_NONE;
 	const size_t data_size = ID3_GetDataSize(*this);
 
+	const bool stripPrepended = (ulTagFlag & ID3TT_PREPENDED) && _prepended_bytes &&
+	                            (_file_tags.get() & ID3TT_PREPENDED);
+	const bool stripAppended = (ulTagFlag & ID3TT_APPENDED) && 
+	                           (_file_tags.get() & ID3TT_APPENDED);
+	const bool stripAppendedV2 = (ulTagFlag & ID3TT_ID3V2) && _appended_v2_bytes;
+
+	// An appended id3v2 tag is removed in place, unless the other appended
+	// tags are going too: id3lib writes it ahead of them, so the truncation
+	// below takes it along.
+	if (stripAppendedV2 && !stripAppended)
+	{
+		int fd = ::open(_file_name.c_str(), O_RDWR);
+		if (fd < 0)
+			return 0;
+		const id3::v2::Layout noTag = id3::v2::Layout();
+		size_t fileSize = RenderAppendedV2ToFile(*this, fd, noTag, _appended_v2_pos,
+		                                         _appended_v2_bytes);
+		::close(fd);
+		if (fileSize == static_cast<size_t>(-1))
+			return 0;
+	}
+
 	// First remove the prepended tag(s), if requested.
-	if ( (ulTagFlag & ID3TT_PREPENDED) && (_file_tags.get() & ID3TT_PREPENDED) )
+	if (stripPrepended)
 	{
-		size_t tagSize = RewriteFile(*this, NULL, 0);
-		if (tagSize == -1)
+		loadPictures(*this);
+		int fd = ::open(_file_name.c_str(), O_RDONLY);
+		if (fd < 0)
 			return 0;
+		const id3::v2::Layout noTag = id3::v2::Layout();
+		int newFd = RewriteFile(*this, fd, noTag);
+		::close(fd);
+		if (newFd < 0)
+			return 0;
+		::close(newFd);
 
 		ulTags |= _file_tags.get() & ID3TT_PREPENDED;
 	}
 
 	// Then remove the appended tag(s), if requested.
-	if ( (ulTagFlag & ID3TT_APPENDED) && (_file_tags.get() & ID3TT_APPENDED) )
+	if (stripAppended)
 	{
 		size_t nNewFileSize = data_size;
 
 		ulTags |= _file_tags.get() & ID3TT_APPENDED;
 
-		if (!((ulTagFlag & ID3TT_PREPENDED) && (_file_tags.get() & ID3TT_PREPENDED)))
+		if (!stripPrepended)
 		{
 			// add the original prepended tag size since we don't want to delete it,
 			// and the new file size represents the file size _not_ counting the ID3v2
@@ -460,6 +726,11 @@ flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
 		//	// If we're stripping the ID3v2 tag, there's no need to adjust the new
 		//	// file size, since it doesn't account for the ID3v2 tag size
 		//}
+		if (!stripAppendedV2)
+		{
+			// keep the appended id3v2 tag
+			nNewFileSize += _appended_v2_bytes;
+		}
 		
 		if (ulTags && (truncate(_file_name.c_str(), nNewFileSize) == -1))
 		{
@@ -469,11 +740,28 @@ flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
 		}
 	}
 
-	_prepended_bytes = (ulTags & ID3TT_PREPENDED) ? 0 : _prepended_bytes;
-	_appended_bytes  = (ulTags & ID3TT_APPENDED)  ? 0 : _appended_bytes;
+	if (stripAppendedV2)
+	{
+		ulTags |= ID3TT_ID3V2;
+		_appended_bytes -= _appended_v2_bytes;
+		_appended_v2_pos = 0;
+		_appended_v2_bytes = 0;
+	}
+	else if (stripPrepended)
+	{
+		_appended_v2_pos -= _appended_v2_bytes ? _prepended_bytes : 0;
+	}
+	_prepended_bytes = stripPrepended ? 0 : _prepended_bytes;
+	_appended_bytes  = stripAppended  ? _appended_v2_bytes : _appended_bytes;
 	_file_size = data_size + _prepended_bytes + _appended_bytes;
 
-	_changed = _file_tags.remove(ulTags) || _changed;
+	// the file still has an id3v2 tag if only one of the two was stripped
+	flags_t removed = ulTags;
+	if (_prepended_bytes || _appended_v2_bytes)
+	{
+		removed &= ~ID3TT_ID3V2;
+	}
+	_changed = _file_tags.remove(removed) || _changed;
 
 	return ulTagFlag;
 #endif // WIN32
@@ -58,6 +58,50 @@ ID3_TagImpl::iterator ID3_TagImpl::Find(const ID3_Frame *frame)
   return cur;
 }
 
+namespace
+{
+  bool matches(const ID3_Frame* frame, ID3_FrameID id)
+  {
+    return frame != NULL && frame->GetID() == id;
+  }
+
+  bool matches(const ID3_Frame* frame, ID3_FrameID id, ID3_FieldID fldID,
+               uint32 data)
+  {
+    if (!matches(frame, id) || !frame->Contains(fldID))
+    {
+      return false;
+    }
+    const ID3_Field* fld = frame->GetField(fldID);
+    return fld != NULL && fld->Get() == data;
+  }
+
+  bool matches(const ID3_Frame* frame, ID3_FrameID id, ID3_FieldID fldID,
+               const String& data, ID3_TextEnc sourceEnc)
+  {
+    if (!matches(frame, id) || !frame->Contains(fldID))
+    {
+      return false;
+    }
+    const ID3_Field* fld = frame->GetField(fldID);
+    // only looks in the first text item
+    return fld != NULL && data == fld->GetText(0, sourceEnc);
+  }
+
+  String toString(const char* data, ID3_TextEnc sourceEnc)
+  {
+    if (data == NULL)
+    {
+      return String();
+    }
+    if (ID3TE_IS_DOUBLE_BYTE_ENC(sourceEnc))
+    {
+      return String(data, ucslen(reinterpret_cast<const unicode_t*>(data)) * 2);
+    }
+    return String(data);
+  }
+}
+
 ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id) const
 {
   ID3_Frame *frame = NULL;
@@ -83,7 +127,7 @@ ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id) const
     // search from the cursor to the end
     for (const_iterator cur = begin; cur != end; ++cur)
     {
-      if ((*cur != NULL) && ((*cur)->GetID() == id))
+      if (matches(*cur, id))
       {
         // We've found a valid frame.  Set the cursor to be the next element
         frame = *cur;
@@ -99,7 +143,8 @@ ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id) const
 ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, const char* data, ID3_TextEnc sourceEnc) const
 {
   ID3_Frame *frame = NULL;
-  ID3D_NOTICE( "Find: looking for comment with data = " << data.c_str() );
+  const String str = toString(data, sourceEnc);
+  ID3D_NOTICE( "Find: looking for comment with data = " << data );
 
   // reset the cursor if it isn't set
   if (_frames.end() == _cursor)
@@ -123,24 +168,12 @@ ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, const char* data
     // search from the cursor to the end
     for (const_iterator cur = begin; cur != end; ++cur)
     {
-      ID3D_NOTICE( "Find: frame = " << iCount << (uint32) *cur  );
-      if ((*cur != NULL) && ((*cur)->GetID() == id) &&
-          (*cur)->Contains(fldID))
+      if (matches(*cur, id, fldID, str, sourceEnc))
       {
-        ID3_Field* fld = (*cur)->GetField(fldID);
-        if (NULL == fld)
-        {
-          continue;
-          ID3D_NOTICE( "Find: didn't have the right field" );
-        }
-
-        if ( data == fld->GetText(sourceEnc) ) // bug, does only look in the first text item!
-        {
-          // We've found a valid frame.  Set cursor to be the next element
-          frame = *cur;
-          _cursor = ++cur;
-          break;
-        }
+        // We've found a valid frame.  Set cursor to be the next element
+        frame = *cur;
+        _cursor = ++cur;
+        break;
       }
     }
   }
@@ -173,8 +206,7 @@ ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, uint32 data) con
     // search from the cursor to the end
     for (const_iterator cur = begin; cur != end; ++cur)
     {
-      if ((*cur != NULL) && ((*cur)->GetID() == id) &&
-          ((*cur)->GetField(fldID)->Get() == data))
+      if (matches(*cur, id, fldID, data))
       {
         // We've found a valid frame.  Set the cursor to be the next element
         frame = *cur;
@@ -187,3 +219,85 @@ ID3_Frame *ID3_TagImpl::Find(ID3_FrameID id, ID3_FieldID fldID, uint32 data) con
   return frame;
 }
 
+// The lookups below keep no cursor: they only read the frame list, so any
+// number of threads may make them on one tag at once.
+
+ID3_Frame *ID3_TagImpl::FindFirst(ID3_FrameID id) const
+{
+  for (const_iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    if (matches(*cur, id))
+    {
+      return *cur;
+    }
+  }
+  return NULL;
+}
+
+ID3_Frame *ID3_TagImpl::FindFirst(ID3_FrameID id, ID3_FieldID fldID, uint32 data) const
+{
+  for (const_iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    if (matches(*cur, id, fldID, data))
+    {
+      return *cur;
+    }
+  }
+  return NULL;
+}
+
+ID3_Frame *ID3_TagImpl::FindFirst(ID3_FrameID id, ID3_FieldID fldID, const char* data, ID3_TextEnc sourceEnc) const
+{
+  const String str = toString(data, sourceEnc);
+  for (const_iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    if (matches(*cur, id, fldID, str, sourceEnc))
+    {
+      return *cur;
+    }
+  }
+  return NULL;
+}
+
+size_t ID3_TagImpl::FindAll(ID3_FrameID id, std::vector<ID3_Frame*>& frames) const
+{
+  size_t found = 0;
+  for (const_iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    if (matches(*cur, id))
+    {
+      frames.push_back(*cur);
+      ++found;
+    }
+  }
+  return found;
+}
+
+size_t ID3_TagImpl::FindAll(ID3_FrameID id, ID3_FieldID fldID, uint32 data, std::vector<ID3_Frame*>& frames) const
+{
+  size_t found = 0;
+  for (const_iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    if (matches(*cur, id, fldID, data))
+    {
+      frames.push_back(*cur);
+      ++found;
+    }
+  }
+  return found;
+}
+
+size_t ID3_TagImpl::FindAll(ID3_FrameID id, ID3_FieldID fldID, const char* data, ID3_TextEnc sourceEnc, std::vector<ID3_Frame*>& frames) const
+{
+  const String str = toString(data, sourceEnc);
+  size_t found = 0;
+  for (const_iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
+  {
+    if (matches(*cur, id, fldID, str, sourceEnc))
+    {
+      frames.push_back(*cur);
+      ++found;
+    }
+  }
+  return found;
+}
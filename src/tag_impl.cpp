@@ -99,8 +99,11 @@ ID3_TagImpl::ID3_TagImpl(const char *name)
     _file_size(0),
     _prepended_bytes(0),
     _appended_bytes(0),
+    _appended_v2_pos(0),
+    _appended_v2_bytes(0),
     _is_file_writable(false),
-    _mp3_info(NULL) // need to do this before this->Clear()
+    _mp3_info(NULL), // need to do this before this->Clear()
+    _in_edit(false)
 {
   this->Clear();
   if (name)
@@ -116,8 +119,11 @@ ID3_TagImpl::ID3_TagImpl(const ID3_Tag &tag)
     _file_size(0),
     _prepended_bytes(0),
     _appended_bytes(0),
+    _appended_v2_pos(0),
+    _appended_v2_bytes(0),
     _is_file_writable(false),
-    _mp3_info(NULL) // need to do this before this->Clear()
+    _mp3_info(NULL), // need to do this before this->Clear()
+    _in_edit(false)
 {
   *this = tag;
 }
@@ -140,11 +146,14 @@ void ID3_TagImpl::Clear()
   _frames.clear();
   _cursor = _frames.begin();
   _is_padded = true;
+  _is_appended = false;
+  _crc_status = ID3CRC_NONE;
 
   _hdr.Clear();
   _hdr.SetSpec(ID3V2_LATEST);
 
   _tags_to_parse.clear();
+  _link_options.set(ID3LO_DEFAULT);
   if (_mp3_info)
     delete _mp3_info; // Also deletes _mp3_header
 
@@ -202,6 +211,44 @@ ID3_Frame* ID3_TagImpl::RemoveFrame(const ID3_Frame *frame)
   return frm;
 }
 
+namespace
+{
+  bool hasID(const ID3_Frame* frame, void* id)
+  {
+    return frame->GetID() == *static_cast<ID3_FrameID*>(id);
+  }
+}
+
+size_t ID3_TagImpl::RemoveFrames(ID3_FrameID id)
+{
+  return this->RemoveFrames(hasID, &id);
+}
+
+size_t ID3_TagImpl::RemoveFrames(bool (*matches)(const ID3_Frame*, void*), void* data)
+{
+  size_t numRemoved = 0;
+  iterator fi = _frames.begin();
+  while (fi != _frames.end())
+  {
+    if (*fi != NULL && matches(*fi, data))
+    {
+      delete *fi;
+      fi = _frames.erase(fi);
+      ++numRemoved;
+    }
+    else
+    {
+      ++fi;
+    }
+  }
+  if (numRemoved > 0)
+  {
+    _cursor = _frames.begin();
+    _changed = true;
+  }
+  return numRemoved;
+}
+
 
 bool ID3_TagImpl::HasChanged() const
 {
@@ -252,6 +299,18 @@ bool ID3_TagImpl::SetExtended(bool ext)
   return changed;
 }
 
+// A crc goes in the extended header, so asking for one turns that on too.
+bool ID3_TagImpl::SetCrc(bool crc)
+{
+  bool changed = _hdr.SetCrc(crc);
+  if (crc)
+  {
+    changed = _hdr.SetExtended(true) || changed;
+  }
+  _changed = changed || _changed;
+  return changed;
+}
+
 bool ID3_TagImpl::SetExperimental(bool exp)
 {
   bool changed = _hdr.SetExperimental(exp);
@@ -269,6 +328,11 @@ bool ID3_TagImpl::GetExtended() const
   return _hdr.GetExtended();
 }
 
+bool ID3_TagImpl::GetCrc() const
+{
+  return _hdr.GetCrc();
+}
+
 bool ID3_TagImpl::GetExperimental() const
 {
   return _hdr.GetExperimental();
@@ -281,11 +345,12 @@ bool ID3_TagImpl::GetFooter() const
 
 size_t ID3_TagImpl::GetExtendedBytes() const
 {
+  // tags are written as ID3V2_LATEST, whatever the spec of their frames
   if (this->GetExtended())
-    if (this->GetSpec() == ID3V2_4_0)
-      return 6; //minimal ID3v2.4 ext header size
-    else if (this->GetSpec() == ID3V2_3_0)
-      return 10; //minimal ID3v2.3 ext header size
+    if (ID3V2_LATEST == ID3V2_4_0)
+      return 6 + (this->GetCrc() ? ID3_TagHeader::EXT_V4_CRC_SIZE : 0); //minimal ID3v2.4 ext header size
+    else if (ID3V2_LATEST == ID3V2_3_0)
+      return 10 + (this->GetCrc() ? ID3_TagHeader::EXT_V3_CRC_SIZE : 0); //minimal ID3v2.3 ext header size
     else
       return 0; //not implemented
   else
@@ -304,6 +369,24 @@ bool ID3_TagImpl::SetPadding(bool pad)
   return changed;
 }
 
+bool ID3_TagImpl::SetAppended(bool append)
+{
+  bool changed = (_is_appended != append);
+  _changed = changed || _changed;
+  if (changed)
+  {
+    _is_appended = append;
+    // appended tags are an id3v2.4 feature, and are found by their footer
+    if (append)
+    {
+      this->SetSpec(ID3V2_4_0);
+    }
+    _hdr.SetFooter(append);
+  }
+
+  return changed;
+}
+
 
 ID3_TagImpl &
 ID3_TagImpl::operator=( const ID3_Tag &rTag )
@@ -313,6 +396,7 @@ ID3_TagImpl::operator=( const ID3_Tag &rTag )
   this->SetUnsync(rTag.GetUnsync());
   this->SetExtended(rTag.GetExtendedHeader());
   this->SetExperimental(rTag.GetExperimental());
+  this->SetCrc(rTag.GetCrc());
 
   ID3_Tag::ConstIterator* iter = rTag.CreateIterator();
   const ID3_Frame* frame = NULL;
@@ -30,6 +30,7 @@
 #define _ID3LIB_TAG_IMPL_H_
 
 #include <list>
+#include <vector>
 #include <stdio.h>
 #include "tag.h" // has frame.h, field.h
 #include "header_tag.h"
@@ -49,8 +50,29 @@ namespace dami
     };
     namespace v2
     {
-      bool parse(ID3_TagImpl& tag, ID3_Reader& rdr);
+      // The largest tag that is read in one go when its picture data could
+      // be left in the file instead.  Larger ones are parsed from the file.
+      const size_t TAG_BLOCK_SIZE = 256 * 1024;
+
+      // The exact byte counts of a rendered v2 tag, so that a tag sized
+      // once can be rendered without being sized again.
+      struct Layout
+      {
+        size_t frames;  // rendered (and unsynced) frames
+        size_t syncs;   // sync bytes inserted by unsynchronisation
+        size_t padding;
+        size_t total;   // header, extended header, frames and padding
+        uint32 crc;     // for the extended header, if the tag has one
+        // the compressed frames as rendered while sizing, in tag order, so
+        // that render() doesn't deflate them again
+        std::vector<String> compressed;
+      };
+
+      bool parse(ID3_TagImpl& tag, ID3_Reader& rdr, const char* source = NULL);
+      bool parseAppended(ID3_TagImpl& tag, ID3_Reader& rdr);
+      void layout(const ID3_TagImpl& tag, Layout& layout);
       void render(ID3_Writer& writer, const ID3_TagImpl& tag);
+      void render(ID3_Writer& writer, const ID3_TagImpl& tag, const Layout&);
     };
   };
   namespace lyr3
@@ -89,33 +111,52 @@ public:
   bool       HasChanged() const;
   void       SetChanged(bool b) { _changed = b; }
   size_t     Size() const;
+  size_t     Size(dami::id3::v2::Layout&) const;
 
   bool       SetUnsync(bool);
   bool       SetExtended(bool);
   bool       SetExperimental(bool);
+  bool       SetCrc(bool);
   bool       SetPadding(bool);
+  bool       SetAppended(bool);
 
   bool       GetUnsync() const;
   bool       GetExtended() const;
   bool       GetExperimental() const;
+  bool       GetCrc() const;
   bool       GetFooter() const;
+  bool       GetAppended() const { return _is_appended; }
 
   size_t     GetExtendedBytes() const;
+  ID3_TagCrc GetCrcStatus() const { return _crc_status; }
+  void       SetCrcStatus(ID3_TagCrc status) { _crc_status = status; }
 
   void       AddFrame(const ID3_Frame&);
   void       AddFrame(const ID3_Frame*);
   bool       AttachFrame(ID3_Frame*);
   ID3_Frame* RemoveFrame(const ID3_Frame *);
+  size_t     RemoveFrames(ID3_FrameID);
+  size_t     RemoveFrames(bool (*matches)(const ID3_Frame*, void*), void* data);
 
 #ifdef WIN32
-  size_t     Link(const wchar_t *fileInfo, flags_t = (flags_t) ID3TT_ALL);
+  size_t     Link(const wchar_t *fileInfo, flags_t = (flags_t) ID3TT_ALL,
+                   flags_t = (flags_t) ID3LO_DEFAULT);
 #else
-  size_t     Link(const char *fileInfo, flags_t = (flags_t) ID3TT_ALL);
+  size_t     Link(const char *fileInfo, flags_t = (flags_t) ID3TT_ALL,
+                   flags_t = (flags_t) ID3LO_DEFAULT);
+  size_t     Link(const char *fileInfo, ID3_Reader &reader,
+                   flags_t = (flags_t) ID3TT_ALL, flags_t = (flags_t) ID3LO_DEFAULT);
 #endif
-  size_t     Link(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ALL);
+  size_t     Link(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ALL,
+                   flags_t = (flags_t) ID3LO_DEFAULT);
   flags_t    Update(flags_t = (flags_t) ID3TT_ALL);
   flags_t    Strip(flags_t = (flags_t) ID3TT_ALL);
 
+  void       BeginEdit();
+  flags_t    CommitEdit(flags_t = (flags_t) ID3TT_ALL);
+  void       AbortEdit();
+  bool       InEdit() const { return _in_edit; }
+
   size_t     GetPrependedBytes() const { return _prepended_bytes; }
   size_t     GetAppendedBytes() const { return _appended_bytes; }
   size_t     GetFileSize() const { return _file_size; }
@@ -129,6 +170,12 @@ public:
   ID3_Frame* Find(ID3_FrameID id, ID3_FieldID fld, uint32 data) const;
   ID3_Frame* Find(ID3_FrameID id, ID3_FieldID fld, const char* data, ID3_TextEnc enc = ID3TE_ISO8859_1 ) const;
   // ID3_Frame* Find(ID3_FrameID id, ID3_FieldID fld, dami::WString) const;
+  ID3_Frame* FindFirst(ID3_FrameID id) const;
+  ID3_Frame* FindFirst(ID3_FrameID id, ID3_FieldID fld, uint32 data) const;
+  ID3_Frame* FindFirst(ID3_FrameID id, ID3_FieldID fld, const char* data, ID3_TextEnc enc = ID3TE_ISO8859_1) const;
+  size_t     FindAll(ID3_FrameID id, std::vector<ID3_Frame*>&) const;
+  size_t     FindAll(ID3_FrameID id, ID3_FieldID fld, uint32 data, std::vector<ID3_Frame*>&) const;
+  size_t     FindAll(ID3_FrameID id, ID3_FieldID fld, const char* data, ID3_TextEnc enc, std::vector<ID3_Frame*>&) const;
 
   size_t     NumFrames() const { return _frames.size(); }
   ID3_TagImpl&   operator=( const ID3_Tag & );
@@ -140,6 +187,9 @@ public:
   static size_t IsV2Tag(ID3_Reader&);
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const { if (_mp3_info) return _mp3_info->GetMp3HeaderInfo(); else return NULL; }
+  bool GetMp3Offset(uint32 ms, size_t& offset) const { return _mp3_info && _mp3_info->TimeToOffset(ms, offset); }
+  bool GetMp3Time(size_t offset, uint32& ms) const { return _mp3_info && _mp3_info->OffsetToTime(offset, ms); }
+  bool VerifyMp3(Mp3_Integrity&, uint32* corrupt, size_t max, size_t threads) const;
 
   iterator         begin()       { return _frames.begin(); }
   iterator         end()         { return _frames.end(); }
@@ -164,14 +214,14 @@ protected:
   const_iterator Find(const ID3_Frame *) const;
   iterator Find(const ID3_Frame *);
 
-  void       RenderExtHeader(uchar *);
-
   void       ParseFile();
   void       ParseReader(ID3_Reader &reader);
 
 private:
   ID3_TagHeader _hdr;          // information relevant to the tag header
   bool       _is_padded;       // add padding to tags?
+  bool       _is_appended;     // write the v2 tag at the end of the file?
+  ID3_TagCrc _crc_status;      // did the parsed tag's crc match?
 
   Frames     _frames;
 
@@ -187,10 +237,15 @@ private:
   size_t     _file_size;       // the size of the file (without any tag(s))
   size_t     _prepended_bytes; // number of tag bytes at start of file
   size_t     _appended_bytes;  // number of tag bytes at end of file
+  size_t     _appended_v2_pos; // where the appended v2 tag starts, if any
+  size_t     _appended_v2_bytes; // size of the appended v2 tag (in _appended_bytes)
   bool       _is_file_writable;// is the associated file (via Link) writable?
   ID3_Flags  _tags_to_parse;   // which tag types should attempt to be parsed
+  ID3_Flags  _link_options;    // how much of the audio should be analysed
   ID3_Flags  _file_tags;       // which tag types does the file contain
   Mp3Info    *_mp3_info;   // class used to retrieve _mp3_header
+  bool       _in_edit;         // are Update()s being deferred to CommitEdit()?
+  ID3_Flags  _deferred_tags;   // tag types requested by deferred Update()s
 };
 
 size_t     ID3_GetDataSize(const ID3_TagImpl&);
@@ -25,23 +25,30 @@
 // id3lib.  These files are distributed with id3lib at
 // http://download.sourceforge.net/id3lib/
 
-//#if defined HAVE_CONFIG_H
-//#include <config.h> // Must include before zlib.h to compile on WinCE
-//#endif
+#if defined HAVE_CONFIG_H
+#include <config.h> // Must include before zlib.h to compile on WinCE
+#endif
 
-//#include <zlib.h>
+#include <zlib.h>
 //#include <string.h>
 //#include <memory.h>
 
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
 //#include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "io_strings.h"
+#include "io_helpers.h"
+#include "spec.h"
 
 using namespace dami;
 
 namespace
 {
-  bool parseFrames(ID3_TagImpl& tag, ID3_Reader& rdr)
+  // how much of the end of a file to read for the appended tags
+  const size_t TAIL_BLOCK_SIZE = 64 * 1024;
+
+  // If source is given, rdr is reading that file as it is stored, and
+  // picture data is left there.
+  bool parseFrames(ID3_TagImpl& tag, ID3_Reader& rdr, const char* source = NULL)
   {
     ID3_Reader::pos_type beg = rdr.getCur();
     io::ExitTrigger et(rdr, beg);
@@ -56,7 +63,7 @@ namespace
       last_pos = rdr.getCur();
       ID3_Frame* f = new ID3_Frame;
       f->SetSpec(tag.GetSpec());
-      bool goodParse = f->Parse(rdr);
+      bool goodParse = f->Parse(rdr, source);
       frameSize = rdr.getCur() - last_pos;
       ID3D_NOTICE( "id3::v2::parseFrames(): frameSize = " << frameSize );
       totalSize += frameSize;
@@ -134,7 +141,31 @@ namespace
   }
 };
 
-bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
+namespace
+{
+  // Checks the tag's data against the crc from its extended header.  The
+  // data is as it is after the extended header, resynced for id3v2.3.
+  ID3_TagCrc checkCrc(const ID3_TagHeader& hdr, const BString& data)
+  {
+    size_t size = data.size();
+    if (hdr.GetSpec() == ID3V2_3_0)
+    {
+      // the id3v2.3 crc leaves out the padding
+      if (hdr.GetPaddingSize() > size)
+      {
+        return ID3CRC_MISMATCH;
+      }
+      size -= hdr.GetPaddingSize();
+    }
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, data.data(), size);
+    return crc == hdr.GetCrcValue() ? ID3CRC_OK : ID3CRC_MISMATCH;
+  }
+}
+
+// Picture data is left in the file source, if one is given, as long as the
+// tag is stored as it is read: not unsynced, and without a crc to check.
+bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader, const char* source)
 {
   ID3_Reader::pos_type beg = reader.getCur();
   io::ExitTrigger et(reader);
@@ -164,10 +195,32 @@ bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
   ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): data window cur = " << wr.getCur() );
   ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): data window end = " << wr.getEnd() );
   tag.SetExtended(hdr.GetExtended());
+  // keep the crc, so that it is written again when the tag is
+  tag.SetCrc(hdr.GetCrc());
   if (!hdr.GetUnsync())
   {
     tag.SetUnsync(false);
-    parseFrames(tag, wr);
+    if (!hdr.GetCrc() && source && dataSize > id3::v2::TAG_BLOCK_SIZE)
+    {
+      // a big tag, most likely for its pictures: leave them be
+      parseFrames(tag, wr, source);
+    }
+    else if (!hdr.GetCrc())
+    {
+      // Read the whole of the tag with one read, rather than a few small
+      // ones for every frame.  The block keeps the file's positions, so
+      // the picture offsets still come out right.
+      io::BlockReader br(wr, dataSize);
+      parseFrames(tag, br, source);
+    }
+    else
+    {
+      // the data has to be read in to check it, so parse it from there
+      BString raw = io::readAllBinary(wr);
+      tag.SetCrcStatus(checkCrc(hdr, raw));
+      io::BStringReader sr(raw);
+      parseFrames(tag, sr);
+    }
   }
   else
   {
@@ -195,6 +248,12 @@ bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
     // of the same string, and 2) so that calls to readChars aren't done a
     // character at a time for every call
     BString synced = io::readAllBinary(ur);
+    if (hdr.GetCrc())
+    {
+      // id3v2.4 unsyncs frame by frame, and its crc is of the data as it
+      // is stored; that of id3v2.3 is of the data before it was unsynced
+      tag.SetCrcStatus(checkCrc(hdr, hdr.GetSpec() == ID3V2_3_0 ? synced : raw));
+    }
     io::BStringReader sr(synced);
     parseFrames(tag, sr);
   }
@@ -202,12 +261,63 @@ bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
   return true;
 }
 
+// Parses an id3v2.4 tag appended to the file, which is found by its footer.
+// Like the other tail parsers, the reader is expected to be positioned at the
+// end of the region to search, and is left at the start of the tag if one was
+// found.
+bool id3::v2::parseAppended(ID3_TagImpl& tag, ID3_Reader& reader)
+{
+  io::ExitTrigger et(reader);
+
+  ID3_Reader::pos_type end = reader.getCur();
+  if (end < reader.getBeg() + 2 * ID3_TagHeader::SIZE)
+  {
+    ID3D_NOTICE( "id3::v2::parseAppended: not enough bytes to parse, pos = " << end );
+    return false;
+  }
+  reader.setCur(end - ID3_TagHeader::SIZE);
+
+  uchar id[ID3_TagHeader::ID_SIZE];
+  reader.readChars(id, ID3_TagHeader::ID_SIZE);
+  if (memcmp(id, ID3_TagHeader::FOOTER_ID, ID3_TagHeader::ID_SIZE) != 0)
+  {
+    ID3D_NOTICE( "id3::v2::parseAppended: no footer" );
+    return false;
+  }
+  uchar major = reader.readChar();
+  uchar minor = reader.readChar();
+  uchar flags = reader.readChar();
+  size_t dataSize = io::readUInt28(reader);
+  if (ID3_VerRevToV2Spec(major, minor) != ID3V2_4_0 ||
+      !(flags & ID3_TagHeader::HEADER_FLAG_FOOTER) ||
+      end < reader.getBeg() + 2 * ID3_TagHeader::SIZE + dataSize)
+  {
+    ID3D_NOTICE( "id3::v2::parseAppended: bad footer" );
+    return false;
+  }
+
+  // the footer mirrors the header, so the tag's start is known; parse it
+  // from there and make sure it ends where the footer begins
+  ID3_Reader::pos_type beg = end - 2 * ID3_TagHeader::SIZE - dataSize;
+  reader.setCur(beg);
+  if (!id3::v2::parse(tag, reader) || 
+      reader.getCur() != end - ID3_TagHeader::SIZE)
+  {
+    ID3D_NOTICE( "id3::v2::parseAppended: no tag matching the footer" );
+    return false;
+  }
+  et.setExitPos(beg);
+  return true;
+}
+
 void ID3_TagImpl::ParseFile()
 {
   ifstream file;
   if (ID3E_NoError != openReadableFile(this->GetFileName(), file))
   {
     // log this...
+    // nothing was read, so don't go on with the size of the last file
+    _file_size = 0;
     return;
   }
   ID3_IFStreamReader ifsr(file);
@@ -226,13 +336,29 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
 
   _file_tags.clear();
   _file_size = reader.getEnd();
+  delete _mp3_info;
+  _mp3_info = NULL;
+  _appended_v2_pos = 0;
+  _appended_v2_bytes = 0;
+  // a file that is all tag never gets as far as the appended tags
+  _appended_bytes = 0;
 
   ID3_Reader::pos_type beg  = wr.getBeg();
   ID3_Reader::pos_type cur  = wr.getCur();
   ID3_Reader::pos_type end  = wr.getEnd();
 
   ID3_Reader::pos_type last = cur;
+  const size_t numFrames = this->NumFrames();
 
+  // the prepended tags are read from the file as it is stored, so their
+  // picture data can be left there
+  const char* source = NULL;
+#ifndef WIN32
+  if (_link_options.test(ID3LO_PICTUREOFFSETS) && !_file_name.empty())
+  {
+    source = _file_name.c_str();
+  }
+#endif
   if (_tags_to_parse.test(ID3TT_ID3V2))
   {
 	int count = 4096; // ESL, limit to 4k buffer to avoid scanning the whole file
@@ -240,7 +366,7 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
     {
       last = cur;
       // Parse tags at the beginning of the file first...
-      if (id3::v2::parse(*this, wr))
+      if (id3::v2::parse(*this, wr, source))
       {
         _file_tags.add(ID3TT_ID3V2);
       }
@@ -248,6 +374,19 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
       wr.setBeg(cur);
     } while (!wr.atEnd() && (cur > last) && count--);
   }
+  // an empty prepended tag (one emptied by an appended update) doesn't count
+  const bool prependedV2 = this->NumFrames() > numFrames;
+
+  // A SEEK frame gives the offset from the end of the prepended tag(s) to a
+  // further tag.  It describes the file rather than the audio, so it isn't
+  // kept: the tag it points to is either found below or merged in here.
+  size_t seek_pos = 0;
+  ID3_Frame* seek = this->Find(ID3FID_SEEKFRAME);
+  if (seek)
+  {
+    seek_pos = wr.getCur() + seek->GetField(ID3FN_OFFSET)->Get();
+    delete this->RemoveFrame(seek);
+  }
 
 #if 0 // ESL Aug 6th 2009: do we really need to do all this since all what we really care about are the sync bits???
 
@@ -382,102 +521,119 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
 #else // ESL Aug 6th 2009: new implementation that just look for the sync bits, this seems a lot more robust espcially when handling 'unknown' blocks as reported by ASFViewer
 
   _prepended_bytes = wr.getCur() - beg;
+  bytes_till_sync = 0;
 
-  int count = 64*1024; // ESL, limits to 64k to avoid scanning the whole file, this should be enough.
-  bool found = false;
-  while(!wr.atEnd() && count--) {
-
-	if(wr.readChar() == 0xFF) {
-
-		if(wr.atEnd()) {
-			return; // could not find the frames
-		}
-
-        // Check second part of header, use 0xE0 instead to include MPEG 2.5
-        // also 0x02 exludes all non layer 3 files
-        if(((wr.peekChar() & 0xE0) == 0xE0) && ((wr.peekChar() & 0x06) == 0x02)) {
-            size_t currentPos = wr.getCur();
-            // Reverse back past readChar so that Parse() is pointing
-            // to the correct character
-            wr.setCur(currentPos - 1);
+  // the audio is only looked for if the link options ask for it
+  const bool audio = 
+    (_link_options.get() & (ID3LO_MP3HEADER | ID3LO_MP3DURATION)) != 0;
 
-            Mp3Info mp3_info;
-            ID3D_NOTICE( "ID3_TagImpl::ParseReader(): mp3header? cur = " << wr.getCur() );
-
-            if (mp3_info.Parse(wr, _file_size) && mp3_info.Seconds() != 0)
-            {
-                wr.setCur(currentPos);
-                found = true;
-                break;
-            } else {
-                wr.setCur(currentPos);
-            }
-        }
-     }
-  }
+  // ESL, limits to 64k to avoid scanning the whole file, this should be enough.
+  const size_t SYNC_WINDOW = 64*1024;
+  const bool found = audio && Mp3Info::FindSync(wr, SYNC_WINDOW);
 
-  if(!found)
+  if(audio && !found)
 	  return; // could not find the frames
 
-  bytes_till_sync = (wr.getCur() - 1) - _prepended_bytes;
+  if (found)
+    bytes_till_sync = wr.getCur() - _prepended_bytes;
 
 #endif
 
-  cur = wr.setCur(end);
   if (_file_size > _prepended_bytes)
   {
+    // The appended tags are parsed from one block read from the end of the
+    // file; only a tag larger than the block has to go back to the file.
+    io::TailReader tail(reader, wr.getBeg(), TAIL_BLOCK_SIZE);
+    io::WindowedReader twr(tail);
+    twr.setBeg(wr.getBeg());
+    cur = twr.setCur(end);
     do
     {
       last = cur;
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): beg = " << wr.getBeg() );
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): cur = " << wr.getCur() );
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): end = " << wr.getEnd() );
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): beg = " << twr.getBeg() );
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): cur = " << twr.getCur() );
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): end = " << twr.getEnd() );
       // ...then the tags at the end
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_MUSICMATCH) && mm::parse(*this, wr))
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch? cur = " << twr.getCur() );
+      if (_tags_to_parse.test(ID3TT_MUSICMATCH) && mm::parse(*this, twr))
       {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch! cur = " << wr.getCur() );
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch! cur = " << twr.getCur() );
         _file_tags.add(ID3TT_MUSICMATCH);
-        wr.setEnd(wr.getCur());
+        twr.setEnd(twr.getCur());
       }
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_LYRICS3) && lyr3::v1::parse(*this, wr))
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1? cur = " << twr.getCur() );
+      if (_tags_to_parse.test(ID3TT_LYRICS3) && lyr3::v1::parse(*this, twr))
       {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1! cur = " << wr.getCur() );
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1! cur = " << twr.getCur() );
         _file_tags.add(ID3TT_LYRICS3);
-        wr.setEnd(wr.getCur());
+        twr.setEnd(twr.getCur());
       }
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_LYRICS3V2) && lyr3::v2::parse(*this, wr))
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2? cur = " << twr.getCur() );
+      if (_tags_to_parse.test(ID3TT_LYRICS3V2) && lyr3::v2::parse(*this, twr))
       {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2! cur = " << wr.getCur() );
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2! cur = " << twr.getCur() );
         _file_tags.add(ID3TT_LYRICS3V2);
-        cur = wr.getCur();
-        wr.setCur(wr.getEnd());//set to end to seek id3v1 tag
+        cur = twr.getCur();
+        twr.setCur(twr.getEnd());//set to end to seek id3v1 tag
         //check for id3v1 tag and set End accordingly
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << wr.getCur() );
-        if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, wr))
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << twr.getCur() );
+        if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, twr))
         {
-          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << wr.getCur() );
+          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << twr.getCur() );
           _file_tags.add(ID3TT_ID3V1);
         }
-        wr.setCur(cur);
-        wr.setEnd(cur);
+        twr.setCur(cur);
+        twr.setEnd(cur);
       }
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, wr))
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << twr.getCur() );
+      if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, twr))
       {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << wr.getCur() );
-        wr.setEnd(wr.getCur());
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << twr.getCur() );
+        twr.setEnd(twr.getCur());
         _file_tags.add(ID3TT_ID3V1);
       }
-      cur = wr.getCur();
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v2 footer? cur = " << twr.getCur() );
+      if (_tags_to_parse.test(ID3TT_ID3V2) && !_appended_v2_bytes &&
+          id3::v2::parseAppended(*this, twr))
+      {
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v2 footer! cur = " << twr.getCur() );
+        _appended_v2_pos = twr.getCur();
+        _appended_v2_bytes = twr.getEnd() - twr.getCur();
+        twr.setEnd(twr.getCur());
+        _file_tags.add(ID3TT_ID3V2);
+      }
+      cur = twr.getCur();
     } while (cur != last);
+
+    // a tag reached through a SEEK frame that wasn't found by its footer
+    if (seek_pos > beg + _prepended_bytes && seek_pos < cur && !_appended_v2_bytes)
+    {
+      twr.setCur(seek_pos);
+      if (id3::v2::parse(*this, twr))
+      {
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): seek tag! cur = " << twr.getCur() );
+        _file_tags.add(ID3TT_ID3V2);
+        if (twr.getCur() == cur)
+        {
+          // it sits right before the other appended tags, so treat it as one
+          _appended_v2_pos = seek_pos;
+          _appended_v2_bytes = cur - seek_pos;
+          cur = seek_pos;
+        }
+      }
+      twr.setCur(cur);
+    }
     _appended_bytes = end - cur;
 
+    // a file whose only id3v2 tag is appended keeps it there on update
+    if (_appended_v2_bytes && !prependedV2)
+    {
+      this->SetAppended(true);
+    }
+
     // Now get the mp3 header
     mp3_core_size = (_file_size - _appended_bytes) - (_prepended_bytes + bytes_till_sync);
-    if (mp3_core_size >= 4)
+    if (audio && mp3_core_size >= 4)
     { //it has at least the size for a mp3 header (a mp3 header is 4 bytes)
       wr.setBeg(_prepended_bytes + bytes_till_sync);
       wr.setCur(_prepended_bytes + bytes_till_sync);
@@ -489,6 +645,11 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
       if (_mp3_info->Parse(wr, mp3_core_size))
       {
         ID3D_NOTICE( "ID3_TagImpl::ParseReader(): mp3header! cur = " << wr.getCur() );
+        if (_link_options.test(ID3LO_MP3DURATION))
+        {
+          wr.setCur(_prepended_bytes + bytes_till_sync);
+          _mp3_info->ParseFrames(wr, mp3_core_size);
+        }
       }
       else
       {
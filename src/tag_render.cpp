@@ -65,24 +65,157 @@ void id3::v1::render(ID3_Writer& writer, const ID3_TagImpl& tag)
 
 namespace
 {
-  void renderFrames(ID3_Writer& writer, const ID3_TagImpl& tag)
+  typedef std::vector<String> Rendered;
+
+  // Deflating is most of the cost of rendering a compressed frame, so the
+  // compressed frames are rendered once, while the tag is sized.  They are
+  // added to keep as they are rendered, and written from kept when it has
+  // them.
+  void renderFrames(ID3_Writer& writer, const ID3_TagImpl& tag,
+                    Rendered* keep, const Rendered* kept)
   {
+    size_t compressed = 0;
     for (ID3_TagImpl::const_iterator iter = tag.begin(); iter != tag.end(); ++iter)
     {
       const ID3_Frame* frame = *iter;
-      if (frame) frame->Render(writer);
+      if (!frame)
+      {
+        continue;
+      }
+      if (!frame->GetCompression())
+      {
+        frame->Render(writer);
+      }
+      else if (kept != NULL && compressed < kept->size())
+      {
+        const String& rendered = (*kept)[compressed++];
+        writer.writeChars(rendered.data(), rendered.size());
+      }
+      else
+      {
+        String rendered;
+        io::StringWriter sw(rendered);
+        frame->Render(sw);
+        writer.writeChars(rendered.data(), rendered.size());
+        if (keep != NULL)
+        {
+          keep->push_back(String());
+          keep->back().swap(rendered);
+        }
+      }
+    }
+  }
+
+  void renderFrames(ID3_Writer& writer, const ID3_TagImpl& tag, 
+                    size_t& numSyncs, Rendered* keep, const Rendered* kept)
+  {
+    if (!tag.GetUnsync())
+    {
+      renderFrames(writer, tag, keep, kept);
+      numSyncs = 0;
+    }
+    else
+    {
+      io::UnsyncedWriter uw(writer);
+      renderFrames(uw, tag, keep, kept);
+      uw.flush();
+      numSyncs = uw.getNumSyncs();
     }
   }
+
+  // Returns the exact number of bytes the frames will occupy once rendered
+  // (and unsynced, if the tag calls for it), without keeping the rendering.
+  // If the tag is to have a crc, it is worked out along the way: id3v2.3
+  // wants it of the frames before they are unsynced, id3v2.4 of them as
+  // they are written.  The tag is written as ID3V2_LATEST.  The compressed
+  // frames are kept in compressed.
+  size_t framesSize(const ID3_TagImpl& tag, size_t& numSyncs, uint32& crc,
+                    Rendered& compressed)
+  {
+    io::CountingWriter counter;
+    if (!tag.GetCrc())
+    {
+      renderFrames(counter, tag, numSyncs, &compressed, NULL);
+    }
+    else if (ID3V2_LATEST == ID3V2_3_0 && tag.GetUnsync())
+    {
+      io::UnsyncedWriter uw(counter);
+      io::Crc32Writer cw(uw);
+      renderFrames(cw, tag, &compressed, NULL);
+      uw.flush();
+      numSyncs = uw.getNumSyncs();
+      crc = cw.getCrc();
+    }
+    else
+    {
+      io::Crc32Writer cw(counter);
+      renderFrames(cw, tag, numSyncs, &compressed, NULL);
+      crc = cw.getCrc();
+    }
+    return counter.getCur();
+  }
 }
 
-void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
+void id3::v2::layout(const ID3_TagImpl& tag, Layout& layout)
 {
+  layout.frames = 0;
+  layout.syncs = 0;
+  layout.padding = 0;
+  layout.total = 0;
+  layout.crc = 0;
+  layout.compressed.clear();
+
   // There has to be at least one frame for there to be a tag...
+  if (tag.NumFrames() == 0)
+  {
+    return;
+  }
+
+  // The header has to know the size of the data that follows it, so the
+  // frames are rendered into a counter first.
+  layout.frames = 
+    framesSize(tag, layout.syncs, layout.crc, layout.compressed);
+  if (layout.frames == 0)
+  {
+    return;
+  }
+  layout.padding = tag.PaddingSize(layout.frames);
+  if (tag.GetCrc() && ID3V2_LATEST == ID3V2_4_0)
+  {
+    // the id3v2.4 crc takes in the padding too
+    io::CountingWriter counter;
+    io::Crc32Writer cw(counter, layout.crc);
+    cw.writeZeros(layout.padding);
+    layout.crc = cw.getCrc();
+  }
+  layout.total = ID3_TagHeader::SIZE + tag.GetExtendedBytes() + 
+                 layout.frames + layout.padding;
+  if (tag.GetFooter())
+  {
+    layout.total += ID3_TagHeader::SIZE;
+  }
+}
+
+void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
+{
+  Layout layout;
+  id3::v2::layout(tag, layout);
+  id3::v2::render(writer, tag, layout);
+}
+
+void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag, 
+                     const Layout& layout)
+{
   if (tag.NumFrames() == 0)
   {
     ID3D_WARNING( "id3::v2::render(): no frames to render" );
     return;
   }
+  if (layout.frames == 0)
+  {
+    ID3D_WARNING( "id3::v2::render(): rendered frame size is 0 bytes" );
+    return;
+  }
   
   ID3D_NOTICE( "id3::v2::render(): rendering" );
   ID3_TagHeader hdr;
@@ -90,98 +223,58 @@ void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
   hdr.SetExtended(tag.GetExtended());
   hdr.SetExperimental(tag.GetExperimental());
   hdr.SetFooter(tag.GetFooter());
+  hdr.SetCrc(tag.GetCrc());
+  hdr.SetCrcValue(layout.crc);
+  hdr.SetPaddingSize(layout.padding);
     
   // set up the encryption and grouping IDs
 
   // ...
-  String frms;
-  io::StringWriter frmWriter(frms);
-  if (!tag.GetUnsync())
-  {
-    ID3D_NOTICE( "id3::v2::render(): rendering frames" );
-    renderFrames(frmWriter, tag);
-    hdr.SetUnsync(false);
-  }
-  else
-  {
-    ID3D_NOTICE( "id3::v2::render(): rendering unsynced frames" );
-    io::UnsyncedWriter uw(frmWriter);
-    renderFrames(uw, tag);
-    uw.flush();
-    ID3D_NOTICE( "id3::v2::render(): numsyncs = " << uw.getNumSyncs() );
-    hdr.SetUnsync(uw.getNumSyncs() > 0);
-  }
-  size_t frmSize = frms.size();
-  if (frmSize == 0)
-  {
-    ID3D_WARNING( "id3::v2::render(): rendered frame size is 0 bytes" );
-    return;
-  }
+  ID3D_NOTICE( "id3::v2::render(): numsyncs = " << layout.syncs );
+  hdr.SetUnsync(layout.syncs > 0);
+  ID3D_NOTICE( "id3::v2::render(): padding size = " << layout.padding );
   
-  // zero the remainder of the buffer so that our padding bytes are zero
-  luint nPadding = tag.PaddingSize(frmSize);
-  ID3D_NOTICE( "id3::v2::render(): padding size = " << nPadding );
-  
-  hdr.SetDataSize(frmSize + tag.GetExtendedBytes() + nPadding);
+  hdr.SetDataSize(layout.frames + tag.GetExtendedBytes() + layout.padding);
   
   hdr.Render(writer);
 
-  writer.writeChars(frms.data(), frms.size());
+  // The frames go straight into the writer, the compressed ones as they
+  // were rendered while sizing.
+  ID3D_NOTICE( "id3::v2::render(): rendering frames" );
+  size_t numSyncs = 0;
+  renderFrames(writer, tag, numSyncs, NULL, &layout.compressed);
+
+  writer.writeZeros(layout.padding);
 
-  for (size_t i = 0; i < nPadding; ++i)
+  if (hdr.GetFooter())
   {
-    if (writer.writeChar('\0') == ID3_Writer::END_OF_WRITER)
-    {
-      break;
-    }
+    hdr.RenderFooter(writer);
   }
 }
 
 size_t ID3_TagImpl::Size() const
 {
-  if (this->NumFrames() == 0)
-  {
-    return 0;
-  }
-  ID3_TagHeader hdr;
+  id3::v2::Layout layout;
+  return this->Size(layout);
+}
 
-  hdr.SetSpec(this->GetSpec());
-  size_t bytesUsed = hdr.Size();
-  
-  size_t frameBytes = 0;
+size_t ID3_TagImpl::Size(id3::v2::Layout& layout) const
+{
   for (const_iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
   {
     if (*cur)
     {
       (*cur)->SetSpec(this->GetSpec());
-      frameBytes += (*cur)->Size();
     }
   }
-  
-  if (!frameBytes)
-  {
-    return 0;
-  }
-  
-  bytesUsed += frameBytes;
-  // add 30% for sync
-  if (this->GetUnsync())
-  {
-    bytesUsed += bytesUsed / 3;
-  }
-    
-  bytesUsed += this->PaddingSize(bytesUsed);
-  return bytesUsed;
-}
 
-
-void ID3_TagImpl::RenderExtHeader(uchar *buffer)
-{
-  if (this->GetSpec() == ID3V2_3_0)
-  {
-  }
+  // Sizing the frames renders them, which resets their changed flags; make
+  // sure the tag still reports the change so that Update() will write it.
+  bool changed = this->HasChanged();
+  id3::v2::layout(*this, layout);
+  _changed = _changed || changed;
   
-  return ;
+  return layout.total;
 }
 
 
@@ -193,8 +286,8 @@ size_t ID3_TagImpl::PaddingSize(size_t curSize) const
 {
   luint newSize = 0;
   
-  // if padding is switched off
-  if (! _is_padded)
+  // if padding is switched off, or not allowed because the tag has a footer
+  if (! _is_padded || this->GetFooter())
   {
     return 0;
   }
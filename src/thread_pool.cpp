@@ -0,0 +1,227 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "thread_pool.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#if defined HAVE_PTHREAD_H
+#  include <pthread.h>
+#  include <vector>
+#endif
+
+using namespace dami;
+
+size_t dami::processors()
+{
+#if defined HAVE_UNISTD_H && defined _SC_NPROCESSORS_ONLN
+  long count = ::sysconf(_SC_NPROCESSORS_ONLN);
+  if (count > 0)
+  {
+    return count;
+  }
+#endif
+  return 1;
+}
+
+#if defined HAVE_PTHREAD_H
+namespace
+{
+  // the tasks [next, end) a thread has yet to run
+  struct Run
+  {
+    size_t next;
+    size_t end;
+    pthread_mutex_t lock;
+
+    Run() : next(0), end(0)
+    {
+      pthread_mutex_init(&lock, NULL);
+    }
+    ~Run()
+    {
+      pthread_mutex_destroy(&lock);
+    }
+
+    size_t left()
+    {
+      pthread_mutex_lock(&lock);
+      size_t n = end - next;
+      pthread_mutex_unlock(&lock);
+      return n;
+    }
+  };
+
+  // what the threads share: the tasks, and a run of them for each thread
+  struct Pool
+  {
+    Tasks& tasks;
+    Run* runs;
+    size_t numRuns;
+
+    // the runs hold mutexes, so they are made in place rather than copied
+    Pool(Tasks& t, size_t count, size_t threads)
+      : tasks(t), runs(new Run[threads]), numRuns(threads)
+    {
+      for (size_t i = 0; i < threads; ++i)
+      {
+        runs[i].next = count * i / threads;
+        runs[i].end = count * (i + 1) / threads;
+      }
+    }
+    ~Pool()
+    {
+      delete [] runs;
+    }
+
+    // The next task from the worker's own run, if there is one left
+    bool takeOwn(size_t worker, size_t& task)
+    {
+      Run& run = runs[worker];
+      pthread_mutex_lock(&run.lock);
+      task = run.next;
+      const bool found = run.next < run.end;
+      if (found)
+      {
+        ++run.next;
+      }
+      pthread_mutex_unlock(&run.lock);
+      return found;
+    }
+
+    // Moves the back half of the biggest run left to the worker's own run
+    // and takes the first task of it.  Only one run is locked at a time.
+    bool steal(size_t worker, size_t& task)
+    {
+      for (;;)
+      {
+        size_t victim = worker, most = 0;
+        for (size_t i = 0; i < numRuns; ++i)
+        {
+          const size_t left = (i == worker) ? 0 : runs[i].left();
+          if (left > most)
+          {
+            victim = i;
+            most = left;
+          }
+        }
+        if (most == 0)
+        {
+          return false;
+        }
+
+        size_t beg = 0, end = 0;
+        Run& from = runs[victim];
+        pthread_mutex_lock(&from.lock);
+        if (from.next < from.end)
+        {
+          end = from.end;
+          beg = end - (end - from.next + 1) / 2;
+          from.end = beg;
+        }
+        pthread_mutex_unlock(&from.lock);
+        if (beg == end)
+        {
+          // it ran out while we looked; look again
+          continue;
+        }
+
+        Run& to = runs[worker];
+        pthread_mutex_lock(&to.lock);
+        to.next = beg + 1;
+        to.end = end;
+        pthread_mutex_unlock(&to.lock);
+        task = beg;
+        return true;
+      }
+    }
+  };
+
+  struct Worker
+  {
+    Pool* pool;
+    size_t number;
+  };
+
+  void* work(void* arg)
+  {
+    Worker* worker = static_cast<Worker*>(arg);
+    Pool& pool = *worker->pool;
+    size_t task;
+    while (pool.takeOwn(worker->number, task) ||
+           pool.steal(worker->number, task))
+    {
+      pool.tasks.run(task, worker->number);
+    }
+    return NULL;
+  }
+}
+#endif
+
+void dami::runTasks(Tasks& tasks, size_t count, size_t threads)
+{
+  if (threads == 0)
+  {
+    threads = processors();
+  }
+  threads = dami::min(threads, count);
+#if defined HAVE_PTHREAD_H
+  if (threads > 1)
+  {
+    Pool pool(tasks, count, threads);
+    std::vector<Worker> workers(threads);
+    // the calling thread is worker 0; a thread that can't be started leaves
+    // its run to be stolen by the others
+    std::vector<pthread_t> started;
+    for (size_t i = 0; i < threads; ++i)
+    {
+      workers[i].pool = &pool;
+      workers[i].number = i;
+      pthread_t thread;
+      if (i > 0 && pthread_create(&thread, NULL, work, &workers[i]) == 0)
+      {
+        started.push_back(thread);
+      }
+    }
+    work(&workers[0]);
+    for (size_t i = 0; i < started.size(); ++i)
+    {
+      pthread_join(started[i], NULL);
+    }
+    return;
+  }
+#endif
+  for (size_t task = 0; task < count; ++task)
+  {
+    tasks.run(task, 0);
+  }
+}
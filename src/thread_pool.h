@@ -0,0 +1,56 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_THREAD_POOL_H_
+#define _ID3LIB_THREAD_POOL_H_
+
+#include "id3/globals.h" //has <stdlib.h> "id3/sized_types.h"
+
+namespace dami
+{
+  // A numbered set of independent tasks, for runTasks().  worker is the
+  // number of the thread running the task, in [0, threads), so state can be
+  // kept per thread: no two tasks with the same worker run at once.
+  class Tasks
+  {
+  public:
+    virtual ~Tasks() { ; }
+    virtual void run(size_t task, size_t worker) = 0;
+  };
+
+  // Runs tasks.run() for each task in [0, count) on up to the given number
+  // of threads; 0 threads means one per processor.  Each thread starts on
+  // its own run of consecutive tasks, and one that runs out steals the back
+  // half of the biggest run left.  Returns when all the tasks are done.
+  // Without pthreads the tasks are run in turn on the calling thread.
+  void runTasks(Tasks& tasks, size_t count, size_t threads = 0);
+
+  // The number of processors online, or 1 if that can't be found out
+  size_t processors();
+}
+
+#endif /* _ID3LIB_THREAD_POOL_H_ */
@@ -29,6 +29,20 @@
 #endif
 
 #include "writers.h"
+#include "io_helpers.h"
+
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+#if defined HAVE_SYS_UIO_H
+#  include <sys/uio.h>
+#endif
+#if defined HAVE_SYS_PARAM_H
+#  include <sys/param.h>
+#endif
+#if defined WIN32
+#  include <io.h>
+#endif
 
 //using namespace dami;
 
@@ -43,3 +57,237 @@ ID3_MemoryWriter::writeChars(const char_type buf[], size_type len)
 }
 */
 
+namespace
+{
+  // The single zero page that all zero writes are served from.
+  const size_t ZERO_PAGE_SIZE = 4096;
+  const ID3_Writer::char_type ZERO_PAGE[ZERO_PAGE_SIZE] = { 0 };
+
+}
+
+ID3_Writer::size_type ID3_Writer::writeZeros(size_type len)
+{
+  size_type numZeros = 0;
+  while (numZeros < len)
+  {
+    size_type size = len - numZeros;
+    if (size > ZERO_PAGE_SIZE)
+    {
+      size = ZERO_PAGE_SIZE;
+    }
+    size_type written = this->writeChars(ZERO_PAGE, size);
+    numZeros += written;
+    if (written < size)
+    {
+      break;
+    }
+  }
+  return numZeros;
+}
+
+ID3_Writer::size_type 
+ID3_Writer::writeFromFile(int fd, pos_type offset, size_type len)
+{
+  char_type buffer[4 * ZERO_PAGE_SIZE];
+  size_type numBytes = 0;
+  while (numBytes < len)
+  {
+    size_type size = len - numBytes;
+    if (size > sizeof(buffer))
+    {
+      size = sizeof(buffer);
+    }
+    size = dami::io::readAt(fd, buffer, size, offset + numBytes);
+    size_type written = size ? this->writeChars(buffer, size) : 0;
+    numBytes += written;
+    if (written == 0 || written < size)
+    {
+      break;
+    }
+  }
+  return numBytes;
+}
+
+ID3_Writer::size_type 
+ID3_MemoryWriter::writeFromFile(int fd, pos_type offset, size_type len)
+{
+  size_type remaining = _end - _cur;
+  size_type size = 
+    dami::io::readAt(fd, _cur, (remaining > len) ? len : remaining, offset);
+  _cur += size;
+  return size;
+}
+
+ID3_FDWriter::ID3_FDWriter(int fd, pos_type offset)
+  : _fd(fd),
+    _beg(offset),
+    _cur(offset),
+    _off(offset),
+    _good(fd >= 0),
+    _used(0),
+    _numSegments(0)
+{
+}
+
+ID3_FDWriter::~ID3_FDWriter()
+{
+  this->flush();
+}
+
+void ID3_FDWriter::close()
+{
+  this->flush();
+}
+
+void ID3_FDWriter::addSegment(const char_type* data, size_type size)
+{
+  if (_numSegments == MAX_SEGMENTS)
+  {
+    this->flush();
+  }
+  _segments[_numSegments].data = data;
+  _segments[_numSegments].size = size;
+  ++_numSegments;
+}
+
+void ID3_FDWriter::flush()
+{
+  if (_numSegments == 0)
+  {
+    return;
+  }
+  size_t total = 0;
+  for (size_t i = 0; i < _numSegments; ++i)
+  {
+    total += _segments[i].size;
+  }
+  if (_good)
+  {
+#if defined HAVE_PWRITEV && defined HAVE_SYS_UIO_H
+    struct iovec iov[MAX_SEGMENTS];
+    for (size_t i = 0; i < _numSegments; ++i)
+    {
+      iov[i].iov_base = const_cast<char_type*>(_segments[i].data);
+      iov[i].iov_len = _segments[i].size;
+    }
+    struct iovec* cur = iov;
+    int count = _numSegments;
+    pos_type off = _off;
+    while (count > 0)
+    {
+      ssize_t n = ::pwritev(_fd, cur, count, off);
+      if (n <= 0)
+      {
+        _good = false;
+        break;
+      }
+      off += n;
+      // skip past whatever was written, then pick up any partial iovec
+      while (count > 0 && static_cast<size_t>(n) >= cur->iov_len)
+      {
+        n -= cur->iov_len;
+        ++cur;
+        --count;
+      }
+      if (count > 0)
+      {
+        cur->iov_base = static_cast<char*>(cur->iov_base) + n;
+        cur->iov_len -= n;
+      }
+    }
+#else
+    pos_type off = _off;
+    for (size_t i = 0; _good && i < _numSegments; ++i)
+    {
+      _good = dami::io::writeAt(_fd, _segments[i].data, _segments[i].size, off);
+      off += _segments[i].size;
+    }
+#endif
+  }
+  _off += total;
+  _used = 0;
+  _numSegments = 0;
+}
+
+ID3_Writer::size_type 
+ID3_FDWriter::writeChars(const char_type buf[], size_type len)
+{
+  if (len == 0)
+  {
+    return 0;
+  }
+  if (len >= BUFFER_SIZE / 4)
+  {
+    // big enough to be worth a segment of its own; it has to go out now,
+    // since the caller's buffer won't outlive this call
+    this->addSegment(buf, len);
+    this->flush();
+  }
+  else
+  {
+    if (_used + len > BUFFER_SIZE || _numSegments == MAX_SEGMENTS)
+    {
+      this->flush();
+    }
+    char_type* dest = _buffer + _used;
+    ::memcpy(dest, buf, len);
+    _used += len;
+    Segment* last = _numSegments ? &_segments[_numSegments - 1] : NULL;
+    if (last && last->data + last->size == dest)
+    {
+      last->size += len;
+    }
+    else
+    {
+      this->addSegment(dest, len);
+    }
+  }
+  _cur += len;
+  return len;
+}
+
+ID3_Writer::size_type ID3_FDWriter::writeZeros(size_type len)
+{
+  size_type remaining = len;
+  while (remaining > 0)
+  {
+    size_type size = (remaining > ZERO_PAGE_SIZE) ? ZERO_PAGE_SIZE : remaining;
+    this->addSegment(ZERO_PAGE, size);
+    remaining -= size;
+  }
+  _cur += len;
+  return len;
+}
+
+ID3_Writer::size_type 
+ID3_FDWriter::writeFromFile(int fd, pos_type offset, size_type len)
+{
+  size_type copied = 0;
+#if defined HAVE_COPY_FILE_RANGE
+  // whatever is queued goes out first, so that the copy lands behind it
+  this->flush();
+  if (_good)
+  {
+    loff_t src = offset;
+    loff_t dst = _off;
+    while (copied < len)
+    {
+      ssize_t n = ::copy_file_range(fd, &src, _fd, &dst, len - copied, 0);
+      if (n <= 0)
+      {
+        break;
+      }
+      copied += n;
+    }
+    _off += copied;
+    _cur += copied;
+  }
+#endif
+  // the system may not copy between these files (across file systems, say),
+  // in which case the rest goes through the buffer
+  if (copied < len)
+  {
+    copied += ID3_Writer::writeFromFile(fd, offset + copied, len - copied);
+  }
+  return copied;
+}